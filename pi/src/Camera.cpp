@@ -37,9 +37,10 @@ Camera::Camera(int width, int height, string threadName, uint32_t period) :
 
 
 	/**
-	 * 3.0 Instantiate a new matrix that will hold the last frame.
+	 * 3.0 Instantiate the matrices that will hold the last frame and the frame being captured.
 	 */
 	lastFrame = new Mat();
+	spareFrame = new Mat();
 
 
 	/**
@@ -65,6 +66,7 @@ Camera::~Camera() {
 	 * 2.0 Delete all allocated objects.
 	 */
 	delete lastFrame;
+	delete spareFrame;
 
 // TODO mutex?
 
@@ -75,13 +77,13 @@ Camera::~Camera() {
  */
 void Camera::taskMethod() {
 	/**
-	 * 1.0 Allocate a pointer to a matrix that will be the new last frame.
-	 * We are doing this so that we can truly minimize the length of the critical section where we have the mutex locked.
+	 * 1.0 Use the spare matrix for the new last frame.  Capturing outside of the lock keeps the critical section where we have the mutex locked short.
+	 * Once the spare has been used for a frame, its buffer is already the right size, so the capture does not allocate.
 	 */
-	Mat *newLastFrame = new Mat();
+	Mat *newLastFrame = spareFrame;
 
 	/**
-	 * 2.0 Read the next frame in, placing it in the newly allocated Mat.
+	 * 2.0 Read the next frame in, placing it in the spare Mat.
 	 */
 	capture->grab();
 	capture->retrieve(*newLastFrame);
@@ -103,45 +105,29 @@ void Camera::taskMethod() {
 	 */
 	mtx.unlock();
 	/**
-	 * 7.0 Free the Mat that is pointed to by temp now.
+	 * 7.0 The old last frame is no longer visible to readers, so it becomes the spare for the next capture.
 	 */
-	delete temp;
+	spareFrame = temp;
 }
 
 /**
- * This method will return the next picture from the camera, following the algorithms described here:
- * @return The return will be a matrix of the picture that was last grabbed from the camera.  If the last frame is empty, the return will be an empty matrix.
+ * This method will copy the last frame grabbed from the camera into the given matrix.  If the matrix already has the right size, no memory is allocated.
+ * @param destination This is the matrix that the picture is to be copied into.
+ * @return true if a picture was copied.  False if no frame has been grabbed yet.
  */
-Mat *Camera::takePicture() {
-	/**
-	 * 1.0 Create a pointer to an empty matrix object and instantiate a new Mat.
-	 */
-	Mat *returnMat = new Mat();
+bool Camera::takePicture(Mat &destination) {
+	bool copied = false;
 
 	/**
-	 * 2.0 If the last frame is not empty.
+	 * 1.0 Lock the mutex protecting the last frame, and copy it if it is not empty.
 	 */
+	mtx.lock();
 	if (!lastFrame->empty()) {
-		/**
-		 * 2.1 Lock the mutex protecting the last frame.
-		 */
-		mtx.lock();
-
-		/**
-		 * 2.2 Copy the last frame to the return value.
-		 */
-		lastFrame->copyTo(*returnMat);
-
-		/**
-		 * 2.3 Unlock the mutex.
-		 */
-		mtx.unlock();
-
+		lastFrame->copyTo(destination);
+		copied = true;
 	}
-	/**
-	 * 3.0 Return the pointer to the matrix object.
-	 */
-	return returnMat;
+	mtx.unlock();
 
+	return copied;
 }
 
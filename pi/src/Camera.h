@@ -26,6 +26,12 @@ private:
 	 */
 	Mat *lastFrame;
 
+	/**
+	 * This is the frame that the next image is captured into.  Once it holds a complete frame, it is swapped with the last frame, so the two
+	 * buffers are reused rather than allocating a new frame for every image.
+	 */
+	Mat *spareFrame;
+
 	/**
 	 * This is a mutex within the camera class that prevents race conditions as the images are manipulated.
 	 */
@@ -51,10 +57,11 @@ public:
 	void taskMethod();
 
 	/**
-	 * This method will return the next picture from the camera, following the algorithms described here:
-	 * @return The return will be a matrix of the picture that was last grabbed from the camera.
+	 * This method will copy the last frame grabbed from the camera into the given matrix.  If the matrix already has the right size, no memory is allocated.
+	 * @param destination This is the matrix that the picture is to be copied into.
+	 * @return true if a picture was copied.  False if no frame has been grabbed yet.
 	 */
-	Mat *takePicture();
+	bool takePicture(Mat &destination);
 };
 #endif /* CAMERA_H_ */
 
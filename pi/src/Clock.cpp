@@ -0,0 +1,95 @@
+/**
+ * @file Clock.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the parts of the clock which are common to every clock, and the selection of the clock used by the tasks.
+ */
+
+#include "Clock.h"
+#include "SystemClock.h"
+
+/**
+ * This is the clock that is used when no other clock has been selected.
+ */
+static SystemClock systemClock;
+
+/**
+ * This is the clock that is currently used by all of the tasks.
+ */
+Clock *Clock::currentClock = &systemClock;
+
+/**
+ * This is the destructor for the clock.
+ */
+Clock::~Clock() {
+	/**
+	 * Nothing to be done in the destructor.
+	 */
+}
+
+/**
+ * This method will block the calling thread for the given amount of time.
+ * @param durationNs This is the amount of time, in nanoseconds, to sleep for.
+ */
+void Clock::sleepFor(int64_t durationNs) {
+	sleepUntil(now() + durationNs);
+}
+
+/**
+ * This method is called by start, on the thread which starts a runnable, before the thread of the runnable is created.
+ * @param participant This is the runnable which is to take part in the clock.
+ */
+void Clock::registerParticipant(RunnableClass *participant) {
+	// By default, threads do not need to be tracked by the clock.
+}
+
+/**
+ * This method is called by the thread of a registered runnable before its run method is invoked.
+ * @param participant This is the runnable which is starting.
+ */
+void Clock::attachParticipant(RunnableClass *participant) {
+	// By default, threads do not need to be tracked by the clock.
+}
+
+/**
+ * This method is called by the thread of a registered runnable once its run method has returned.
+ * @param participant This is the runnable which has finished.
+ */
+void Clock::detachParticipant(RunnableClass *participant) {
+	// By default, threads do not need to be tracked by the clock.
+}
+
+/**
+ * This method will return the clock that is currently used by all of the tasks.
+ * @return The current clock will be returned.  It is the system clock unless another clock has been selected.
+ */
+Clock *Clock::getClock() {
+	return currentClock;
+}
+
+/**
+ * This method will select the clock that is used by all of the tasks.  It must be called at startup, before any task is started.
+ * @param clock This is the clock that is to be used.  If it is NULL, the system clock is used.
+ */
+void Clock::setClock(Clock *clock) {
+	currentClock = (clock == NULL) ? (Clock*) &systemClock : clock;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file Clock.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the clock that every timing decision of the tasks is made against.  The clock provides the current time and a way
+ *      to sleep.  The system clock uses CLOCK_MONOTONIC and real sleeps.  Other clocks, such as the virtual clock, may replace it at startup
+ *      so that the task set can be run against simulated time.  Threads which take part in the clock register with it when they are started.
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+
+class RunnableClass;
+
+class Clock {
+private:
+	/**
+	 * This is the clock that is currently used by all of the tasks.
+	 */
+	static Clock *currentClock;
+
+public:
+	/**
+	 * This is the destructor for the clock.
+	 */
+	virtual ~Clock();
+
+	/**
+	 * This method will return the current time of the clock.  The time never goes backwards.
+	 * @return The current time, in nanoseconds, will be returned.
+	 */
+	virtual int64_t now()=0;
+
+	/**
+	 * This method will block the calling thread until the clock reaches the given time.
+	 * @param timeNs This is the absolute time, in nanoseconds, to sleep until.
+	 */
+	virtual void sleepUntil(int64_t timeNs)=0;
+
+	/**
+	 * This method will block the calling thread for the given amount of time.
+	 * @param durationNs This is the amount of time, in nanoseconds, to sleep for.
+	 */
+	virtual void sleepFor(int64_t durationNs);
+
+	/**
+	 * This method will wait on a condition variable for up to the given amount of time.
+	 * @param cv This is the condition variable to wait on.
+	 * @param lock This is the lock that protects the condition.  It must be held by the caller.
+	 * @param timeoutNs This is the longest amount of time, in nanoseconds, to wait.
+	 * @return true if the condition variable was notified.  False if the wait timed out.
+	 */
+	virtual bool waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, int64_t timeoutNs)=0;
+
+	/**
+	 * This method is called by start, on the thread which starts a runnable, before the thread of the runnable is created.
+	 * @param participant This is the runnable which is to take part in the clock.
+	 */
+	virtual void registerParticipant(RunnableClass *participant);
+
+	/**
+	 * This method is called by the thread of a registered runnable before its run method is invoked.
+	 * @param participant This is the runnable which is starting.
+	 */
+	virtual void attachParticipant(RunnableClass *participant);
+
+	/**
+	 * This method is called by the thread of a registered runnable once its run method has returned.
+	 * @param participant This is the runnable which has finished.
+	 */
+	virtual void detachParticipant(RunnableClass *participant);
+
+	/**
+	 * This method will return the clock that is currently used by all of the tasks.
+	 * @return The current clock will be returned.  It is the system clock unless another clock has been selected.
+	 */
+	static Clock *getClock();
+
+	/**
+	 * This method will select the clock that is used by all of the tasks.  It must be called at startup, before any task is started.
+	 * @param clock This is the clock that is to be used.  If it is NULL, the system clock is used.
+	 */
+	static void setClock(Clock *clock);
+};
+
+#endif /* CLOCK_H_ */
@@ -59,11 +59,11 @@ void CollisionSensor::taskMethod() {
 	} else {
 		madViolationCount++;
 		if(madViolationCount == 2) {
-			mcq->enqueue(MOTORDIRECTIONBITMAP | STOP); // stop the engines
-			hq->enqueue(HORN_SOUND_COMMAND); // sound the horn
+			mcq->enqueue(MOTORDIRECTIONBITMAP | STOP, COMMAND_SOURCE_COLLISION_SENSOR); // stop the engines
+			hq->enqueue(HORN_SOUND_COMMAND, COMMAND_SOURCE_COLLISION_SENSOR); // sound the horn
 		}
 		if(madViolationCount == 3) {
-			hq->enqueue(HORN_SOUND_COMMAND); // sound the horn
+			hq->enqueue(HORN_SOUND_COMMAND, COMMAND_SOURCE_COLLISION_SENSOR); // sound the horn
 		}
 	}
 
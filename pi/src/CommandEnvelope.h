@@ -0,0 +1,93 @@
+/**
+ * @file CommandEnvelope.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines the envelope in which a command travels from where it is received, through a command queue, to the motor which
+ * acts on it.  Alongside the command word, the envelope records where the command came from and the network message that carried it,
+ * and it is stamped with the CLOCK_MONOTONIC time at each hop.  The differences between the stamps give the latency of each stage.
+ * The queue also records the safety generation the command was enqueued in, so that it can tell whether a later safety command has
+ * superseded it.
+ */
+
+#ifndef COMMANDENVELOPE_H_
+#define COMMANDENVELOPE_H_
+
+#include <stdint.h>
+
+/**
+ * These macros define where a command came from.
+ */
+#define COMMAND_SOURCE_UNKNOWN (0)
+#define COMMAND_SOURCE_NETWORK (1)
+#define COMMAND_SOURCE_LINE_SENSOR (2)
+#define COMMAND_SOURCE_COLLISION_SENSOR (3)
+#define COMMAND_SOURCE_CONTROLLER (4)
+#define COMMAND_SOURCE_CONSOLE (5)
+#define COMMAND_SOURCE_NETWORK_UDP (6)
+
+/**
+ * This structure represents a command on its way to being acted on.  The 64 bit stamps come first so that the structure has no padding
+ * between members.  A stamp which has not been taken yet is 0.
+ */
+struct CommandEnvelope {
+	/**
+	 * This is the time, in nanoseconds, at which the command was received.  For a network command this is when the message was read
+	 * from the socket.  For any other command it is the same as the enqueue time.
+	 */
+	int64_t receiveTime;
+
+	/**
+	 * This is the time, in nanoseconds, at which the command was enqueued.
+	 */
+	int64_t enqueueTime;
+
+	/**
+	 * This is the time, in nanoseconds, at which the command was dequeued by the consumer.
+	 */
+	int64_t dequeueTime;
+
+	/**
+	 * This is the time, in nanoseconds, at which the command was written to the motor hardware.
+	 */
+	int64_t actuationTime;
+
+	/**
+	 * This is the command word.  It is the same bitmapped integer that is passed to CommandQueue::enqueue.
+	 */
+	int command;
+
+	/**
+	 * This is the messageID of the network message which carried the command, or 0 if it did not come from the network.
+	 */
+	int32_t messageID;
+
+	/**
+	 * This is the number of safety commands which had been enqueued on the queue when this command was enqueued.
+	 */
+	uint32_t generation;
+
+	/**
+	 * This is where the command came from.  It is one of the COMMAND_SOURCE values.
+	 */
+	uint32_t source;
+};
+
+#endif /* COMMANDENVELOPE_H_ */
@@ -6,17 +6,81 @@
 **/
 
 #include "CommandQueue.h"
-#include <queue>
+#include "MPSCRingBuffer.h"
+#include "SPSCRingBuffer.h"
 #include <mutex>
 #include <semaphore.h>
+#include <errno.h>
+#include <time.h>
+#include <iomanip>
+#include <stdio.h>
+#include "time_util.h"
 
 //using namespace se3910RPi;
 
 /**
- * This is the default constructor, which creates an instance of the queue.
+ * These are the names of the priority levels, which are used when the statistics are printed.
  */
-CommandQueue::CommandQueue() {
+static const char *priorityLevelNames[COMMAND_PRIORITY_LEVELS] = { "Safety", "Motion", "Routine" };
+
+/**
+ * These are the names of the coalescing keys, which are used when the statistics are printed.
+ */
+static const char *coalescingKeyNames[COMMAND_COALESCING_KEYS] = { "Speed", "Steering", "Direction" };
+
+/**
+ * This is the constructor, which creates an instance of the queue.
+ * @param implementation This selects the implementation of the queue.  It is one of the command queue implementations in QueueCfg.h.
+ * @param capacity This is the number of commands each priority level can hold.  It is rounded up to a power of two.
+ * @param classifier This is the classifier which assigns commands to priority levels.  If it is NULL, the queue has a single level.
+ * @param flushSuperseded If this is true, enqueueing a safety command discards the motion commands which were queued before it.
+ * @param coalescer This is the coalescer which maps setpoint commands onto coalescing slots.  If it is NULL, nothing is coalesced.
+ * @param overflowPolicy This is what happens to a command which finds its level full.  It is one of the overflow policies in QueueCfg.h.
+ */
+CommandQueue::CommandQueue(int implementation, uint32_t capacity, CommandClassifier classifier, bool flushSuperseded,
+		CommandClassifier coalescer, int overflowPolicy) :
+		safetyGeneration(0) {
 	sem_init(&queueCountSemaphore, 0, 0);
+	this->implementation = implementation;
+	this->classifier = classifier;
+	this->flushSuperseded = flushSuperseded && (classifier != NULL);
+	priorityLevels = (classifier != NULL) ? COMMAND_PRIORITY_LEVELS : 1;
+
+	this->coalescer = coalescer;
+
+	this->overflowPolicy = overflowPolicy;
+	if ((implementation == SPSC_COMMAND_QUEUE) && (overflowPolicy == OVERFLOW_DROP_OLDEST)) {
+		// Only the consumer may pop from a single producer ring.
+		printf("A single producer queue cannot drop its oldest command.  The newest command is dropped instead.\n");
+		this->overflowPolicy = OVERFLOW_DROP_NEWEST;
+	}
+
+	for (int level = 0; level < COMMAND_PRIORITY_LEVELS; level++) {
+		flushedCounts[level].store(0, std::memory_order_relaxed);
+		droppedCounts[level].store(0, std::memory_order_relaxed);
+		blockedCounts[level].store(0, std::memory_order_relaxed);
+		highWaterMarks[level].store(0, std::memory_order_relaxed);
+		overflowPending[level].store(false, std::memory_order_relaxed);
+	}
+	for (int key = 0; key < COMMAND_COALESCING_KEYS; key++) {
+		coalescingSlots[key].latest.store(0, std::memory_order_relaxed);
+		coalescingSlots[key].pending.store(false, std::memory_order_relaxed);
+		coalescedCounts[key].store(0, std::memory_order_relaxed);
+	}
+
+	if ((implementation != MPSC_COMMAND_QUEUE) && (implementation != SPSC_COMMAND_QUEUE)) {
+		this->implementation = LOCKED_COMMAND_QUEUE;
+	}
+
+	// Each priority level gets its own ring, so that a full routine level never holds up a safety command.  The locked implementation
+	// serializes every access with the mutex, so the lighter single producer ring is enough for it.
+	for (int level = 0; level < priorityLevels; level++) {
+		if (this->implementation == MPSC_COMMAND_QUEUE) {
+			rings[level] = new MPSCRingBuffer(capacity);
+		} else {
+			rings[level] = new SPSCRingBuffer(capacity);
+		}
+	}
 }
 
 /**
@@ -24,6 +88,316 @@ CommandQueue::CommandQueue() {
  */
 CommandQueue::~CommandQueue() {
 	sem_destroy(&queueCountSemaphore);
+	for (int level = 0; level < priorityLevels; level++) {
+		delete rings[level];
+	}
+}
+
+/**
+ * This method will determine which priority level a command is to be queued at.
+ * @param value This is the command.
+ * @return The priority level, which is always within range for the queue.
+ */
+int CommandQueue::classify(int value) {
+	if (classifier == NULL) {
+		return 0;
+	}
+
+	int level = classifier(value);
+	if (level < 0) {
+		level = 0;
+	} else if (level >= priorityLevels) {
+		level = priorityLevels - 1;
+	}
+	return level;
+}
+
+/**
+ * This method will determine whether a command is a safety command, which this queue's classifier places at the highest priority.
+ * @param value This is the command.
+ * @return true if the queue has a classifier and it classifies the command as a safety command.  False otherwise.
+ */
+bool CommandQueue::isSafetyCommand(int value) {
+	return (classifier != NULL) && (classify(value) == SAFETY_COMMAND_PRIORITY);
+}
+
+/**
+ * This method will determine which coalescing slot a command belongs to.
+ * @param value This is the command.
+ * @return The coalescing key, or -1 if the command is not coalesced.
+ */
+int CommandQueue::coalescingKey(int value) {
+	if (coalescer == NULL) {
+		return -1;
+	}
+
+	int key = coalescer(value);
+	if (key >= COMMAND_COALESCING_KEYS) {
+		key = -1;
+	}
+	return key;
+}
+
+/**
+ * This method will determine the overflow policy for a priority level.
+ * @param level This is the priority level.
+ * @return The overflow policy.  A prioritized queue always blocks on a full safety level.
+ */
+int CommandQueue::overflowPolicyFor(int level) {
+	if ((priorityLevels > 1) && (level == SAFETY_COMMAND_PRIORITY)) {
+		return OVERFLOW_BLOCK;
+	}
+	return overflowPolicy;
+}
+
+/**
+ * This method will wake any producers which are blocked on a full ring, once the consumer has made enough room for them.
+ * @param level This is the priority level of the ring which a command was popped from.
+ */
+void CommandQueue::notifySpace(int level) {
+	// Producers are only woken once the ring has drained to half full.  Waking them for every freed slot would cost a context switch per
+	// command while the ring is saturated.
+	if (rings[level]->getOccupancy() <= (rings[level]->getCapacity() / 2)) {
+		spaceAvailable.notify();
+	}
+}
+
+/**
+ * This method will count a command which is lost because its level is full.  If the command held the place of a coalescing slot, the slot
+ * is released so that the next command for its key is queued again.
+ * @param envelope This is the command which is lost.
+ * @param level This is its priority level.
+ */
+void CommandQueue::dropCommand(const CommandEnvelope &envelope, int level) {
+	int key = coalescingKey(envelope.command);
+	if (key >= 0) {
+		coalescingSlots[key].pending.store(false, std::memory_order_release);
+	}
+	droppedCounts[level].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * This method will put a command into the overflow slot of its level, replacing any command already there.  The queue mutex must be held.
+ * @param envelope This is the command.
+ * @param level This is its priority level.
+ */
+void CommandQueue::parkOverflow(const CommandEnvelope &envelope, int level) {
+	if (overflowPending[level].load(std::memory_order_relaxed)) {
+		dropCommand(overflowSlots[level], level);
+		overflowSlots[level] = envelope;
+		return;
+	}
+
+	// The slot holds a command the consumer has not been told about, so wake it in the same way as for a push.
+	overflowSlots[level] = envelope;
+	overflowPending[level].store(true, std::memory_order_release);
+	if (implementation == LOCKED_COMMAND_QUEUE) {
+		sem_post(&queueCountSemaphore);
+	}
+	itemAvailable.notify();
+}
+
+/**
+ * This method will pop the oldest command from one priority level, taking the overflow slot once the ring is empty.  For the locked
+ * implementation, the queue mutex must be held.
+ * @param level This is the priority level.
+ * @param envelope This is the location into which the command is written.
+ * @return true if a command was popped.  False if the level was empty.
+ */
+bool CommandQueue::popLevel(int level, CommandEnvelope &envelope) {
+	if (rings[level]->pop(envelope)) {
+		// Sample the occupancy, counting the command just popped.  Only the consumer gets here, so it is the single writer.
+		uint32_t occupancy = rings[level]->getOccupancy() + 1;
+		occupancyHistograms[level].record(occupancy);
+		uint32_t highWaterMark = highWaterMarks[level].load(std::memory_order_relaxed);
+		while ((occupancy > highWaterMark)
+				&& (!highWaterMarks[level].compare_exchange_weak(highWaterMark, occupancy, std::memory_order_relaxed))) {
+		}
+		return true;
+	}
+
+	// The overflow slot holds the newest command for the level, so it is only taken once everything in the ring has been.  A pop can fail
+	// while a producer is still writing the oldest command, so the ring must also be empty.
+	if ((!overflowPending[level].load(std::memory_order_acquire)) || (rings[level]->getOccupancy() > 0)) {
+		return false;
+	}
+	if (implementation != LOCKED_COMMAND_QUEUE) {
+		queueMutex.lock();
+	}
+	envelope = overflowSlots[level];
+	overflowPending[level].store(false, std::memory_order_relaxed);
+	if (implementation != LOCKED_COMMAND_QUEUE) {
+		queueMutex.unlock();
+	}
+	return true;
+}
+
+/**
+ * This method will pop the oldest command from the highest priority ring which is not empty.
+ * @param envelope This is the location into which the command is written.
+ * @return The priority level the command was popped from, or -1 if every ring was empty.
+ */
+int CommandQueue::popHighestRing(CommandEnvelope &envelope) {
+	for (int level = 0; level < priorityLevels; level++) {
+		if (popLevel(level, envelope)) {
+			notifySpace(level);
+			return level;
+		}
+	}
+	return -1;
+}
+
+/**
+ * This method will pop the oldest command from the highest priority level which is not empty.  The queue mutex must be held.
+ * @param envelope This is the location into which the command is written.
+ * @return The priority level the command was popped from, or -1 if every level was empty.
+ */
+int CommandQueue::popHighestLocked(CommandEnvelope &envelope) {
+	for (int level = 0; level < priorityLevels; level++) {
+		if (popLevel(level, envelope)) {
+			return level;
+		}
+	}
+	return -1;
+}
+
+/**
+ * This method will take the next command from the queue, waiting for one to arrive if the queue is empty.
+ * @param envelope This is the location into which the command is written.
+ * @param timeout This is the maximum time to wait, in nanoseconds.  0 does not wait, and a negative value waits with no timeout.
+ * @return The priority level the command was taken from, or -1 if the timeout expired with the queue still empty.
+ */
+int CommandQueue::takeNext(CommandEnvelope &envelope, int64_t timeout) {
+	int level;
+
+	if (implementation == LOCKED_COMMAND_QUEUE) {
+		// 1.0 A locked queue waits on the semaphore, which counts the commands across every level.
+		int result;
+		if (timeout == 0) {
+			result = sem_trywait(&queueCountSemaphore);
+		} else if (timeout < 0) {
+			do {
+				result = sem_wait(&queueCountSemaphore);
+			} while ((result != 0) && (errno == EINTR));
+		} else {
+			// sem_timedwait would take its deadline on the realtime clock, which a clock step stretches or cuts short.  Instead, wait on
+			// the item event, which is timed on the monotonic clock, registering before each check so that a post is never missed.
+			int64_t deadline = getMonotonicTimeNs() + timeout;
+			while (true) {
+				uint32_t key = itemAvailable.prepareWait();
+				result = sem_trywait(&queueCountSemaphore);
+				if (result == 0) {
+					break;
+				}
+				int64_t remaining = deadline - getMonotonicTimeNs();
+				if (remaining <= 0) {
+					break;
+				}
+				itemAvailable.wait(key, remaining);
+			}
+		}
+
+		if (result != 0) {
+			return -1;
+		}
+
+		// A command is now reserved for this caller, so remove it.
+		queueMutex.lock();
+		level = popHighestLocked(envelope);
+		queueMutex.unlock();
+		if (level >= 0) {
+			notifySpace(level);
+		}
+		return level;
+	}
+
+	// 2.0 Take a command straight away if there is one, which avoids reading the clock.
+	level = popHighestRing(envelope);
+	if ((level >= 0) || (timeout == 0)) {
+		return level;
+	}
+
+	int64_t deadline = getMonotonicTimeNs() + timeout;
+
+	while (true) {
+		// 3.0 Register as a waiter before checking again, so a command pushed after the check wakes the wait below.
+		uint32_t key = itemAvailable.prepareWait();
+
+		level = popHighestRing(envelope);
+		if (level >= 0) {
+			return level;
+		}
+
+		// 4.0 Work out how much of the timeout remains, and give up if none does.
+		int64_t remaining = -1;
+		if (timeout > 0) {
+			remaining = deadline - getMonotonicTimeNs();
+			if (remaining <= 0) {
+				return -1;
+			}
+		}
+
+		// 5.0 Block until a producer pushes a command.
+		itemAvailable.wait(key, remaining);
+	}
+}
+
+/**
+ * This method will check a command which has just been taken from the queue.
+ * @param envelope This is the command.  Its command word is updated if it was coalesced.
+ * @param level This is the priority level it was taken from.
+ * @return true if the command is to be processed.  False if it was discarded.
+ */
+bool CommandQueue::acceptCommand(CommandEnvelope &envelope, int level) {
+	int key = coalescingKey(envelope.command);
+	if (key >= 0) {
+		// The place in the queue stands for the slot, so act on whatever was written to the slot last.  The slot is released before it is
+		// read, so a command written after the read gets a new place in the queue rather than being lost.
+		coalescingSlots[key].pending.exchange(false, std::memory_order_acq_rel);
+		uint64_t latest = coalescingSlots[key].latest.load(std::memory_order_acquire);
+		envelope.command = (int) (uint32_t) (latest >> 32);
+		envelope.generation = (uint32_t) latest;
+	}
+
+	// A motion command which was queued before the latest safety command has been overridden by it.
+	if ((flushSuperseded) && (level == MOTION_COMMAND_PRIORITY)
+			&& (envelope.generation != safetyGeneration.load(std::memory_order_acquire))) {
+		flushedCounts[level].fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	envelope.dequeueTime = getMonotonicTimeNs();
+	queueDelayHistograms[level].record((envelope.dequeueTime - envelope.enqueueTime) / 1000);
+	return true;
+}
+
+/**
+ * This method will dequeue the next command which is to be processed, discarding any superseded commands ahead of it.
+ * @param envelope This is the location into which the command is written.
+ * @param timeout This is the maximum time to wait, in nanoseconds.  0 does not wait, and a negative value waits with no timeout.
+ * @return true if a command was dequeued.  False if the timeout expired first.
+ */
+bool CommandQueue::dequeueCommand(CommandEnvelope &envelope, int64_t timeout) {
+	int64_t deadline = (timeout > 0) ? getMonotonicTimeNs() + timeout : 0;
+	int64_t remaining = timeout;
+
+	while (true) {
+		int level = takeNext(envelope, remaining);
+		if (level < 0) {
+			return false;
+		}
+		if (acceptCommand(envelope, level)) {
+			return true;
+		}
+
+		// The command was discarded, so wait for the next one within whatever remains of the timeout.
+		if (timeout > 0) {
+			remaining = deadline - getMonotonicTimeNs();
+			if (remaining <= 0) {
+				remaining = 0;
+			}
+		}
+	}
 }
 
 /**
@@ -31,7 +405,26 @@ CommandQueue::~CommandQueue() {
  * @return true if there is an item on the queue.  False otherwise.
  */
 bool CommandQueue::hasItem() {
-	return !commandQueueContents.empty();
+	bool retValue = false;
+
+	for (int level = 0; level < priorityLevels; level++) {
+		retValue = retValue || (rings[level]->getOccupancy() > 0) || (overflowPending[level].load(std::memory_order_acquire));
+	}
+	return retValue;
+}
+
+/**
+ * This method will return the number of commands waiting on the queue, over every priority level.  The count is a snapshot, which
+ * may already be out of date when it is returned.
+ * @return The number of commands waiting.
+ */
+uint32_t CommandQueue::getDepth() {
+	uint32_t depth = 0;
+
+	for (int level = 0; level < priorityLevels; level++) {
+		depth += rings[level]->getOccupancy() + (overflowPending[level].load(std::memory_order_acquire) ? 1 : 0);
+	}
+	return depth;
 }
 
 /**
@@ -39,23 +432,304 @@ bool CommandQueue::hasItem() {
  * @return The return will be the next command that is to be processed.
  */
 int CommandQueue::dequeue() {
-	sem_wait(&queueCountSemaphore);
+	CommandEnvelope envelope;
+	dequeueCommand(envelope, -1);
+	return envelope.command;
+}
+
+/**
+ * This method will dequeue the next command from the queue, waiting at most the given time for one to arrive.
+ * @param value This is the location into which the dequeued command is written.  It is not modified if no command arrives.
+ * @param timeout This is the maximum time to wait for a command, in microseconds.
+ * @return true if a command was dequeued.  False if the timeout expired with the queue still empty.
+ */
+bool CommandQueue::dequeueFor(int &value, uint32_t timeout) {
+	CommandEnvelope envelope;
+	if (dequeueFor(envelope, timeout)) {
+		value = envelope.command;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * This method will dequeue the next command from the queue, along with its envelope, waiting at most the given time for one to arrive.
+ * @param envelope This is the location into which the envelope of the dequeued command is written.
+ * @param timeout This is the maximum time to wait for a command, in microseconds.
+ * @return true if a command was dequeued.  False if the timeout expired with the queue still empty.
+ */
+bool CommandQueue::dequeueFor(CommandEnvelope &envelope, uint32_t timeout) {
+	// A zero timeout still waits for the shortest possible time, rather than turning into a try.
+	return dequeueCommand(envelope, (timeout > 0) ? ((int64_t) timeout) * 1000 : 1);
+}
+
+/**
+ * This method will dequeue the next command from the queue if one is present.  This method never blocks.
+ * @param value This is the location into which the dequeued command is written.  It is not modified if the queue is empty.
+ * @return true if a command was dequeued.  False if the queue was empty.
+ */
+bool CommandQueue::tryDequeue(int &value) {
+	CommandEnvelope envelope;
+	if (dequeueCommand(envelope, 0)) {
+		value = envelope.command;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * This method will remove every command that is currently on the queue, up to the given maximum, in priority order.
+ * @param buffer This is the array into which the envelopes of the dequeued commands are written.
+ * @param max This is the maximum number of commands that will be written into the buffer.
+ * @return The number of commands that were dequeued.
+ */
+int CommandQueue::drainTo(CommandEnvelope *buffer, int max) {
+	int count = 0;
+	int level;
+
+	if (implementation != LOCKED_COMMAND_QUEUE) {
+		while ((count < max) && ((level = popHighestRing(buffer[count])) >= 0)) {
+			// A discarded command leaves its entry in the buffer to be overwritten by the next one.
+			if (acceptCommand(buffer[count], level)) {
+				count++;
+			}
+		}
+		return count;
+	}
+
 	queueMutex.lock();
-	int retValue = commandQueueContents.front();
-	commandQueueContents.pop();
+	// Each command still has to be claimed from the semaphore so the count stays in step with the contents.
+	// A failed claim means another consumer has reserved the remaining commands, so stop there.
+	while ((count < max) && (sem_trywait(&queueCountSemaphore) == 0)) {
+		level = popHighestLocked(buffer[count]);
+		if (acceptCommand(buffer[count], level)) {
+			count++;
+		}
+	}
 	queueMutex.unlock();
 
-	return retValue;
+	for (level = 0; level < priorityLevels; level++) {
+		notifySpace(level);
+	}
+	return count;
 }
 
 /**
  * This method will enqueue a command on the queue.  Any number can be enqueued as a command.
  * Enqueueing a command will cause a thread blocked waiting for a command to be unblocked.
  * @param value This is the value that is to be enqueued.
+ * @param source This is where the command came from.  It is one of the COMMAND_SOURCE values.
+ */
+void CommandQueue::enqueue(int value, uint32_t source) {
+	CommandEnvelope envelope = CommandEnvelope();
+	envelope.command = value;
+	envelope.source = source;
+	enqueue(envelope);
+}
+
+/**
+ * This method will enqueue a command, along with the envelope it arrived in.
+ * @param incoming This is the envelope.  Its enqueue time is stamped by the queue, as is its receive time if that is 0.
+ */
+void CommandQueue::enqueue(const CommandEnvelope &incoming) {
+	CommandEnvelope envelope = incoming;
+	int value = envelope.command;
+	envelope.enqueueTime = getMonotonicTimeNs();
+	if (envelope.receiveTime == 0) {
+		envelope.receiveTime = envelope.enqueueTime;
+	}
+
+	int level = classify(value);
+	if ((flushSuperseded) && (level == SAFETY_COMMAND_PRIORITY)) {
+		// Start a new generation, which marks every motion command queued up to now as superseded.  The consumer discards them as it
+		// reaches them.
+		envelope.generation = safetyGeneration.fetch_add(1, std::memory_order_acq_rel) + 1;
+	} else {
+		envelope.generation = safetyGeneration.load(std::memory_order_acquire);
+	}
+
+	int key = coalescingKey(value);
+	if (key >= 0) {
+		// Overwrite the slot.  If it already has a place in the queue, the consumer will pick up this command when it gets there.
+		coalescingSlots[key].latest.store((((uint64_t) (uint32_t) value) << 32) | envelope.generation, std::memory_order_release);
+		if (coalescingSlots[key].pending.exchange(true, std::memory_order_acq_rel)) {
+			coalescedCounts[key].fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	if (implementation == LOCKED_COMMAND_QUEUE) {
+		pushLocked(envelope, level);
+	} else {
+		pushRing(envelope, level);
+	}
+}
+
+/**
+ * This method will push a command onto its level of a locked queue, applying the overflow policy if the level is full.
+ * @param envelope This is the command.
+ * @param level This is its priority level.
  */
-void CommandQueue::enqueue(int value) {
+void CommandQueue::pushLocked(const CommandEnvelope &envelope, int level) {
+	int policy = overflowPolicyFor(level);
+
 	queueMutex.lock();
-	commandQueueContents.push(value);
+
+	// 1.0 Once a level has overflowed, its commands replace the overflow slot until the consumer takes it, so that they stay in order.
+	if (overflowPending[level].load(std::memory_order_relaxed)) {
+		parkOverflow(envelope, level);
+		queueMutex.unlock();
+		return;
+	}
+
+	// 2.0 Apply the overflow policy for as long as the level is full.
+	while (!rings[level]->push(envelope)) {
+		highWaterMarks[level].store(rings[level]->getCapacity(), std::memory_order_relaxed);
+
+		if (policy == OVERFLOW_DROP_NEWEST) {
+			dropCommand(envelope, level);
+			queueMutex.unlock();
+			return;
+		} else if (policy == OVERFLOW_DROP_OLDEST) {
+			// The command replaces the oldest one, so the count on the semaphore is already right.
+			CommandEnvelope oldest;
+			rings[level]->pop(oldest);
+			dropCommand(oldest, level);
+			rings[level]->push(envelope);
+			queueMutex.unlock();
+			return;
+		} else if (policy == OVERFLOW_COALESCE) {
+			parkOverflow(envelope, level);
+			queueMutex.unlock();
+			return;
+		}
+
+		// The producer registers as a waiter before releasing the mutex, so a consumer which pops after that always wakes it.
+		uint32_t waitKey = spaceAvailable.prepareWait();
+		queueMutex.unlock();
+		blockedCounts[level].fetch_add(1, std::memory_order_relaxed);
+		spaceAvailable.wait(waitKey, -1);
+		queueMutex.lock();
+	}
+
+	// 3.0 Indicate that something has been enqueued through the semaphore, and wake a consumer waiting with a timeout.
 	sem_post(&queueCountSemaphore);
 	queueMutex.unlock();
+	itemAvailable.notify();
+}
+
+/**
+ * This method will push a command onto its level of a lock-free queue, applying the overflow policy if the level is full.
+ * @param envelope This is the command.
+ * @param level This is its priority level.
+ */
+void CommandQueue::pushRing(const CommandEnvelope &envelope, int level) {
+	int policy = overflowPolicyFor(level);
+
+	// 1.0 Once a level has overflowed, its commands replace the overflow slot until the consumer takes it, so that they stay in order.
+	// The mutex is only taken while the level is overflowing.
+	if (overflowPending[level].load(std::memory_order_acquire)) {
+		queueMutex.lock();
+		if (overflowPending[level].load(std::memory_order_relaxed)) {
+			parkOverflow(envelope, level);
+			queueMutex.unlock();
+			return;
+		}
+		queueMutex.unlock();
+	}
+
+	// 2.0 Apply the overflow policy for as long as the level is full.
+	while (!rings[level]->push(envelope)) {
+		highWaterMarks[level].store(rings[level]->getCapacity(), std::memory_order_relaxed);
+
+		if (policy == OVERFLOW_DROP_NEWEST) {
+			dropCommand(envelope, level);
+			return;
+		} else if (policy == OVERFLOW_DROP_OLDEST) {
+			// Another producer may take the freed slot first, in which case this goes round again.
+			CommandEnvelope oldest;
+			if (rings[level]->pop(oldest)) {
+				dropCommand(oldest, level);
+			}
+		} else if (policy == OVERFLOW_COALESCE) {
+			queueMutex.lock();
+			bool parked = !rings[level]->push(envelope);
+			if (parked) {
+				parkOverflow(envelope, level);
+			}
+			queueMutex.unlock();
+			if (parked) {
+				return;
+			}
+			break;
+		} else {
+			// Wait for the consumer to make room.  The same check and wait pattern as the consumer's is used, so the wakeup for a freed
+			// slot cannot be missed.
+			uint32_t waitKey = spaceAvailable.prepareWait();
+			if (rings[level]->push(envelope)) {
+				break;
+			}
+			blockedCounts[level].fetch_add(1, std::memory_order_relaxed);
+			spaceAvailable.wait(waitKey, -1);
+		}
+	}
+
+	// 3.0 Wake the consumer if it is waiting.
+	itemAvailable.notify();
+}
+
+/**
+ * This method will print the number of commands dequeued and flushed, and the queueing delay percentiles, for each priority level.
+ * @param os This is the stream that the statistics are to be printed to.
+ * @param queueName This is the name of the queue, which starts each line.
+ */
+void CommandQueue::printStatistics(std::ostream &os, const std::string &queueName) {
+	for (int level = 0; level < priorityLevels; level++) {
+		os << std::setw(18) << queueName << "\t" << std::setw(8) << ((priorityLevels > 1) ? priorityLevelNames[level] : "All") << "\t"
+				<< std::setw(8) << queueDelayHistograms[level].getCount() << "\t" << std::setw(8)
+				<< flushedCounts[level].load(std::memory_order_relaxed) << "\t";
+		queueDelayHistograms[level].printPercentiles(os);
+		os << "\n";
+	}
+
+	if (coalescer != NULL) {
+		os << std::setw(18) << queueName << "\tCoalesced";
+		for (int key = 0; key < COMMAND_COALESCING_KEYS; key++) {
+			os << "\t" << coalescingKeyNames[key] << " " << coalescedCounts[key].load(std::memory_order_relaxed);
+		}
+		os << "\n";
+	}
+}
+
+/**
+ * This method will print the header line which matches the lines printed by printStatistics.
+ * @param os This is the stream that the header is to be printed to.
+ */
+void CommandQueue::printStatisticsHeader(std::ostream &os) {
+	os << "Queue             \tPriority\tDequeued\t Flushed\t     p50\t     p90\t     p99\t   p99.9\t     max\n";
+}
+
+/**
+ * This method will print the capacity, high water mark, dropped and blocked counts, and the occupancy percentiles for each priority level.
+ * @param os This is the stream that the statistics are to be printed to.
+ * @param queueName This is the name of the queue, which starts each line.
+ */
+void CommandQueue::printBackpressureStatistics(std::ostream &os, const std::string &queueName) {
+	for (int level = 0; level < priorityLevels; level++) {
+		os << std::setw(18) << queueName << "\t" << std::setw(8) << ((priorityLevels > 1) ? priorityLevelNames[level] : "All") << "\t"
+				<< std::setw(8) << rings[level]->getCapacity() << "\t" << std::setw(8)
+				<< highWaterMarks[level].load(std::memory_order_relaxed) << "\t" << std::setw(8)
+				<< droppedCounts[level].load(std::memory_order_relaxed) << "\t" << std::setw(8)
+				<< blockedCounts[level].load(std::memory_order_relaxed) << "\t";
+		occupancyHistograms[level].printPercentiles(os);
+		os << "\n";
+	}
+}
+
+/**
+ * This method will print the header line which matches the lines printed by printBackpressureStatistics.
+ * @param os This is the stream that the header is to be printed to.
+ */
+void CommandQueue::printBackpressureHeader(std::ostream &os) {
+	os << "Queue             \tPriority\tCapacity\tHighMark\t Dropped\t Blocked\t     p50\t     p90\t     p99\t   p99.9\t     max\n";
 }
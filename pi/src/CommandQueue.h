@@ -22,7 +22,11 @@
  * @section DESCRIPTION
  * Function prototypes and class definitions for the command queue class.
  * This class, the CommandQueue, allows a user to enque a set of commands for a device. The commands must be sinple integers,
- * but they can have bitmapped representations.  The queue can hold as many items as is necessary.
+ * but they can have bitmapped representations.
+ * The implementation is picked when the queue is constructed.  Every implementation holds each priority level in a ring which is
+ * allocated in full at construction, so the queue never grows.  The locked implementation guards its rings with a mutex and allows any
+ * number of consumers.  The lock-free implementations allow one consumer, which blocks on a futex rather than a semaphore, and no
+ * enqueue or dequeue takes a lock.  What happens to a command which finds its level full is set by the overflow policy.
  *
  * @author Walter Schilling (schilling@msoe.edu)
  * @bug No known bugs.
@@ -30,16 +34,26 @@
 
 #ifndef COMMANDQUEUE_H_
 #define COMMANDQUEUE_H_
-#include <queue>        /* Required for the queue data structure.*/
 #include <mutex>        /* Required for locking critical sections. */
 #include <semaphore.h>  /* required for semaphores */
+#include <stdint.h>     /* Required for the fixed width timeout type. */
+#include <atomic>
+#include <string>
+#include <ostream>
+#include "QueueCfg.h"
+#include "CommandEnvelope.h"
+#include "RingBuffer.h"
+#include "FutexEvent.h"
+#include "LatencyHistogram.h"
+
+/**
+ * This is the type of a command classifier.  A classifier maps a command onto the priority level it is to be queued at, where 0 is the
+ * highest priority.  The same type is used for a coalescer, which maps a command onto its coalescing key, or -1 if it is not coalesced.
+ */
+typedef int (*CommandClassifier)(int command);
 
 class CommandQueue {
 private:
-	/**
-	 * This attribute holds the contents of the queue.  Items are processed in FIFO order.
-	 */
-	std::queue<int> commandQueueContents;
 	/**
 	 * This is a counting semaphore which keeps track of how many items are on the queue.
 	 */
@@ -49,11 +63,245 @@ private:
 	 */
 	std::mutex queueMutex;
 
+	/**
+	 * This is the implementation used by the queue.  It is one of the command queue implementations defined in QueueCfg.h.
+	 */
+	int implementation;
+
+	/**
+	 * These are the rings which hold the contents of the queue, one per priority level.  The locked implementation only touches them
+	 * with the queue mutex held.
+	 */
+	RingBuffer *rings[COMMAND_PRIORITY_LEVELS] = {};
+
+	/**
+	 * This event is notified whenever a command is enqueued.  The consumer of a lock-free queue waits on it while the rings are empty, and
+	 * the consumer of a locked queue waits on it when it waits with a timeout, so that the timeout is kept on the monotonic clock.
+	 */
+	FutexEvent itemAvailable;
+
+	/**
+	 * This event is notified when the consumer has drained a ring to half full.  Producers wait on it while a ring is full.
+	 */
+	FutexEvent spaceAvailable;
+
+	/**
+	 * This is what happens to a command which finds its priority level full.  It is one of the overflow policies in QueueCfg.h.
+	 */
+	int overflowPolicy;
+
+	/**
+	 * These are the overflow slots used by the coalescing overflow policy, one per priority level.  Once a level is full, its newest command
+	 * waits here, and each later command for the level replaces it until the consumer has emptied the ring and taken it.
+	 * They are guarded by the queue mutex.
+	 */
+	CommandEnvelope overflowSlots[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * These indicate that the overflow slot of a level holds a command.
+	 */
+	std::atomic<bool> overflowPending[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * This is the classifier which assigns commands to priority levels.  It is NULL if the queue has a single level.
+	 */
+	CommandClassifier classifier;
+
+	/**
+	 * This is the number of priority levels in use.  It is 1 for a queue without a classifier.
+	 */
+	int priorityLevels;
+
+	/**
+	 * This indicates whether a safety command discards the motion commands which were queued before it.
+	 */
+	bool flushSuperseded;
+
+	/**
+	 * This is the number of safety commands which have been enqueued.  Motion commands enqueued in an earlier generation are superseded.
+	 */
+	std::atomic<uint32_t> safetyGeneration;
+
+	/**
+	 * This structure is a coalescing slot, which holds the latest command for one key.
+	 */
+	struct CoalescingSlot {
+		/**
+		 * This is the latest command for the key in the upper 32 bits, and the safety generation it was enqueued in in the lower 32 bits.
+		 * Both are kept in one word so that the consumer always reads a matching pair.
+		 */
+		std::atomic<uint64_t> latest;
+		/**
+		 * This indicates that the slot has a place in the queue which the consumer has not yet reached.
+		 */
+		std::atomic<bool> pending;
+	};
+
+	/**
+	 * This is the coalescer which maps commands onto coalescing slots.  It is NULL if the queue does not coalesce.
+	 */
+	CommandClassifier coalescer;
+
+	/**
+	 * These are the coalescing slots, one per key.
+	 */
+	CoalescingSlot coalescingSlots[COMMAND_COALESCING_KEYS];
+
+	/**
+	 * These are the number of commands which were overwritten in their coalescing slot before the consumer reached them, per key.
+	 */
+	std::atomic<uint32_t> coalescedCounts[COMMAND_COALESCING_KEYS];
+
+	/**
+	 * These histograms hold the time, in microseconds, that each dequeued command waited on the queue, per priority level.
+	 * Only the consumer records into them.
+	 */
+	LatencyHistogram queueDelayHistograms[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * These are the number of commands which were discarded because they had been superseded, per priority level.
+	 */
+	std::atomic<uint32_t> flushedCounts[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * These are the number of commands which were lost because their level was full, per priority level.
+	 */
+	std::atomic<uint32_t> droppedCounts[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * These are the number of times a producer had to wait for room on a full level, per priority level.
+	 */
+	std::atomic<uint32_t> blockedCounts[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * These are the largest number of commands seen on each level at once.
+	 */
+	std::atomic<uint32_t> highWaterMarks[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * These histograms hold the number of commands on each level, sampled each time the consumer pops one.  Only the consumer, or a
+	 * consumer holding the queue mutex, records into them.
+	 */
+	LatencyHistogram occupancyHistograms[COMMAND_PRIORITY_LEVELS];
+
+	/**
+	 * This method will determine which priority level a command is to be queued at.
+	 * @param value This is the command.
+	 * @return The priority level, which is always within range for the queue.
+	 */
+	int classify(int value);
+
+	/**
+	 * This method will determine which coalescing slot a command belongs to.
+	 * @param value This is the command.
+	 * @return The coalescing key, or -1 if the command is not coalesced.
+	 */
+	int coalescingKey(int value);
+
+	/**
+	 * This method will determine the overflow policy for a priority level.
+	 * @param level This is the priority level.
+	 * @return The overflow policy.  A prioritized queue always blocks on a full safety level.
+	 */
+	int overflowPolicyFor(int level);
+
+	/**
+	 * This method will wake any producers which are blocked on a full ring, once the consumer has made enough room for them.
+	 * @param level This is the priority level of the ring which a command was popped from.
+	 */
+	void notifySpace(int level);
+
+	/**
+	 * This method will count a command which is lost because its level is full.  If the command held the place of a coalescing slot,
+	 * the slot is released so that the next command for its key is queued again.
+	 * @param envelope This is the command which is lost.
+	 * @param level This is its priority level.
+	 */
+	void dropCommand(const CommandEnvelope &envelope, int level);
+
+	/**
+	 * This method will put a command into the overflow slot of its level, replacing any command already there.  The queue mutex must be
+	 * held.
+	 * @param envelope This is the command.
+	 * @param level This is its priority level.
+	 */
+	void parkOverflow(const CommandEnvelope &envelope, int level);
+
+	/**
+	 * This method will pop the oldest command from one priority level, taking the overflow slot once the ring is empty.  For the locked
+	 * implementation, the queue mutex must be held.
+	 * @param level This is the priority level.
+	 * @param envelope This is the location into which the command is written.
+	 * @return true if a command was popped.  False if the level was empty.
+	 */
+	bool popLevel(int level, CommandEnvelope &envelope);
+
+	/**
+	 * This method will pop the oldest command from the highest priority ring which is not empty.
+	 * @param envelope This is the location into which the command is written.
+	 * @return The priority level the command was popped from, or -1 if every ring was empty.
+	 */
+	int popHighestRing(CommandEnvelope &envelope);
+
+	/**
+	 * This method will pop the oldest command from the highest priority level which is not empty.  The queue mutex must be held.
+	 * @param envelope This is the location into which the command is written.
+	 * @return The priority level the command was popped from, or -1 if every level was empty.
+	 */
+	int popHighestLocked(CommandEnvelope &envelope);
+
+	/**
+	 * This method will push a command onto its level of a locked queue, applying the overflow policy if the level is full.
+	 * @param envelope This is the command.
+	 * @param level This is its priority level.
+	 */
+	void pushLocked(const CommandEnvelope &envelope, int level);
+
+	/**
+	 * This method will push a command onto its level of a lock-free queue, applying the overflow policy if the level is full.
+	 * @param envelope This is the command.
+	 * @param level This is its priority level.
+	 */
+	void pushRing(const CommandEnvelope &envelope, int level);
+
+	/**
+	 * This method will take the next command from the queue, waiting for one to arrive if the queue is empty.
+	 * @param envelope This is the location into which the command is written.
+	 * @param timeout This is the maximum time to wait, in nanoseconds.  0 does not wait, and a negative value waits with no timeout.
+	 * @return The priority level the command was taken from, or -1 if the timeout expired with the queue still empty.
+	 */
+	int takeNext(CommandEnvelope &envelope, int64_t timeout);
+
+	/**
+	 * This method will check a command which has just been taken from the queue.  A coalesced command is replaced by the latest command
+	 * in its slot.  A superseded command is counted and discarded.  Otherwise, the time the command waited is recorded.
+	 * @param envelope This is the command.  Its command word is updated if it was coalesced.
+	 * @param level This is the priority level it was taken from.
+	 * @return true if the command is to be processed.  False if it was discarded.
+	 */
+	bool acceptCommand(CommandEnvelope &envelope, int level);
+
+	/**
+	 * This method will dequeue the next command which is to be processed, discarding any superseded commands ahead of it.
+	 * @param envelope This is the location into which the command is written.
+	 * @param timeout This is the maximum time to wait, in nanoseconds.  0 does not wait, and a negative value waits with no timeout.
+	 * @return true if a command was dequeued.  False if the timeout expired first.
+	 */
+	bool dequeueCommand(CommandEnvelope &envelope, int64_t timeout);
+
 public:
 	/**
-	 * This is the default constructor, which creates an instance of the queue.
+	 * This is the constructor, which creates an instance of the queue.
+	 * @param implementation This selects the implementation of the queue.  It is one of the command queue implementations in QueueCfg.h.
+	 * @param capacity This is the number of commands each priority level can hold.  It is rounded up to a power of two.
+	 * @param classifier This is the classifier which assigns commands to priority levels.  If it is NULL, the queue has a single level.
+	 * @param flushSuperseded If this is true, enqueueing a safety command discards the motion commands which were queued before it.
+	 * @param coalescer This is the coalescer which maps setpoint commands onto coalescing slots.  If it is NULL, nothing is coalesced.
+	 * @param overflowPolicy This is what happens to a command which finds its level full.  It is one of the overflow policies in
+	 * QueueCfg.h.
 	 */
-	CommandQueue();
+	CommandQueue(int implementation = LOCKED_COMMAND_QUEUE, uint32_t capacity = COMMAND_QUEUE_CAPACITY, CommandClassifier classifier = NULL,
+			bool flushSuperseded = false, CommandClassifier coalescer = NULL, int overflowPolicy = OVERFLOW_BLOCK);
 
 	/**
 	 * The virtual destructor, which deallocates any allocated resources.
@@ -66,18 +314,106 @@ public:
 	 */
 	bool hasItem();
 
+	/**
+	 * This method will return the number of commands waiting on the queue, over every priority level.  The count is a snapshot, which
+	 * may already be out of date when it is returned.
+	 * @return The number of commands waiting.
+	 */
+	uint32_t getDepth();
+
 	/**
 	 * This method will dequeue the next command from the queue.  This method will block if there are no items on the queue.
+	 * For a lock-free queue, it may only be called from the one consumer thread, as may the other dequeue methods.
 	 * @return The return will be the next command that is to be processed.
 	 */
 	int dequeue();
 
+	/**
+	 * This method will dequeue the next command from the queue, waiting at most the given time for one to arrive.
+	 * @param value This is the location into which the dequeued command is written.  It is not modified if no command arrives.
+	 * @param timeout This is the maximum time to wait for a command, in microseconds.
+	 * @return true if a command was dequeued.  False if the timeout expired with the queue still empty.
+	 */
+	bool dequeueFor(int &value, uint32_t timeout);
+
+	/**
+	 * This method will dequeue the next command from the queue, along with its envelope, waiting at most the given time for one to arrive.
+	 * The envelope is stamped with the dequeue time.
+	 * @param envelope This is the location into which the envelope of the dequeued command is written.
+	 * @param timeout This is the maximum time to wait for a command, in microseconds.
+	 * @return true if a command was dequeued.  False if the timeout expired with the queue still empty.
+	 */
+	bool dequeueFor(CommandEnvelope &envelope, uint32_t timeout);
+
+	/**
+	 * This method will dequeue the next command from the queue if one is present.  This method never blocks.
+	 * @param value This is the location into which the dequeued command is written.  It is not modified if the queue is empty.
+	 * @return true if a command was dequeued.  False if the queue was empty.
+	 */
+	bool tryDequeue(int &value);
+
+	/**
+	 * This method will determine whether a command is a safety command, which this queue's classifier places at the highest priority.
+	 * @param value This is the command.
+	 * @return true if the queue has a classifier and it classifies the command as a safety command.  False otherwise.
+	 */
+	bool isSafetyCommand(int value);
+
+	/**
+	 * This method will remove every command that is currently on the queue, up to the given maximum, in priority order.  A locked queue
+	 * is locked only once, so a consumer that wakes for one command can handle all of the commands that arrived with it in a single pass.
+	 * This method never blocks.  Each envelope is stamped with the dequeue time.
+	 * @param buffer This is the array into which the envelopes of the dequeued commands are written.
+	 * @param max This is the maximum number of commands that will be written into the buffer.
+	 * @return The number of commands that were dequeued.
+	 */
+	int drainTo(CommandEnvelope *buffer, int max);
+
 	/**
 	 * This method will enqueue a command on the queue.  Any number can be enqueued as a command.
 	 * Enqueueing a command will cause a thread blocked waiting for a command to be unblocked.
+	 * If the level of the command is full, the overflow policy decides whether this method blocks or a command is lost.  A single producer
+	 * queue may only be enqueued from one thread.
 	 * @param value This is the value that is to be enqueued.
+	 * @param source This is where the command came from.  It is one of the COMMAND_SOURCE values.
+	 */
+	void enqueue(int value, uint32_t source = COMMAND_SOURCE_UNKNOWN);
+
+	/**
+	 * This method will enqueue a command, along with the envelope it arrived in, so that its source, message ID and receive time travel
+	 * with it.  The queue stamps the enqueue time, and also the receive time if it is 0.
+	 * A coalesced command keeps the envelope of the first command in its slot, with the latest command word.
+	 * @param incoming This is the envelope of the command that is to be enqueued.
+	 */
+	void enqueue(const CommandEnvelope &incoming);
+
+	/**
+	 * This method will print the number of commands dequeued and flushed, and the queueing delay percentiles, for each priority level.
+	 * For a coalescing queue, it also prints how many commands were coalesced away for each key.
+	 * @param os This is the stream that the statistics are to be printed to.
+	 * @param queueName This is the name of the queue, which starts each line.
+	 */
+	void printStatistics(std::ostream &os, const std::string &queueName);
+
+	/**
+	 * This method will print the header line which matches the lines printed by printStatistics.
+	 * @param os This is the stream that the header is to be printed to.
+	 */
+	static void printStatisticsHeader(std::ostream &os);
+
+	/**
+	 * This method will print the capacity, high water mark, dropped and blocked counts, and the occupancy percentiles for each priority
+	 * level.
+	 * @param os This is the stream that the statistics are to be printed to.
+	 * @param queueName This is the name of the queue, which starts each line.
+	 */
+	void printBackpressureStatistics(std::ostream &os, const std::string &queueName);
+
+	/**
+	 * This method will print the header line which matches the lines printed by printBackpressureStatistics.
+	 * @param os This is the stream that the header is to be printed to.
 	 */
-	void enqueue(int value);
+	static void printBackpressureHeader(std::ostream &os);
 };
 
 #endif /* COMMANDQUEUE_H_ */
@@ -0,0 +1,152 @@
+/**
+ * @file Crc32c.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the table driven CRC32C implementations, and picks which implementation crc32c uses.
+ */
+
+#include "Crc32c.h"
+#include <string.h>
+
+/**
+ * This is the CRC32C polynomial, 0x1EDC6F41, with its bits reversed, as the CRC is calculated least significant bit first.
+ */
+#define CRC32C_POLYNOMIAL (0x82F63B78)
+
+/**
+ * This type is a CRC32C implementation.
+ */
+typedef uint32_t (*Crc32cImplementation)(const void *data, size_t length, uint32_t crc);
+
+/**
+ * This class holds the slice-by-8 tables.  Table 0 is the usual byte at a time table.  Table n gives the effect of a byte which is
+ * followed by n more bytes.  They are built once, by the constructor of the single static instance, before main runs.
+ */
+class Crc32cTables {
+public:
+	/**
+	 * These are the tables.
+	 */
+	uint32_t table[8][256];
+
+	/**
+	 * This is the implementation which crc32c uses.
+	 */
+	Crc32cImplementation implementation;
+
+	/**
+	 * This is the constructor, which builds the tables and picks the implementation.
+	 */
+	Crc32cTables() {
+		for (uint32_t value = 0; value < 256; value++) {
+			uint32_t crc = value;
+			for (int bit = 0; bit < 8; bit++) {
+				crc = (crc & 1) ? ((crc >> 1) ^ CRC32C_POLYNOMIAL) : (crc >> 1);
+			}
+			table[0][value] = crc;
+		}
+		for (uint32_t value = 0; value < 256; value++) {
+			for (int slice = 1; slice < 8; slice++) {
+				table[slice][value] = (table[slice - 1][value] >> 8) ^ table[0][table[slice - 1][value] & 0xFF];
+			}
+		}
+		implementation = crc32cHardwareAvailable() ? crc32cHardware : crc32cSliceBy8;
+	}
+};
+
+/**
+ * This is the single instance of the tables.
+ */
+static Crc32cTables tables;
+
+/**
+ * This method will calculate the CRC32C of a block of data with the fastest implementation the processor supports.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block, so that a CRC can be calculated in pieces.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32c(const void *data, size_t length, uint32_t crc) {
+	return tables.implementation(data, length, crc);
+}
+
+/**
+ * This method will calculate the CRC32C of a block of data one byte at a time, with a single 256 entry table.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32cBytewise(const void *data, size_t length, uint32_t crc) {
+	const uint8_t *bytes = (const uint8_t*) data;
+
+	crc = ~crc;
+	while (length-- > 0) {
+		crc = (crc >> 8) ^ tables.table[0][(crc ^ *bytes++) & 0xFF];
+	}
+	return ~crc;
+}
+
+/**
+ * This method will calculate the CRC32C of a block of data eight bytes at a time, with eight 256 entry tables.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32cSliceBy8(const void *data, size_t length, uint32_t crc) {
+	const uint8_t *bytes = (const uint8_t*) data;
+
+	crc = ~crc;
+
+	/**
+	 * 1.0 Handle single bytes until the data is aligned, so that the eight byte loads below are aligned.
+	 */
+	while ((length > 0) && (((uintptr_t) bytes & 7) != 0)) {
+		crc = (crc >> 8) ^ tables.table[0][(crc ^ *bytes++) & 0xFF];
+		length--;
+	}
+
+	/**
+	 * 2.0 Fold eight bytes at a time.  The first four are combined with the CRC, and each byte is looked up in the table for the
+	 * number of bytes which follow it.  This assumes a little endian processor, which the Raspberry Pi is.
+	 */
+	while (length >= 8) {
+		uint32_t low;
+		uint32_t high;
+		memcpy(&low, bytes, sizeof(low));
+		memcpy(&high, bytes + 4, sizeof(high));
+		low ^= crc;
+		crc = tables.table[7][low & 0xFF] ^ tables.table[6][(low >> 8) & 0xFF] ^ tables.table[5][(low >> 16) & 0xFF]
+				^ tables.table[4][low >> 24] ^ tables.table[3][high & 0xFF] ^ tables.table[2][(high >> 8) & 0xFF]
+				^ tables.table[1][(high >> 16) & 0xFF] ^ tables.table[0][high >> 24];
+		bytes += 8;
+		length -= 8;
+	}
+
+	/**
+	 * 3.0 Handle the bytes which are left over.
+	 */
+	while (length-- > 0) {
+		crc = (crc >> 8) ^ tables.table[0][(crc ^ *bytes++) & 0xFF];
+	}
+	return ~crc;
+}
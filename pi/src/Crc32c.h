@@ -0,0 +1,77 @@
+/**
+ * @file Crc32c.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines the CRC32C (Castagnoli) checksum used to protect network frames.  CRC32C detects every burst error of up to 32 bits
+ * and every error of an odd number of bits, which the XOR of the message words does not.  Three implementations are provided: a one
+ * byte at a time table, slice-by-8, which processes eight bytes per step with eight tables, and the CRC32 instructions of ARMv8 (or
+ * SSE4.2 on a development host).  crc32c picks the fastest one the processor supports.
+ */
+#ifndef CRC32C_H_
+#define CRC32C_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * This method will calculate the CRC32C of a block of data with the fastest implementation the processor supports.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block, so that a CRC can be calculated in pieces.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32c(const void *data, size_t length, uint32_t crc = 0);
+
+/**
+ * This method will calculate the CRC32C of a block of data one byte at a time, with a single 256 entry table.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32cBytewise(const void *data, size_t length, uint32_t crc = 0);
+
+/**
+ * This method will calculate the CRC32C of a block of data eight bytes at a time, with eight 256 entry tables.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32cSliceBy8(const void *data, size_t length, uint32_t crc = 0);
+
+/**
+ * This method will calculate the CRC32C of a block of data with the processor's CRC32 instructions.  It must only be called if
+ * crc32cHardwareAvailable returns true.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32cHardware(const void *data, size_t length, uint32_t crc = 0);
+
+/**
+ * This method will determine whether the processor has CRC32C instructions, and this build is able to use them.
+ * @return true if crc32cHardware can be called.  False otherwise.
+ */
+bool crc32cHardwareAvailable();
+
+#endif /* CRC32C_H_ */
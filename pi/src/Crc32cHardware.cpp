@@ -0,0 +1,146 @@
+/**
+ * @file Crc32cHardware.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements CRC32C with the processor's CRC32 instructions.  On ARM it is compiled with the ARMv8 CRC extension enabled, and
+ * contains nothing else, so that no other code is built for instructions an older processor might lack.  The instructions are only used
+ * once the kernel has reported that the processor has them.
+ */
+
+#include "Crc32c.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+
+/**
+ * This method will determine whether the processor has CRC32C instructions, and this build is able to use them.
+ * @return true if crc32cHardware can be called.  False otherwise.
+ */
+bool crc32cHardwareAvailable() {
+#if defined(__aarch64__)
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+	return (getauxval(AT_HWCAP2) & HWCAP2_CRC32) != 0;
+#endif
+}
+
+/**
+ * This method will calculate the CRC32C of a block of data with the processor's CRC32 instructions.  It must only be called if
+ * crc32cHardwareAvailable returns true.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32cHardware(const void *data, size_t length, uint32_t crc) {
+	const uint8_t *bytes = (const uint8_t*) data;
+
+	crc = ~crc;
+	while ((length > 0) && (((uintptr_t) bytes & 7) != 0)) {
+		crc = __crc32cb(crc, *bytes++);
+		length--;
+	}
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		crc = __crc32cd(crc, word);
+		bytes += 8;
+		length -= 8;
+	}
+	while (length-- > 0) {
+		crc = __crc32cb(crc, *bytes++);
+	}
+	return ~crc;
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+/**
+ * This method will determine whether the processor has CRC32C instructions, and this build is able to use them.
+ * @return true if crc32cHardware can be called.  False otherwise.
+ */
+bool crc32cHardwareAvailable() {
+	// This may be called from a static constructor, before the compiler's own processor detection has run.
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+
+/**
+ * This method will calculate the CRC32C of a block of data with the processor's CRC32 instructions.  It must only be called if
+ * crc32cHardwareAvailable returns true.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+__attribute__((target("sse4.2"))) uint32_t crc32cHardware(const void *data, size_t length, uint32_t crc) {
+	const uint8_t *bytes = (const uint8_t*) data;
+
+	crc = ~crc;
+	while ((length > 0) && (((uintptr_t) bytes & 7) != 0)) {
+		crc = _mm_crc32_u8(crc, *bytes++);
+		length--;
+	}
+#if defined(__x86_64__)
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		crc = (uint32_t) _mm_crc32_u64(crc, word);
+		bytes += 8;
+		length -= 8;
+	}
+#endif
+	while (length-- > 0) {
+		crc = _mm_crc32_u8(crc, *bytes++);
+	}
+	return ~crc;
+}
+
+#else
+
+/**
+ * This method will determine whether the processor has CRC32C instructions, and this build is able to use them.
+ * @return false, as this build has no CRC32C instructions to use.
+ */
+bool crc32cHardwareAvailable() {
+	return false;
+}
+
+/**
+ * This method will calculate the CRC32C of a block of data.  There are no CRC32C instructions in this build, so it uses slice-by-8.
+ * @param data This is the data.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the CRC of any data which came before this block.  It is 0 to start.
+ * @return The CRC32C of the data.
+ */
+uint32_t crc32cHardware(const void *data, size_t length, uint32_t crc) {
+	return crc32cSliceBy8(data, length, crc);
+}
+
+#endif
@@ -0,0 +1,326 @@
+/**
+ * @file CyclicExecutive.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the cyclic executive, which multiplexes many periodic tasks onto a single real time thread.
+ */
+
+#include "CyclicExecutive.h"
+#include "TaskRates.h"
+#include "Clock.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <stdio.h>
+#include <unistd.h>
+
+/**
+ * This method will compute the greatest common divisor of two numbers.
+ * @param a This is the first number.
+ * @param b This is the second number.
+ * @return The greatest common divisor will be returned.
+ */
+static uint64_t greatestCommonDivisor(uint64_t a, uint64_t b) {
+	while (b != 0) {
+		uint64_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/**
+ * This method will determine the order that tasks run in within a minor frame.  Higher priority tasks run first.  Tasks of equal priority are
+ * run in rate monotonic order, with the shortest period first.
+ * @param a This is the first task.
+ * @param b This is the second task.
+ * @return true if a is to run before b.
+ */
+static bool runsBefore(PeriodicTask *a, PeriodicTask *b) {
+	if (a->getPriority() != b->getPriority()) {
+		return a->getPriority() > b->getPriority();
+	}
+	return a->getTaskPeriod() < b->getTaskPeriod();
+}
+
+/**
+ * This is the constructor for the cyclic executive.
+ * @param threadName This is the name of the executive thread in a human readable format.
+ * @param minorFrameQuantum This is the quantum, in microseconds, that task periods are rounded up to.
+ * @param pinnedCPU This is the CPU that the executive is to run on.  A negative value leaves the affinity alone, as does a CPU which is
+ * not online, which is reported.
+ */
+CyclicExecutive::CyclicExecutive(std::string threadName, uint32_t minorFrameQuantum, int pinnedCPU) :
+		RunnableClass(threadName) {
+	if (minorFrameQuantum == 0) {
+		minorFrameQuantum = 1;
+	}
+	this->minorFrameQuantum = minorFrameQuantum;
+	if ((pinnedCPU >= 0) && (pinnedCPU < 32) && (pinnedCPU < sysconf(_SC_NPROCESSORS_ONLN))) {
+		setAffinity(1U << pinnedCPU);
+	} else if (pinnedCPU >= 0) {
+		printf("Cyclic executive: CPU %d is not online, so %s is not pinned.\n", pinnedCPU, threadName.c_str());
+	}
+	taskSetChanged = false;
+	frameOverrunCount = 0;
+	skippedFrameCount = 0;
+}
+
+/**
+ * This is the destructor for the cyclic executive.
+ */
+CyclicExecutive::~CyclicExecutive() {
+	/**
+	 * Nothing to be done in the destructor.  The executive does not own the tasks.
+	 */
+}
+
+/**
+ * This method will register a periodic task with the executive.  It may be called from any thread.  The task will be placed into the
+ * frame table at the start of the next minor frame.
+ * @param task This is the task that is to be multiplexed.
+ */
+void CyclicExecutive::registerTask(PeriodicTask *task) {
+	std::lock_guard<std::mutex> guard(pendingTaskMutex);
+	pendingTasks.push_back(task);
+	taskSetChanged = true;
+}
+
+/**
+ * This method will mark the given task as no longer running on this executive.
+ * @param task This is the task that is to be released.
+ */
+void CyclicExecutive::releaseTask(PeriodicTask *task) {
+	task->runStarted = false;
+	task->runCompleted = true;
+}
+
+/**
+ * This method will move newly registered tasks into the active list and remove tasks which have been stopped.
+ * @return true if the set of active tasks changed.
+ */
+bool CyclicExecutive::updateActiveTasks() {
+	bool changed = false;
+
+	/**
+	 * 1.0 Move the pending tasks into the active list.  They run on this thread, so they take on its thread id.
+	 */
+	{
+		std::lock_guard<std::mutex> guard(pendingTaskMutex);
+		for (std::vector<PeriodicTask*>::iterator it = pendingTasks.begin(); it != pendingTasks.end(); it++) {
+			(*it)->myOSThreadID = myOSThreadID;
+			activeTasks.push_back(*it);
+			changed = true;
+		}
+		pendingTasks.clear();
+	}
+
+	/**
+	 * 2.0 Remove any task which has been stopped.
+	 */
+	std::vector<PeriodicTask*>::iterator it = activeTasks.begin();
+	while (it != activeTasks.end()) {
+		if ((*it)->keepGoing == false) {
+			releaseTask(*it);
+			it = activeTasks.erase(it);
+			changed = true;
+		} else {
+			it++;
+		}
+	}
+	return changed;
+}
+
+/**
+ * This method will rebuild the frame table from the active tasks.  The minor frame is the greatest common divisor of the task periods
+ * and the major frame is their least common multiple, after the periods have been rounded up to the quantum.
+ */
+void CyclicExecutive::buildFrameTable() {
+	FrameSizes sizes;
+
+	frameTable.clear();
+	minorFrameLength = 0;
+	minorFramesPerMajorFrame = 0;
+
+	if (activeTasks.empty()) {
+		sizes.minorFrameLength = 0;
+		sizes.minorFramesPerMajorFrame = 0;
+		publishedFrameSizes.store(sizes);
+		return;
+	}
+
+	/**
+	 * 1.0 Sort the tasks into the order that they run within a minor frame.
+	 */
+	std::vector<PeriodicTask*> orderedTasks = activeTasks;
+	std::stable_sort(orderedTasks.begin(), orderedTasks.end(), runsBefore);
+
+	/**
+	 * 2.0 Round each period up to the quantum, so that a task never runs faster than it asked to, and find the gcd and lcm of the periods.
+	 */
+	std::vector<uint64_t> periodInQuanta;
+	uint64_t gcd = 0;
+	uint64_t lcm = 1;
+	for (std::vector<PeriodicTask*>::iterator it = orderedTasks.begin(); it != orderedTasks.end(); it++) {
+		uint64_t quanta = ((*it)->getTaskPeriod() + minorFrameQuantum - 1) / minorFrameQuantum;
+		if (quanta == 0) {
+			quanta = 1;
+		}
+		periodInQuanta.push_back(quanta);
+		gcd = greatestCommonDivisor(gcd, quanta);
+		lcm = (lcm / greatestCommonDivisor(lcm, quanta)) * quanta;
+		if (lcm > CYCLIC_EXECUTIVE_MAX_MINOR_FRAMES * gcd) {
+			lcm = CYCLIC_EXECUTIVE_MAX_MINOR_FRAMES * gcd;
+		}
+	}
+
+	minorFrameLength = gcd * minorFrameQuantum;
+	minorFramesPerMajorFrame = lcm / gcd;
+	if (minorFramesPerMajorFrame >= CYCLIC_EXECUTIVE_MAX_MINOR_FRAMES) {
+		printf("Cyclic executive: the major frame has been limited to %d minor frames.  Some task rates will be irregular.\n",
+				CYCLIC_EXECUTIVE_MAX_MINOR_FRAMES);
+	}
+
+	/**
+	 * 3.0 Fill in the frame table.  A task is released in every minor frame that is a multiple of its period.
+	 */
+	frameTable.resize(minorFramesPerMajorFrame);
+	for (uint32_t frame = 0; frame < minorFramesPerMajorFrame; frame++) {
+		for (uint32_t index = 0; index < orderedTasks.size(); index++) {
+			if ((frame % (periodInQuanta[index] / gcd)) == 0) {
+				frameTable[frame].push_back(orderedTasks[index]);
+			}
+		}
+	}
+
+	/**
+	 * 4.0 Publish the frame sizes for the other threads to read.
+	 */
+	sizes.minorFrameLength = minorFrameLength;
+	sizes.minorFramesPerMajorFrame = minorFramesPerMajorFrame;
+	publishedFrameSizes.store(sizes);
+
+	std::cout << "Cyclic executive: " << orderedTasks.size() << " tasks, minor frame " << minorFrameLength
+			<< " us, major frame " << ((uint64_t) minorFrameLength * minorFramesPerMajorFrame) << " us ("
+			<< minorFramesPerMajorFrame << " minor frames).\n";
+}
+
+/**
+ * This is the run method for the executive.  It dispatches the tasks in the frame table until the executive is stopped.
+ */
+void CyclicExecutive::run() {
+	int64_t frameStart = Clock::getClock()->now();
+	uint32_t frameIndex = 0;
+
+	/**
+	 * 1.0 Dispatch minor frames until the executive is stopped.
+	 */
+	while (keepGoing) {
+		/**
+		 * 1.1 If tasks have been registered or stopped, rebuild the frame table and start a new major frame.
+		 */
+		if (taskSetChanged.exchange(false)) {
+			if (updateActiveTasks()) {
+				buildFrameTable();
+				frameIndex = 0;
+			}
+		}
+
+		int64_t minorFrameNs = ((int64_t) minorFrameQuantum) * 1000;
+
+		if (minorFramesPerMajorFrame > 0) {
+			/**
+			 * 1.2 Run every task that is released in this minor frame, back to back.  All of them were scheduled for the start of the frame.
+			 */
+			std::vector<PeriodicTask*> &frame = frameTable[frameIndex];
+			for (std::vector<PeriodicTask*>::iterator it = frame.begin(); it != frame.end(); it++) {
+				if ((*it)->keepGoing) {
+					(*it)->executeRelease(frameStart);
+				} else {
+					taskSetChanged = true;
+				}
+			}
+			minorFrameNs = ((int64_t) minorFrameLength) * 1000;
+			frameIndex = (frameIndex + 1) % minorFramesPerMajorFrame;
+		}
+
+		/**
+		 * 1.3 Determine when the next minor frame starts.  If this frame ran past it, skip the frames which have already been missed.
+		 */
+		frameStart += minorFrameNs;
+		int64_t end = Clock::getClock()->now();
+		if (end > frameStart) {
+			int64_t missedFrames = ((end - frameStart) / minorFrameNs) + 1;
+			frameOverrunCount.fetch_add(1, std::memory_order_relaxed);
+			skippedFrameCount.fetch_add((uint32_t) missedFrames, std::memory_order_relaxed);
+			frameStart += missedFrames * minorFrameNs;
+			if (minorFramesPerMajorFrame > 0) {
+				frameIndex = (frameIndex + missedFrames) % minorFramesPerMajorFrame;
+			}
+		}
+
+		/**
+		 * 1.4 Sleep until the start of the next minor frame.
+		 */
+		Clock::getClock()->sleepUntil(frameStart);
+	}
+
+	/**
+	 * 2.0 The executive is shutting down, so none of the tasks will run again.  Release all of them.
+	 */
+	updateActiveTasks();
+	for (std::vector<PeriodicTask*>::iterator it = activeTasks.begin(); it != activeTasks.end(); it++) {
+		releaseTask(*it);
+	}
+	activeTasks.clear();
+}
+
+/**
+ * This method will determine whether the thread of the executive takes part in the clock.  The executive only waits on the clock, so it does.
+ * @return true will be returned.
+ */
+bool CyclicExecutive::isClockParticipant() {
+	return true;
+}
+
+/**
+ * This method will print out information about the executive, including the frame sizes and the number of frame overruns.  The frame
+ * sizes are read from their published copy, as the executive thread may be rebuilding the frame table.
+ */
+void CyclicExecutive::printInformation() {
+	FrameSizes sizes = publishedFrameSizes.load();
+
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t "
+			<< std::setw(5) << getPriority() << "\t " << std::setw(10)
+			<< sizes.minorFrameLength << "\t Major frame(us): "
+			<< ((uint64_t) sizes.minorFrameLength * sizes.minorFramesPerMajorFrame)
+			<< "\t Frame overruns: " << frameOverrunCount.load(std::memory_order_relaxed)
+			<< "\t Skipped frames: " << skippedFrameCount.load(std::memory_order_relaxed) << "\n";
+}
+
+/**
+ * This method will reset the frame overrun diagnostics back to their default values.
+ */
+void CyclicExecutive::resetThreadDiagnostics() {
+	frameOverrunCount.store(0, std::memory_order_relaxed);
+	skippedFrameCount.store(0, std::memory_order_relaxed);
+}
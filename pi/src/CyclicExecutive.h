@@ -0,0 +1,178 @@
+/**
+ * @file CyclicExecutive.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines a cyclic executive.  The cyclic executive multiplexes many periodic tasks onto a single real time thread.  It builds a
+ *      table of minor frames covering one major frame from the task periods, and in each minor frame it runs the task methods which are due back
+ *      to back.  This avoids the context switches of giving every short periodic task its own thread.
+ */
+
+#ifndef CYCLICEXECUTIVE_H_
+#define CYCLICEXECUTIVE_H_
+
+#include "RunnableClass.h"
+#include "PeriodicTask.h"
+#include "SeqLockSnapshot.h"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+class CyclicExecutive: public RunnableClass {
+private:
+	/**
+	 * This structure holds the sizes of the frames, so that they can be published together.
+	 */
+	struct FrameSizes {
+		/**
+		 * This is the length of the minor frame, in microseconds.
+		 */
+		uint32_t minorFrameLength;
+
+		/**
+		 * This is the number of minor frames in one major frame.
+		 */
+		uint32_t minorFramesPerMajorFrame;
+	};
+
+	/**
+	 * This is the quantum, in microseconds, that task periods are rounded up to.  The minor frame is always a multiple of the quantum.
+	 */
+	uint32_t minorFrameQuantum;
+
+	/**
+	 * This is the length of the minor frame, in microseconds.  It and the number of minor frames are only used by the executive thread.
+	 */
+	uint32_t minorFrameLength = 0;
+
+	/**
+	 * This is the number of minor frames in one major frame.
+	 */
+	uint32_t minorFramesPerMajorFrame = 0;
+
+	/**
+	 * This is the latest consistent copy of the frame sizes.  It is published by the executive thread whenever the frame table is rebuilt,
+	 * and is what every other thread reads.
+	 */
+	SeqLockSnapshot<FrameSizes> publishedFrameSizes;
+
+	/**
+	 * This is the frame table.  Entry n holds the tasks that are released at the start of minor frame n, in the order they are to run.
+	 */
+	std::vector<std::vector<PeriodicTask*> > frameTable;
+
+	/**
+	 * These are the tasks that are currently being multiplexed.  This list is only used by the executive thread.
+	 */
+	std::vector<PeriodicTask*> activeTasks;
+
+	/**
+	 * These are tasks which have been registered but not yet placed into the frame table.
+	 */
+	std::vector<PeriodicTask*> pendingTasks;
+
+	/**
+	 * This mutex protects the pending task list, as tasks can be registered from any thread.
+	 */
+	std::mutex pendingTaskMutex;
+
+	/**
+	 * This flag is set when the set of tasks has changed and the frame table needs to be rebuilt.
+	 */
+	std::atomic<bool> taskSetChanged;
+
+	/**
+	 * This is the number of minor frames which ran past the start of the next minor frame.  It is atomic so that it can be read and reset
+	 * from the console while the executive is running.
+	 */
+	std::atomic<uint32_t> frameOverrunCount;
+
+	/**
+	 * This is the number of minor frames which were skipped because an earlier frame ran too long.
+	 */
+	std::atomic<uint32_t> skippedFrameCount;
+
+	/**
+	 * This method will rebuild the frame table from the active tasks.  The minor frame is the greatest common divisor of the task periods
+	 * and the major frame is their least common multiple, after the periods have been rounded up to the quantum.
+	 */
+	void buildFrameTable();
+
+	/**
+	 * This method will move newly registered tasks into the active list and remove tasks which have been stopped.
+	 * @return true if the set of active tasks changed.
+	 */
+	bool updateActiveTasks();
+
+	/**
+	 * This method will mark the given task as no longer running on this executive.
+	 * @param task This is the task that is to be released.
+	 */
+	void releaseTask(PeriodicTask *task);
+
+protected:
+	/**
+	 * This method will determine whether the thread of the executive takes part in the clock.  The executive only waits on the clock, so it does.
+	 * @return true will be returned.
+	 */
+	virtual bool isClockParticipant();
+
+public:
+	/**
+	 * This is the constructor for the cyclic executive.
+	 * @param threadName This is the name of the executive thread in a human readable format.
+	 * @param minorFrameQuantum This is the quantum, in microseconds, that task periods are rounded up to.
+	 * @param pinnedCPU This is the CPU that the executive is to run on.  A negative value leaves the affinity alone, as does a CPU which is
+	 * not online, which is reported.
+	 */
+	CyclicExecutive(std::string threadName, uint32_t minorFrameQuantum, int pinnedCPU);
+
+	/**
+	 * This is the destructor for the cyclic executive.
+	 */
+	virtual ~CyclicExecutive();
+
+	/**
+	 * This method will register a periodic task with the executive.  It may be called from any thread.  The task will be placed into the
+	 * frame table at the start of the next minor frame.
+	 * @param task This is the task that is to be multiplexed.
+	 */
+	void registerTask(PeriodicTask *task);
+
+	/**
+	 * This is the run method for the executive.  It dispatches the tasks in the frame table until the executive is stopped.
+	 */
+	void run();
+
+	/**
+	 * This method will print out information about the executive, including the frame sizes and the number of frame overruns.
+	 */
+	virtual void printInformation();
+
+	/**
+	 * This method will reset the frame overrun diagnostics back to their default values.
+	 */
+	virtual void resetThreadDiagnostics();
+};
+
+#endif /* CYCLICEXECUTIVE_H_ */
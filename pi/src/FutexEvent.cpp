@@ -0,0 +1,89 @@
+/**
+ * @file FutexEvent.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the futex based event count.
+ */
+
+#include "FutexEvent.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
+
+/**
+ * This is the default constructor.  It creates an event with no waiters.
+ */
+FutexEvent::FutexEvent() : state(0) {
+}
+
+/**
+ * This is the destructor for the class.
+ */
+FutexEvent::~FutexEvent() {
+}
+
+/**
+ * This method registers the caller as a waiter.
+ * @return The key which is to be passed to wait.
+ */
+uint32_t FutexEvent::prepareWait() {
+	// The waiting bit is set before the caller checks its condition.  A notifier which misses the bit must have made its change before
+	// the bit was set, so the caller's check will see the change.
+	return state.fetch_or(1, std::memory_order_seq_cst) | 1;
+}
+
+/**
+ * This method will block the caller until the event is notified, the timeout expires, or a signal is received.
+ * @param key This is the key which was returned by prepareWait.
+ * @param timeout This is the longest time to block, in nanoseconds.  A negative value blocks with no timeout.
+ */
+void FutexEvent::wait(uint32_t key, int64_t timeout) {
+	struct timespec relativeTimeout;
+	struct timespec *timeoutPtr = NULL;
+
+	if (timeout >= 0) {
+		relativeTimeout.tv_sec = timeout / 1000000000;
+		relativeTimeout.tv_nsec = timeout % 1000000000;
+		timeoutPtr = &relativeTimeout;
+	}
+
+	// The kernel only blocks if the word still holds the key, so a notification made after prepareWait returns immediately.
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state), FUTEX_WAIT_PRIVATE, key, timeoutPtr, NULL, 0);
+}
+
+/**
+ * This method wakes every thread which is waiting on the event.
+ */
+void FutexEvent::notify() {
+	// Order the caller's change ahead of the check for waiters.  This pairs with the fetch_or in prepareWait.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	uint32_t current = state.load(std::memory_order_relaxed);
+	if ((current & 1) != 0) {
+		// Adding one clears the waiting bit and advances the word, so every outstanding key becomes stale.  If another notifier gets there
+		// first, it wakes the waiters instead.
+		if (state.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst)) {
+			syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+		}
+	}
+}
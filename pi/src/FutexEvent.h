@@ -0,0 +1,76 @@
+/**
+ * @file FutexEvent.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines a futex based event count, which lets a consumer block on a lock-free data structure without taking a lock.
+ * A waiter first prepares to wait, which returns a key, then checks the data structure, and only then waits on the key.
+ * A notification made at any point after the key was taken wakes the waiter, so no wakeup can be lost between the check and the wait.
+ * The lowest bit of the event word records that someone may be waiting.  A notification clears it as it wakes the waiters, so a burst of
+ * notifications costs one system call, and notifying when nobody is waiting costs a memory fence and a load.
+ */
+#ifndef FUTEXEVENT_H_
+#define FUTEXEVENT_H_
+
+#include <atomic>
+#include <stdint.h>
+
+class FutexEvent {
+private:
+	/**
+	 * This is the event word, which the futex waits on.  The lowest bit is set while a thread may be waiting.  The word is advanced by every
+	 * notification which finds that bit set.
+	 */
+	std::atomic<uint32_t> state;
+
+public:
+	/**
+	 * This is the default constructor.  It creates an event with no waiters.
+	 */
+	FutexEvent();
+
+	/**
+	 * This is the destructor for the class.
+	 */
+	virtual ~FutexEvent();
+
+	/**
+	 * This method registers the caller as a waiter.  It must be called before the caller checks the condition it is waiting for.
+	 * If the condition turns out to be satisfied, the caller may simply not wait.
+	 * @return The key which is to be passed to wait.
+	 */
+	uint32_t prepareWait();
+
+	/**
+	 * This method will block the caller until the event is notified, the timeout expires, or a signal is received.  It may also return
+	 * spuriously, so the caller must check its condition again afterwards.
+	 * @param key This is the key which was returned by prepareWait.
+	 * @param timeout This is the longest time to block, in nanoseconds.  A negative value blocks with no timeout.
+	 */
+	void wait(uint32_t key, int64_t timeout);
+
+	/**
+	 * This method wakes every thread which is waiting on the event.  It must be called after the change that the waiters are waiting for
+	 * has been made visible.
+	 */
+	void notify();
+};
+
+#endif /* FUTEXEVENT_H_ */
@@ -34,6 +34,7 @@
 #include <time.h>
 #include <pthread.h>
 #include "GenericThreadInfo.h"
+#include "Clock.h"
 #include <sys/syscall.h>
 #include <unistd.h>
 
@@ -417,8 +418,7 @@ int GPIO::waitForEdge(int maxWait) // waits until button is pressed up to a maxi
 		{
 	std::unique_lock<std::mutex> lck(mtx);
 
-	if (std::cv_status::timeout
-			== cv.wait_for(lck, std::chrono::milliseconds(maxWait))) {
+	if (Clock::getClock()->waitFor(cv, lck, ((int64_t) maxWait) * 1000000) == false) {
 		// A timeout occurred.  Return -1.
 		return -1;
 	} else {
@@ -49,9 +49,16 @@ void Horn::pulseHorn(int length, int period) {
 	repetitionTime = period;
 }
 
+int Horn::classifyCommand(int command) {
+	if (command == HORN_SOUND_COMMAND) {
+		return SAFETY_COMMAND_PRIORITY;
+	}
+	return MOTION_COMMAND_PRIORITY;
+}
+
 void Horn::taskMethod() {
-	if (myqueue->hasItem()) {
-		int event = myqueue->dequeue();
+	int event;
+	if (myqueue->tryDequeue(event)) {
 		if (event == HORN_MUTE_COMMAND) {
 			// TODO figure out which is silent or pulse horn
 			silenceHorn();
@@ -68,6 +68,15 @@ public:
 	 */
 	void taskMethod();
 
+	/**
+	 * This method is the command classifier for the horn queue.  Sounding the horn is a safety command, so it is dequeued ahead of any
+	 * mute or pulse commands which were queued before it.  Those are placed at the motion level, so that the queue flushes them when
+	 * the horn is sounded.  Otherwise an older mute would be dequeued after the sound and silence the alarm.
+	 * @param command This is the command.
+	 * @return The priority level that the command is to be queued at.
+	 */
+	static int classifyCommand(int command);
+
 private:
 
 	/**
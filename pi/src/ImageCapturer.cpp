@@ -1,4 +1,5 @@
 #include "ImageCapturer.h"
+#include "Clock.h"
 #include <chrono>
 
 using namespace std::chrono;
@@ -21,6 +22,9 @@ ImageCapturer::ImageCapturer(Camera *referencedCamera, ImageTransmitter *trans,
 	imageWidth = width;
 	imageHeight = height;
 	size = new Size(width, height);
+
+	// Size the transmit buffer for the largest row that can be sent, so that streaming does not allocate.
+	myTrans->reserveBuffer(width * 3);
 }
 
 /**
@@ -42,50 +46,48 @@ void ImageCapturer::taskMethod() {
 
 
 	/**
-	 * 1.0 Obtain the time since the epoch from the system clock in ms.
+	 * 1.0 Obtain the time from the clock in ms.
 	 */
-	milliseconds start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+	milliseconds start = duration_cast<milliseconds>(nanoseconds(Clock::getClock()->now()));
 
 	/**
 	 *2.0 Take the picture from the camera.
 	 */
-	Mat *image = myCamera->takePicture();
+	bool pictureTaken = myCamera->takePicture(capturedImage);
 
 	/**
 	 * 3.0 If the image is not empty,
 	 */
-	if (!image->empty()) {
+	if (pictureTaken) {
 		/**
-		 * 3.1 Obtain the time since the epoch from the system clock in ms.
+		 * 3.1 Obtain the time from the clock in ms.
 		 */
-		milliseconds start2 = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+		milliseconds start2 = duration_cast<milliseconds>(nanoseconds(Clock::getClock()->now()));
 
 		/**
 		 * 3.2 Resize the image according to the desired size, if a resize needs to occur.
 		 */
-		Mat dst;
-		resize(*image, dst, *size);
+		resize(capturedImage, resizedImage, *size);
 
 		/**
 		 * Convert the image to greyscale.
 		 */
-		Mat gsdst;
-		cvtColor(dst, gsdst, COLOR_BGR2GRAY);
+		cvtColor(resizedImage, greyscaleImage, COLOR_BGR2GRAY);
 
 		/**
-		 * 3.4 Obtain the time since the epoch from the system clock in ms.
+		 * 3.4 Obtain the time from the clock in ms.
 		 */
-		milliseconds start3 = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+		milliseconds start3 = duration_cast<milliseconds>(nanoseconds(Clock::getClock()->now()));
 
 		/**
 		 * 3.5 Stream the image to the remote device.
 		 */
-		myTrans->streamImage(&gsdst);
+		myTrans->streamImage(&greyscaleImage);
 
 		/**
-		 * 3.6 Obtain the time since the epoch from the system clock in ms.
+		 * 3.6 Obtain the time from the clock in ms.
 		 */
-		milliseconds end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+		milliseconds end = duration_cast<milliseconds>(nanoseconds(Clock::getClock()->now()));
 		milliseconds delta = start2 - start;
 
 		/**
@@ -124,6 +126,5 @@ void ImageCapturer::taskMethod() {
 		 cout << flush;
 
 	}
-	delete image;
 }
 
@@ -46,6 +46,14 @@ private:
 	 * This variable will keep track of how many times the image has failed to transmit in an appropriate amount of time (i.e. we have not ttransmitted fast enough.)
 	 */
 	int xmitTimeDeadlineMissCount=0;
+
+	/**
+	 * These are the images used by each step of the pipeline.  They are kept from one release to the next, so that once they have the right
+	 * size the pipeline does not allocate memory.
+	 */
+	Mat capturedImage;
+	Mat resizedImage;
+	Mat greyscaleImage;
 public:
 
 	/**
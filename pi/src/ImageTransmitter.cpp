@@ -53,6 +53,11 @@ ImageTransmitter::~ImageTransmitter() {
 // TODO
     delete destinationMachineName;
 
+    if (sockfd >= 0) {
+        close(sockfd);
+    }
+    free(msgBuffer);
+
 }  
 
 /**
@@ -66,38 +71,41 @@ int ImageTransmitter::streamImage(Mat *image) {
 
         imageCount++;
 
+        // The socket and the destination address are set up once and reused for every image, since the host lookup allocates.
+        if (sockfd < 0) {
+            struct hostent *server = gethostbyname(destinationMachineName);
 
-        sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (server == NULL) {
+                fprintf(stderr, "ERROR, no such host\n");
+                return -1;;
+            }
 
+            bzero((char *) &destinationAddress, sizeof(destinationAddress));
+            destinationAddress.sin_family = AF_INET;
+            memcpy((char *) &destinationAddress.sin_addr.s_addr, (char *) server->h_addr, server->h_length);
+            destinationAddress.sin_port = htons(myPort);
 
-		if (sockfd < 0) {
-			perror("ERROR opening socket");
-			return -1;
-		}
+            sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
 
+            if (sockfd < 0) {
+                perror("ERROR opening socket");
+                return -1;
+            }
+        }
 
-        struct hostent *server = gethostbyname(destinationMachineName);
-
-		if (server == NULL) {
-			fprintf(stderr, "ERROR, no such host\n");
-			return -1;;
-		}
-
-
-        struct sockaddr_in serv_addr;
-	    int server_length = sizeof(serv_addr);
-	    bzero((char *) &serv_addr, server_length);
-	    serv_addr.sin_family = AF_INET;
-	    memcpy((char *) &serv_addr.sin_addr.s_addr, (char *) server->h_addr, server->h_length);
-
-	    serv_addr.sin_port = htons(myPort);
+	    int server_length = sizeof(destinationAddress);
 
 
 		uint32_t rows = image->rows;
 		uint32_t cols = image->cols;
 		uint32_t channels = image->channels();
 		int msg_size = channels * cols + 28;
-		char* msg_buffer = (char*)malloc(msg_size);
+		reserveBuffer(channels * cols);
+		if (msgBufferSize < msg_size) {
+			fprintf(stderr, "ERROR, unable to allocate the message buffer\n");
+			return -1;
+		}
+		char* msg_buffer = msgBuffer;
 
 
 		uint32_t currentTimestamp = current_timestamp();
@@ -117,7 +125,7 @@ int ImageTransmitter::streamImage(Mat *image) {
 
 			memcpy(&msg_buffer[28], &row.data[0], cols * channels);
 
-			int send = sendto(sockfd, msg_buffer, msg_size, 0, (struct sockaddr *) &serv_addr, server_length);
+			int send = sendto(sockfd, msg_buffer, msg_size, 0, (struct sockaddr *) &destinationAddress, server_length);
 			if (send < 0) {
 				printf("Error when sending\n");
 				return -1;
@@ -125,10 +133,22 @@ int ImageTransmitter::streamImage(Mat *image) {
 
 		}
 
-		free(msg_buffer);
-
-		close(sockfd);
-
 	}
 	return 0;
 }
+
+/**
+ * This method will make sure that the message buffer can hold rows of the given size, so that streaming does not allocate memory.
+ * @param rowSize This is the size of the largest row that is to be sent, in bytes.
+ */
+void ImageTransmitter::reserveBuffer(int rowSize) {
+	int requiredSize = rowSize + 28;
+
+	if (requiredSize > msgBufferSize) {
+		char *newBuffer = (char*) realloc(msgBuffer, requiredSize);
+		if (newBuffer != NULL) {
+			msgBuffer = newBuffer;
+			msgBufferSize = requiredSize;
+		}
+	}
+}
@@ -28,6 +28,7 @@
 #define IMAGETRANSMITTER_H_
 
 #include <opencv2/opencv.hpp>
+#include <netinet/in.h>
 
 using namespace cv;
 
@@ -38,9 +39,9 @@ private:
 	 */
 	int myPort = 6000;
 	/**
-	 * This is the socket fd that is to be used.
+	 * This is the socket fd that is to be used.  It is opened when the first image is streamed and kept open, and is -1 until then.
 	 */
-	int sockfd = 0;
+	int sockfd = -1;
 	/**
 	 * This is a c style string representing the destination machine's name.
 	 */
@@ -50,6 +51,21 @@ private:
 	 */
 	int imageCount = 0;
 
+	/**
+	 * This is the buffer that each row is copied into before it is sent.  It is only reallocated if a row larger than its capacity is sent.
+	 */
+	char *msgBuffer = NULL;
+
+	/**
+	 * This is the size of the message buffer in bytes.
+	 */
+	int msgBufferSize = 0;
+
+	/**
+	 * This is the address of the destination machine.  It is looked up when the first image is streamed.
+	 */
+	struct sockaddr_in destinationAddress;
+
 public:
 	/**
 	 * This will instantiate a new instance of this class. It will copy the machine name into a heap allocated string and update the port.
@@ -70,6 +86,12 @@ public:
 	 */
 	int streamImage(Mat* image);
 
+	/**
+	 * This method will make sure that the message buffer can hold rows of the given size, so that streaming does not allocate memory.
+	 * @param rowSize This is the size of the largest row that is to be sent, in bytes.
+	 */
+	void reserveBuffer(int rowSize);
+
 };
 
 #endif /* IMAGETRANSMITTER_H_ */
@@ -0,0 +1,236 @@
+/**
+ * @file LatencyHistogram.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the fixed memory, log-linear latency histogram.
+ */
+
+#include "LatencyHistogram.h"
+#include <iomanip>
+#include <string.h>
+
+/**
+ * This is the default constructor.  It creates an empty histogram.
+ */
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+/**
+ * This method will determine which bucket a value is to be counted in.
+ * @param value This is the value.
+ * @return The index of the bucket will be returned.
+ */
+uint32_t LatencyHistogram::bucketIndex(uint32_t value) {
+	/**
+	 * Values which fit within the sub-bucket bits plus one are counted exactly.  Larger values are shifted down so that only the top
+	 * bits are kept, and the shift selects the power of two.
+	 */
+	if (value < (SUB_BUCKET_COUNT << 1)) {
+		return value;
+	}
+	uint32_t mostSignificantBit = 31 - __builtin_clz(value);
+	uint32_t shift = mostSignificantBit - SUB_BUCKET_BITS;
+	return shift * SUB_BUCKET_COUNT + (value >> shift);
+}
+
+/**
+ * This method will determine the largest value which is counted in a given bucket.
+ * @param index This is the index of the bucket.
+ * @return The largest value which falls in the bucket will be returned.
+ */
+uint32_t LatencyHistogram::bucketUpperBound(uint32_t index) {
+	if (index < (SUB_BUCKET_COUNT << 1)) {
+		return index;
+	}
+	uint32_t shift = (index / SUB_BUCKET_COUNT) - 1;
+	uint64_t lowerBound = ((uint64_t) (index - shift * SUB_BUCKET_COUNT)) << shift;
+	return (uint32_t) (lowerBound + (1ULL << shift) - 1);
+}
+
+/**
+ * This method will record a value in the histogram.  It does not allocate memory and is safe to call from a real time task.  It must only
+ * be called from the thread which owns the histogram.
+ * @param value This is the value that is to be recorded.  Negative values are recorded as 0.
+ */
+void LatencyHistogram::record(int64_t value) {
+	uint32_t clampedValue;
+	if (value < 0) {
+		clampedValue = 0;
+	} else if (value > 0xFFFFFFFFLL) {
+		clampedValue = 0xFFFFFFFF;
+	} else {
+		clampedValue = (uint32_t) value;
+	}
+
+	/**
+	 * There is only one writer, so plain loads and stores are used rather than read-modify-write operations.  Readers see each counter
+	 * either before or after the update, never a torn value.
+	 */
+	std::atomic<uint32_t> &bucket = counts[bucketIndex(clampedValue)];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	totalValue.store(totalValue.load(std::memory_order_relaxed) + clampedValue, std::memory_order_relaxed);
+	if (clampedValue < minValue.load(std::memory_order_relaxed)) {
+		minValue.store(clampedValue, std::memory_order_relaxed);
+	}
+	if (clampedValue > maxValue.load(std::memory_order_relaxed)) {
+		maxValue.store(clampedValue, std::memory_order_relaxed);
+	}
+	totalCount.store(totalCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * This method will remove all samples from the histogram.  It must only be called from the thread which owns the histogram.
+ */
+void LatencyHistogram::reset() {
+	for (uint32_t index = 0; index < BUCKET_COUNT; index++) {
+		counts[index].store(0, std::memory_order_relaxed);
+	}
+	totalValue.store(0, std::memory_order_relaxed);
+	minValue.store(0xFFFFFFFF, std::memory_order_relaxed);
+	maxValue.store(0, std::memory_order_relaxed);
+	totalCount.store(0, std::memory_order_release);
+}
+
+/**
+ * This method will add the samples of another histogram to this one.  It must only be called from the thread which owns this histogram,
+ * and the other histogram should no longer be recorded into.
+ * @param other This is the histogram whose samples are to be added.
+ */
+void LatencyHistogram::merge(LatencyHistogram &other) {
+	uint64_t otherCount = other.getCount();
+	if (otherCount == 0) {
+		return;
+	}
+
+	for (uint32_t index = 0; index < BUCKET_COUNT; index++) {
+		counts[index].store(counts[index].load(std::memory_order_relaxed) + other.counts[index].load(std::memory_order_relaxed),
+				std::memory_order_relaxed);
+	}
+	totalValue.store(totalValue.load(std::memory_order_relaxed) + other.totalValue.load(std::memory_order_relaxed),
+			std::memory_order_relaxed);
+	if (other.getMin() < minValue.load(std::memory_order_relaxed)) {
+		minValue.store(other.getMin(), std::memory_order_relaxed);
+	}
+	if (other.getMax() > maxValue.load(std::memory_order_relaxed)) {
+		maxValue.store(other.getMax(), std::memory_order_relaxed);
+	}
+	totalCount.store(totalCount.load(std::memory_order_relaxed) + otherCount, std::memory_order_release);
+}
+
+/**
+ * This method will return the number of samples that have been recorded.
+ * @return The number of samples will be returned.
+ */
+uint64_t LatencyHistogram::getCount() {
+	return totalCount.load(std::memory_order_acquire);
+}
+
+/**
+ * This method will return the smallest value that has been recorded.
+ * @return The smallest value will be returned, or 0 if the histogram is empty.
+ */
+uint32_t LatencyHistogram::getMin() {
+	return (getCount() == 0) ? 0 : minValue.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the largest value that has been recorded.
+ * @return The largest value will be returned, or 0 if the histogram is empty.
+ */
+uint32_t LatencyHistogram::getMax() {
+	return maxValue.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the mean of the values that have been recorded.
+ * @return The mean will be returned, or 0 if the histogram is empty.
+ */
+double LatencyHistogram::getMean() {
+	uint64_t count = getCount();
+	return (count == 0) ? 0.0 : ((double) totalValue.load(std::memory_order_relaxed) / (double) count);
+}
+
+/**
+ * This method will return the value at the given percentile.  The value is the upper bound of the bucket that holds the percentile,
+ * so the true value is never larger than the value returned.
+ * @param percentile This is the percentile, between 0 and 100.
+ * @return The value at the percentile will be returned, or 0 if the histogram is empty.
+ */
+uint32_t LatencyHistogram::getPercentile(double percentile) {
+	uint64_t count = getCount();
+	uint32_t maximum = getMax();
+	if (count == 0) {
+		return 0;
+	}
+
+	/**
+	 * Determine how many samples must be at or below the percentile value, and then walk the buckets until that many have been seen.
+	 * The writer may record more samples during the walk.  That only adds samples, so the walk still reaches the target.
+	 */
+	uint64_t target = (uint64_t) ((percentile / 100.0) * count + 0.5);
+	if (target < 1) {
+		target = 1;
+	}
+	uint64_t seen = 0;
+	for (uint32_t index = 0; index < BUCKET_COUNT; index++) {
+		seen += counts[index].load(std::memory_order_relaxed);
+		if (seen >= target) {
+			uint32_t upperBound = bucketUpperBound(index);
+			return (upperBound < maximum) ? upperBound : maximum;
+		}
+	}
+	return maximum;
+}
+
+/**
+ * This method will print the p50, p90, p99, p99.9 and max values to the given stream, separated by tabs.
+ * @param os This is the stream that the values are to be printed to.
+ */
+void LatencyHistogram::printPercentiles(std::ostream &os) {
+	os << std::setw(8) << getPercentile(50.0) << "\t" << std::setw(8)
+			<< getPercentile(90.0) << "\t" << std::setw(8)
+			<< getPercentile(99.0) << "\t" << std::setw(8)
+			<< getPercentile(99.9) << "\t" << std::setw(8) << getMax();
+}
+
+/**
+ * This method will write the CSV header which matches the lines written by writeCSV.
+ * @param os This is the stream that the header is to be written to.
+ */
+void LatencyHistogram::writeCSVHeader(std::ostream &os) {
+	os << "task,metric,samples,min_us,p50_us,p90_us,p99_us,p99_9_us,max_us,mean_us\n";
+}
+
+/**
+ * This method will write a CSV line with the sample count, min, p50, p90, p99, p99.9, max and mean for the histogram.
+ * @param os This is the stream that the line is to be written to.
+ * @param taskName This is the name of the task that the histogram belongs to.
+ * @param metricName This is the name of the metric that the histogram measures.
+ */
+void LatencyHistogram::writeCSV(std::ostream &os, const std::string &taskName, const std::string &metricName) {
+	os << taskName << "," << metricName << "," << getCount() << "," << getMin()
+			<< "," << getPercentile(50.0) << "," << getPercentile(90.0) << ","
+			<< getPercentile(99.0) << "," << getPercentile(99.9) << ","
+			<< getMax() << "," << std::fixed << std::setprecision(1)
+			<< getMean() << "\n";
+}
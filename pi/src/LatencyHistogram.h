@@ -0,0 +1,173 @@
+/**
+ * @file LatencyHistogram.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines a fixed memory, log-linear latency histogram.  Values below 32 are counted exactly.  Above that, every power of two
+ *      is split into 16 linear sub-buckets, so any recorded value is known to within about 6%.  Recording a value never allocates memory,
+ *      which allows the histogram to be used from within real time tasks.  The histogram has a single writer.  The counters are atomic so that
+ *      other threads can read the percentiles while the writer is recording, without locking and without torn values.
+ */
+
+#ifndef LATENCYHISTOGRAM_H_
+#define LATENCYHISTOGRAM_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <ostream>
+
+class LatencyHistogram {
+public:
+	/**
+	 * This is the number of bits of the value which are kept within each power of two.  There are 2^SUB_BUCKET_BITS sub-buckets per power of two.
+	 */
+	static const uint32_t SUB_BUCKET_BITS = 4;
+
+	/**
+	 * This is the number of linear sub-buckets within each power of two.
+	 */
+	static const uint32_t SUB_BUCKET_COUNT = (1 << SUB_BUCKET_BITS);
+
+	/**
+	 * This is the total number of buckets.  It is enough to hold any 32 bit value.
+	 */
+	static const uint32_t BUCKET_COUNT = (32 - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+
+private:
+	/**
+	 * This is the number of samples in each bucket.
+	 */
+	std::atomic<uint32_t> counts[BUCKET_COUNT];
+
+	/**
+	 * This is the total number of samples that have been recorded.
+	 */
+	std::atomic<uint64_t> totalCount;
+
+	/**
+	 * This is the sum of all samples that have been recorded.  It is used to compute the mean.
+	 */
+	std::atomic<uint64_t> totalValue;
+
+	/**
+	 * This is the smallest value that has been recorded.
+	 */
+	std::atomic<uint32_t> minValue;
+
+	/**
+	 * This is the largest value that has been recorded.
+	 */
+	std::atomic<uint32_t> maxValue;
+
+	/**
+	 * This method will determine which bucket a value is to be counted in.
+	 * @param value This is the value.
+	 * @return The index of the bucket will be returned.
+	 */
+	static uint32_t bucketIndex(uint32_t value);
+
+	/**
+	 * This method will determine the largest value which is counted in a given bucket.
+	 * @param index This is the index of the bucket.
+	 * @return The largest value which falls in the bucket will be returned.
+	 */
+	static uint32_t bucketUpperBound(uint32_t index);
+
+public:
+	/**
+	 * This is the default constructor.  It creates an empty histogram.
+	 */
+	LatencyHistogram();
+
+	/**
+	 * This method will record a value in the histogram.  It does not allocate memory and is safe to call from a real time task.  It must only
+	 * be called from the thread which owns the histogram.
+	 * @param value This is the value that is to be recorded.  Negative values are recorded as 0.
+	 */
+	void record(int64_t value);
+
+	/**
+	 * This method will remove all samples from the histogram.  It must only be called from the thread which owns the histogram.
+	 */
+	void reset();
+
+	/**
+	 * This method will add the samples of another histogram to this one.  It must only be called from the thread which owns this histogram,
+	 * and the other histogram should no longer be recorded into.
+	 * @param other This is the histogram whose samples are to be added.
+	 */
+	void merge(LatencyHistogram &other);
+
+	/**
+	 * This method will return the number of samples that have been recorded.
+	 * @return The number of samples will be returned.
+	 */
+	uint64_t getCount();
+
+	/**
+	 * This method will return the smallest value that has been recorded.
+	 * @return The smallest value will be returned, or 0 if the histogram is empty.
+	 */
+	uint32_t getMin();
+
+	/**
+	 * This method will return the largest value that has been recorded.
+	 * @return The largest value will be returned, or 0 if the histogram is empty.
+	 */
+	uint32_t getMax();
+
+	/**
+	 * This method will return the mean of the values that have been recorded.
+	 * @return The mean will be returned, or 0 if the histogram is empty.
+	 */
+	double getMean();
+
+	/**
+	 * This method will return the value at the given percentile.  The value is the upper bound of the bucket that holds the percentile,
+	 * so the true value is never larger than the value returned.
+	 * @param percentile This is the percentile, between 0 and 100.
+	 * @return The value at the percentile will be returned, or 0 if the histogram is empty.
+	 */
+	uint32_t getPercentile(double percentile);
+
+	/**
+	 * This method will print the p50, p90, p99, p99.9 and max values to the given stream, separated by tabs.
+	 * @param os This is the stream that the values are to be printed to.
+	 */
+	void printPercentiles(std::ostream &os);
+
+	/**
+	 * This method will write a CSV line with the sample count, min, p50, p90, p99, p99.9, max and mean for the histogram.
+	 * @param os This is the stream that the line is to be written to.
+	 * @param taskName This is the name of the task that the histogram belongs to.
+	 * @param metricName This is the name of the metric that the histogram measures.
+	 */
+	void writeCSV(std::ostream &os, const std::string &taskName, const std::string &metricName);
+
+	/**
+	 * This method will write the CSV header which matches the lines written by writeCSV.
+	 * @param os This is the stream that the header is to be written to.
+	 */
+	static void writeCSVHeader(std::ostream &os);
+};
+
+#endif /* LATENCYHISTOGRAM_H_ */
@@ -18,7 +18,7 @@ using namespace se3910RPi;
 
 LineSensor::LineSensor(CommandQueue* ctrlQueue, CommandQueue* mcq,
 		int leftSensorNumber, int centerSensorNumber, int rightSensorNumber,
-		string threadName, uint32_t period) : PeriodicTask(threadName, period) {
+		string threadName, uint32_t period) : PeriodicTask(threadName, period), publishedState(0) {
 	this->ctrlQueue = ctrlQueue;
 	this->mcq = mcq;
 
@@ -37,8 +37,9 @@ LineSensor::~LineSensor() {
 }
 
 void LineSensor::taskMethod() {
-	if (ctrlQueue->hasItem()) {
-		int event = ctrlQueue->dequeue();
+	int event;
+	uint32_t state = 0;
+	if (ctrlQueue->tryDequeue(event)) {
 		if (event == STOP_LINE_SENSING) {
 			currentlyActive = false;
 		} else if (event == START_LINE_SENSING) {
@@ -55,27 +56,40 @@ void LineSensor::taskMethod() {
 		int centerRead = centerSensor->getValue();
 		int rightRead = rightSensor->getValue();
 
+		state = LINE_SENSOR_STATE_SENSING | ((leftRead == GPIO::GPIO_HIGH) ? LINE_SENSOR_STATE_LEFT : 0)
+				| ((centerRead == GPIO::GPIO_HIGH) ? LINE_SENSOR_STATE_CENTER : 0)
+				| ((rightRead == GPIO::GPIO_HIGH) ? LINE_SENSOR_STATE_RIGHT : 0);
+
 		if (leftRead == centerRead && centerRead == rightRead && rightRead == GPIO::GPIO_HIGH) {
-			mcq->enqueue(MOTORDIRECTIONBITMAP | STOP);
+			mcq->enqueue(MOTORDIRECTIONBITMAP | STOP, COMMAND_SOURCE_LINE_SENSOR);
 
 		} else {
 			
 			if (lineFollowingEnabled) {
 
 				if (leftRead == GPIO::GPIO_LOW && centerRead == GPIO::GPIO_HIGH && rightRead == GPIO::GPIO_LOW) {
-					mcq->enqueue(MOTORDIRECTIONBITMAP | FORWARD);
+					mcq->enqueue(MOTORDIRECTIONBITMAP | FORWARD, COMMAND_SOURCE_LINE_SENSOR);
 
 				} else if (leftRead == GPIO::GPIO_HIGH && rightRead == GPIO::GPIO_LOW) {
-					mcq->enqueue(MOTORDIRECTIONBITMAP | LEFT);
+					mcq->enqueue(MOTORDIRECTIONBITMAP | LEFT, COMMAND_SOURCE_LINE_SENSOR);
 
 				} else if (leftRead == GPIO::GPIO_LOW && rightRead == GPIO::GPIO_HIGH) {
-					mcq->enqueue(MOTORDIRECTIONBITMAP | RIGHT);
+					mcq->enqueue(MOTORDIRECTIONBITMAP | RIGHT, COMMAND_SOURCE_LINE_SENSOR);
 
 				} else if (leftRead == GPIO::GPIO_HIGH && rightRead == GPIO::GPIO_HIGH) {
-					mcq->enqueue(MOTORDIRECTIONBITMAP | STOP);
+					mcq->enqueue(MOTORDIRECTIONBITMAP | STOP, COMMAND_SOURCE_LINE_SENSOR);
 				}
 			}
 		}
 
 	}
+
+	if (lineFollowingEnabled) {
+		state |= LINE_SENSOR_STATE_FOLLOWING;
+	}
+	publishedState.store(state, std::memory_order_relaxed);
+}
+
+uint32_t LineSensor::getState() {
+	return publishedState.load(std::memory_order_relaxed);
 }
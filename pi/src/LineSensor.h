@@ -30,6 +30,17 @@
 #include "PeriodicTask.h"
 #include "GPIO.h"
 #include "CommandQueue.h"
+#include <atomic>
+
+/**
+ * These are the bits of the line sensor state.  The first three are set while the matching sensor sees a line.  They are only read while
+ * line sensing is active.
+ */
+#define LINE_SENSOR_STATE_LEFT (0x01)
+#define LINE_SENSOR_STATE_CENTER (0x02)
+#define LINE_SENSOR_STATE_RIGHT (0x04)
+#define LINE_SENSOR_STATE_SENSING (0x08)
+#define LINE_SENSOR_STATE_FOLLOWING (0x10)
 
 namespace se3910RPi {
 
@@ -70,6 +81,11 @@ private:
 	 */
 	GPIO *rightSensor;
 
+	/**
+	 * This is the state as of the last release, made up of the LINE_SENSOR_STATE bits.
+	 */
+	std::atomic<uint32_t> publishedState;
+
 public:
 	/**
 	 * This is the constructor for this class.
@@ -93,6 +109,12 @@ public:
 	 * units of time.
 	 */
 	virtual void taskMethod();
+
+	/**
+	 * This method will return the state as of the last release.  It may be called from any thread.
+	 * @return The state, made up of the LINE_SENSOR_STATE bits.
+	 */
+	uint32_t getState();
 };
 
 }
@@ -0,0 +1,136 @@
+/**
+ * @file MPSCRingBuffer.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the bounded, lock-free, multiple producer, single consumer ring.
+ */
+
+#include "MPSCRingBuffer.h"
+
+/**
+ * This is the constructor for the class.
+ * @param requestedCapacity This is the requested number of slots.  It is rounded up to a power of two.
+ */
+MPSCRingBuffer::MPSCRingBuffer(uint32_t requestedCapacity) : RingBuffer(requestedCapacity), enqueuePosition(0), dequeuePosition(0) {
+	slots = new Slot[capacity];
+
+	// Each slot starts out free for the first position which maps onto it.
+	for (uint32_t index = 0; index < capacity; index++) {
+		slots[index].sequence.store(index, std::memory_order_relaxed);
+		slots[index].value = CommandEnvelope();
+	}
+}
+
+/**
+ * This is the destructor for the class.  It releases the slots.
+ */
+MPSCRingBuffer::~MPSCRingBuffer() {
+	delete[] slots;
+}
+
+/**
+ * This method will add a command to the ring.  It may be called from any number of threads at once.
+ * @param value This is the command to be added.
+ * @return true if the command was added.  False if the ring was full.
+ */
+bool MPSCRingBuffer::push(const CommandEnvelope &value) {
+	uint32_t position = enqueuePosition.load(std::memory_order_relaxed);
+	Slot *slot;
+
+	// 1.0 Claim a position whose slot is free.
+	while (true) {
+		slot = &slots[position & mask];
+		uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+		int32_t difference = (int32_t) (sequence - position);
+
+		if (difference == 0) {
+			// The slot is free.  Try to claim the position.  On failure, position is reloaded with the current enqueue position.
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// The slot still holds the command from one lap ago, so the ring is full.
+			return false;
+		} else {
+			// Another producer claimed this position first.
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	// 2.0 Write the command and hand the slot to the consumer.
+	slot->value = value;
+	slot->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+ * This method will remove the oldest command from the ring.  It is called from the consumer thread, and also from producers which
+ * discard the oldest command to make room, so the position is claimed in the same way as a producer claims one.
+ * @param value This is the location into which the command is written.  It is not modified if nothing was removed.
+ * @return true if a command was removed.  False if the ring was empty.
+ */
+bool MPSCRingBuffer::pop(CommandEnvelope &value) {
+	uint32_t position = dequeuePosition.load(std::memory_order_relaxed);
+	Slot *slot;
+
+	// 1.0 Claim a position whose slot has been filled.
+	while (true) {
+		slot = &slots[position & mask];
+		uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+		int32_t difference = (int32_t) (sequence - (position + 1));
+
+		if (difference == 0) {
+			// The slot is filled.  Try to claim the position.  On failure, position is reloaded with the current dequeue position.
+			if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// The producer for this position has not finished writing, or the ring is empty.
+			return false;
+		} else {
+			// Another thread removed the command at this position first.
+			position = dequeuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	// 2.0 Read the command and hand the slot back to the producers.
+	value = slot->value;
+
+	// Free the slot for the position one lap ahead.
+	slot->sequence.store(position + capacity, std::memory_order_release);
+	return true;
+}
+
+/**
+ * This method will return the number of commands in the ring, including any which producers are still writing.
+ * @return The number of commands in the ring.
+ */
+uint32_t MPSCRingBuffer::getOccupancy() {
+	uint32_t dequeued = dequeuePosition.load(std::memory_order_relaxed);
+	uint32_t enqueued = enqueuePosition.load(std::memory_order_relaxed);
+	uint32_t occupancy = enqueued - dequeued;
+
+	// The two positions are read separately, so clamp the snapshot to what the ring can hold.
+	if (occupancy > capacity) {
+		occupancy = capacity;
+	}
+	return occupancy;
+}
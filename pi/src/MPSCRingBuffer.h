@@ -0,0 +1,118 @@
+/**
+ * @file MPSCRingBuffer.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines a bounded, lock-free ring which many threads may push to and one thread may pop from.
+ * Each slot carries a sequence number which tells producers when the slot is free and tells the consumer when the command in it has been
+ * written.  Producers claim a position with a compare and swap on the shared enqueue position, so no producer ever waits on a lock.
+ * Pops claim their position the same way, so that a producer can discard the oldest command while the consumer is popping.
+ * The enqueue and dequeue positions are kept on separate cache lines so that producers and the consumer do not contend for one line.
+ */
+#ifndef MPSCRINGBUFFER_H_
+#define MPSCRINGBUFFER_H_
+
+#include "RingBuffer.h"
+#include "QueueCfg.h"
+#include <atomic>
+
+class MPSCRingBuffer : public RingBuffer {
+private:
+	/**
+	 * This structure is a single slot in the ring.
+	 */
+	struct Slot {
+		/**
+		 * This is the position the slot is ready for.  It equals the position when the slot is free for a producer, and is one past the
+		 * position once the command has been written and the slot is ready for the consumer.
+		 */
+		std::atomic<uint32_t> sequence;
+		/**
+		 * This is the command held in the slot.
+		 */
+		CommandEnvelope value;
+	};
+
+	/**
+	 * This is the array of slots.  It is allocated once, when the ring is constructed.
+	 */
+	Slot *slots;
+
+	/**
+	 * This keeps the enqueue position off of the cache line holding the slot pointer and capacity, which every thread reads.
+	 */
+	char padding0[CACHE_LINE_SIZE];
+
+	/**
+	 * This is the next position to be claimed by a producer.
+	 */
+	std::atomic<uint32_t> enqueuePosition;
+
+	/**
+	 * This keeps the enqueue and dequeue positions on separate cache lines.
+	 */
+	char padding1[CACHE_LINE_SIZE];
+
+	/**
+	 * This is the next position to be read by the consumer.  Only the consumer writes it.
+	 */
+	std::atomic<uint32_t> dequeuePosition;
+
+	/**
+	 * This keeps the dequeue position off of the cache line of whatever follows the ring in memory.
+	 */
+	char padding2[CACHE_LINE_SIZE];
+
+public:
+	/**
+	 * This is the constructor for the class.
+	 * @param requestedCapacity This is the requested number of slots.  It is rounded up to a power of two.
+	 */
+	MPSCRingBuffer(uint32_t requestedCapacity);
+
+	/**
+	 * This is the destructor for the class.  It releases the slots.
+	 */
+	virtual ~MPSCRingBuffer();
+
+	/**
+	 * This method will add a command to the ring.  It may be called from any number of threads at once.
+	 * @param value This is the command to be added.
+	 * @return true if the command was added.  False if the ring was full.
+	 */
+	virtual bool push(const CommandEnvelope &value);
+
+	/**
+	 * This method will remove the oldest command from the ring.  It is called from the consumer thread, and from producers which discard
+	 * the oldest command to make room.  If a producer has claimed the oldest position but not yet finished writing it, the ring is reported
+	 * as empty until the write completes.
+	 * @param value This is the location into which the command is written.  It is not modified if nothing was removed.
+	 * @return true if a command was removed.  False if the ring was empty.
+	 */
+	virtual bool pop(CommandEnvelope &value);
+
+	/**
+	 * This method will return the number of commands in the ring, including any which producers are still writing.
+	 * @return The number of commands in the ring.
+	 */
+	virtual uint32_t getOccupancy();
+};
+
+#endif /* MPSCRINGBUFFER_H_ */
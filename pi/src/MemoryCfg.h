@@ -0,0 +1,63 @@
+/**
+ * @file MemoryCfg.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines the configuration for the real time memory hardening mode.
+ */
+#ifndef MEMORYCFG_H_
+#define MEMORYCFG_H_
+
+/**
+ * This macro selects whether the real time memory hardening mode is used.  When it is 1, all memory is locked at startup, thread stacks
+ * are prefaulted, and heap allocations made by real time threads after startup are counted and reported.
+ */
+#define REALTIME_MEMORY_HARDENING (1)
+
+/**
+ * This is the number of bytes of each thread stack which is touched when the thread starts, so that the stack pages are resident
+ * before the thread does any real time work.  These pages are what is locked of each thread stack, so it bounds the memory the stacks pin.
+ */
+#define REALTIME_STACK_PREFAULT_SIZE (256 * 1024)
+
+/**
+ * This is the size of the stack of each thread started after the hardening mode is enabled, in bytes.  It replaces the default of 8 MB, so
+ * that the locked address space of each thread is bounded, and it must be at least REALTIME_STACK_PREFAULT_SIZE.
+ */
+#define REALTIME_THREAD_STACK_SIZE (1024 * 1024)
+
+/**
+ * This is the number of bytes of heap which is allocated and touched at startup.  Trimming is disabled, so the memory stays in the
+ * heap and later allocations are served from pages that are already locked.
+ */
+#define REALTIME_HEAP_PREFAULT_SIZE (16 * 1024 * 1024)
+
+/**
+ * This is the number of milliseconds that main waits after starting the tasks before the heap is frozen.  It gives each task time to
+ * run its initialization and first releases, which are allowed to allocate.
+ */
+#define REALTIME_HEAP_FREEZE_DELAY (2000)
+
+/**
+ * This is the largest number of real time threads whose allocations are tracked.
+ */
+#define REALTIME_MEMORY_MAX_THREADS (32)
+
+#endif /* MEMORYCFG_H_ */
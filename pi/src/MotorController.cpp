@@ -8,8 +8,10 @@
 
 #include "MotorController.h"
 #include "PCA9685Driver.h"
+#include "time_util.h"
 #include <stdint.h>
 #include <iostream>
+#include <iomanip>
 
 using namespace std;
 
@@ -17,6 +19,8 @@ MotorController::MotorController(uint16_t deviceID, uint16_t fchannel, uint16_t
 	controlHardware = PCA9685Driver::obtainPCA9685Instance(deviceID);
 	this->fchannel = fchannel;
 	this->rchannel = rchannel;
+	tracedCommandCount.store(0, std::memory_order_relaxed);
+	actuationCount.store(0, std::memory_order_relaxed);
 }
 
 MotorController::~MotorController() {
@@ -36,6 +40,9 @@ void MotorController::setDirection(int dir) {
 }
 
 void MotorController::taskMethod() {
+	// Read the count before the speed and direction, so that the command it announces is carried out by the write below.
+	uint32_t tracedCount = tracedCommandCount.load(std::memory_order_acquire);
+
 	if (direction == 0) {
 		controlHardware->setDutyCycle(rchannel, 0);
 		controlHardware->setDutyCycle(fchannel, 0);
@@ -49,6 +56,37 @@ void MotorController::taskMethod() {
 		controlHardware->setDutyCycle(fchannel, speed);
 
 	}
+
+	if (tracedCount != actuatedCommandCount) {
+		actuatedCommandCount = tracedCount;
+		CommandEnvelope envelope = tracedCommand.load();
+		envelope.actuationTime = getMonotonicTimeNs();
+		actuationLatencyHistogram.record((envelope.actuationTime - envelope.dequeueTime) / 1000);
+		endToEndLatencyHistogram.record((envelope.actuationTime - envelope.receiveTime) / 1000);
+		actuatedCommand.store(envelope);
+		actuationCount.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void MotorController::traceCommand(const CommandEnvelope &envelope) {
+	tracedCommand.store(envelope);
+	tracedCommandCount.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t MotorController::getActuatedCommand(CommandEnvelope &envelope) {
+	uint32_t count = actuationCount.load(std::memory_order_acquire);
+	envelope = actuatedCommand.load();
+	return count;
+}
+
+void MotorController::printLatencyInformation(std::ostream &os) {
+	os << std::setw(18) << myName << "\t" << std::setw(16) << "Controller->PWM" << "\t" << std::setw(8)
+			<< actuationLatencyHistogram.getCount() << "\t";
+	actuationLatencyHistogram.printPercentiles(os);
+	os << "\n" << std::setw(18) << myName << "\t" << std::setw(16) << "End to end" << "\t" << std::setw(8)
+			<< endToEndLatencyHistogram.getCount() << "\t";
+	endToEndLatencyHistogram.printPercentiles(os);
+	os << "\n";
 }
 
 void MotorController::stop() {
@@ -29,6 +29,11 @@
 
 #include "PeriodicTask.h"
 #include "PCA9685Driver.h"
+#include "CommandEnvelope.h"
+#include "LatencyHistogram.h"
+#include "SeqLockSnapshot.h"
+#include <atomic>
+#include <ostream>
 #include <string>
 
 class MotorController : public PeriodicTask {
@@ -58,6 +63,45 @@ private:
 	 */
 	int direction = 0;
 
+	/**
+	 * This is the envelope of the last command which changed the motor.  It is written by the robot controller thread.
+	 */
+	SeqLockSnapshot<CommandEnvelope> tracedCommand;
+
+	/**
+	 * This is the number of commands which have been traced.  It is incremented after the envelope is published, so a change in the
+	 * count tells the motor thread that a new command is waiting to reach the hardware.
+	 */
+	std::atomic<uint32_t> tracedCommandCount;
+
+	/**
+	 * This is the traced command count as of the last PWM write.  It is only used by the motor thread.
+	 */
+	uint32_t actuatedCommandCount = 0;
+
+	/**
+	 * This is the envelope of the last traced command which reached the hardware, stamped with its actuation time.  It is written by the
+	 * motor thread.
+	 */
+	SeqLockSnapshot<CommandEnvelope> actuatedCommand;
+
+	/**
+	 * This is the number of traced commands which have reached the hardware.  It is incremented after the envelope is published.
+	 */
+	std::atomic<uint32_t> actuationCount;
+
+	/**
+	 * This is the time from a command being dequeued by the robot controller to the PWM write which carried it out, in microseconds.
+	 * It is only written by the motor thread.
+	 */
+	LatencyHistogram actuationLatencyHistogram;
+
+	/**
+	 * This is the time from a command being received to the PWM write which carried it out, in microseconds.
+	 * It is only written by the motor thread.
+	 */
+	LatencyHistogram endToEndLatencyHistogram;
+
 public:
 	/**
 	 * This is the overridden taskMethod that is periodically invoked.
@@ -95,6 +139,28 @@ public:
 	 * this method will stop the motor, preventing it from spinning.
 	 */
 	void stop();
+
+	/**
+	 * This method will hand the motor the envelope of a command which has just changed its speed or direction, so that the time the
+	 * command reaches the hardware can be measured.  It must only be called from the robot controller thread, after the change is made.
+	 * If several commands are traced between two PWM writes, only the last one is measured.
+	 * @param envelope This is the envelope of the command.
+	 */
+	void traceCommand(const CommandEnvelope &envelope);
+
+	/**
+	 * This method will return the envelope of the last traced command which reached the hardware, so that a test harness can match it
+	 * to when the command was sent.  Only the latest is kept, so a caller which polls too slowly misses some.
+	 * @param envelope This is where the envelope is written.  Its actuation time is set.
+	 * @return The number of traced commands which have reached the hardware.  A change in it tells the caller that another has.
+	 */
+	uint32_t getActuatedCommand(CommandEnvelope &envelope);
+
+	/**
+	 * This method will print the controller to PWM write and end to end latency percentiles for the motor.
+	 * @param os This is the stream that the latencies are to be printed to.
+	 */
+	void printLatencyInformation(std::ostream &os);
 };
 
 #endif /* MOTORCONTROLLER_H_ */
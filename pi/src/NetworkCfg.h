@@ -33,5 +33,92 @@
  */
 #define NUMBER_OF_QUEUES (3)
 
+/**
+ * This is the number of messages the network transmission manager can hold while waiting for the socket.  The queue is allocated in full
+ * at startup, so a stalled client costs no more memory than this.
+ */
+#define TRANSMISSION_QUEUE_CAPACITY (64)
+
+/**
+ * This is the overflow policy for the transmission queue.  It is one of the overflow policies in QueueCfg.h.  Status reports go stale
+ * quickly, so once the client stalls the oldest reports are dropped in favor of the newest.
+ */
+#define TRANSMISSION_QUEUE_OVERFLOW_POLICY (OVERFLOW_DROP_OLDEST)
+
+/**
+ * This is the most messages the network transmission manager sends to a client with one system call.
+ */
+#define TRANSMISSION_BATCH_SIZE (32)
+
+/**
+ * This is how long the network transmission manager holds a batch open after the first message arrives, in nanoseconds, so that the
+ * messages a task enqueues together go out in one send.  0 sends whatever is queued as soon as the transmitter wakes.
+ */
+#define TRANSMISSION_FLUSH_WINDOW_NS (200000)
+
+/**
+ * This is the largest number of clients which can be connected to the network manager at once, such as a ground station and a monitoring
+ * tool.  A connection beyond this is accepted and closed straight away.
+ */
+#define MAX_NETWORK_CLIENTS (8)
+
+/**
+ * This is the number of connections the kernel will hold for the network manager before it accepts them.
+ */
+#define NETWORK_LISTEN_BACKLOG (8)
+
+/**
+ * This is the most readiness events the network manager handles per wakeup of its event loop.
+ */
+#define NETWORK_EPOLL_EVENTS (16)
+
+/**
+ * This is the size of each client's receive ring, in bytes.  One receive fills as much of the ring as the socket has data for, so a burst
+ * of up to this many bytes of messages costs a single system call.
+ */
+#define CLIENT_RECEIVE_BUFFER_SIZE (4096)
+
+/**
+ * This is the UDP port on which commands are also accepted, in the same message format as the TCP port.  UDP has no head of line
+ * blocking, so a lost datagram does not hold up the commands sent after it.  0 turns the UDP command port off.
+ */
+#define UDP_COMMAND_PORT (9090)
+
+/**
+ * This is the largest number of UDP senders whose message IDs are tracked at once.  When a new sender arrives, the one heard from
+ * least recently is forgotten.
+ */
+#define MAX_UDP_PEERS (8)
+
+/**
+ * This is the most datagrams received from the UDP command port with one system call.
+ */
+#define UDP_RECEIVE_BATCH (16)
+
+/**
+ * This is how long a UDP sender may be silent, in milliseconds, before its message IDs are forgotten.  A ground station which restarts
+ * and numbers its messages from 0 again is then not taken to be sending stale commands.
+ */
+#define UDP_PEER_IDLE_RESET_MS (1000)
+
+/**
+ * This is the number of links whose latency is estimated: one for each TCP client, followed by one for each UDP sender.
+ */
+#define NETWORK_LINKS (MAX_NETWORK_CLIENTS + MAX_UDP_PEERS)
+
+/**
+ * This is how telemetry records are encoded for the network.  It is one of the TELEMETRY_ENCODING values in NetworkMessage.h.
+ */
+#define TELEMETRY_ENCODING (TELEMETRY_ENCODING_VARINT)
+
+/**
+ * This is the period, in milliseconds, at which a client which has not subscribed is sent every telemetry channel.
+ */
+#define TELEMETRY_DEFAULT_PERIOD_MS (500)
+
+/**
+ * This is the most pieces of data a broadcast can be given.  Two more are needed for a client's telemetry frame.
+ */
+#define BROADCAST_MAX_PIECES (4)
 
 #endif /* NETWORKCFG_H_ */
@@ -0,0 +1,67 @@
+/**
+ * @file NetworkFrame.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines how network messages are framed for the wire, in either the legacy XOR checksummed format or the CRC32C format.
+ */
+#ifndef NETWORKFRAME_H_
+#define NETWORKFRAME_H_
+
+#include "NetworkMessage.h"
+#include "TelemetryRecord.h"
+#include <stddef.h>
+
+/**
+ * This method will check a frame which has been received and convert it to host byte order.  The format is taken from the frame's
+ * message type, and removed from it.
+ * @param message This is the frame, in network byte order.  If it is valid, it is converted to host byte order.
+ * @param frameVersion This is where the format of the frame is written.  It is one of the FRAME_VERSION values.
+ * @param payload This is the data which followed the frame, such as a telemetry record.  Only a CRC32C frame can have any.
+ * @param payloadLength This is the number of bytes of data which followed the frame.
+ * @return true if the frame is in a known format and its checksum is correct.  False otherwise, in which case the frame is left as it was.
+ */
+bool decodeFrame(networkMessageStruct &message, int &frameVersion, const void *payload = NULL, uint32_t payloadLength = 0);
+
+/**
+ * This method will convert a message to a frame in network byte order, ready to be sent.  A legacy frame keeps the checksum the message
+ * was given.  A CRC32C frame has the format put into its message type and its checksum replaced by the CRC32C.
+ * @param message This is the message, in host byte order.  It is converted in place.
+ * @param frameVersion This is the format of the frame.  It is one of the FRAME_VERSION values.
+ * @param payload This is the data which is sent after the frame, such as a telemetry record.  It is covered by the CRC32C, and is
+ * ignored for a legacy frame.
+ * @param payloadLength This is the number of bytes of data sent after the frame.
+ */
+void encodeFrame(networkMessageStruct &message, int frameVersion, const void *payload = NULL, uint32_t payloadLength = 0);
+
+/**
+ * This method will build a CRC32C telemetry frame, made up of a frame and the encoded record which follows it.
+ * @param header This is where the frame is written, in network byte order.
+ * @param payload This is where the encoded record is written.  It must hold at least TELEMETRY_MAX_RECORD_SIZE bytes.
+ * @param record This is the record.
+ * @param fieldMask This is the mask of the fields to send.
+ * @param sequence This is the sequence number of the frame.
+ * @param encoding This is how the record is encoded.  It is one of the TELEMETRY_ENCODING values.
+ * @return The number of bytes of encoded record.
+ */
+uint32_t encodeTelemetryFrame(networkMessageStruct &header, uint8_t *payload, const TelemetryRecord &record, uint32_t fieldMask,
+		uint32_t sequence, int encoding);
+
+#endif /* NETWORKFRAME_H_ */
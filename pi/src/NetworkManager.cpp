@@ -21,6 +21,7 @@
  *
  * @section DESCRIPTION
  * This file defines the implementation for the Network Manager.  The Network Manager manages network connections and acts as a server, receiving messages sent over a socket.
+ * Every socket is served from one thread by an epoll event loop, so a second client can connect while the first is still attached.
  */
 
 #include "NetworkManager.h"
@@ -28,6 +29,8 @@
 #include "CommandQueue.h"
 #include "NetworkMessage.h"
 #include "NetworkCommands.h"
+#include "NetworkFrame.h"
+#include "time_util.h"
 #include <sys/time.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -38,65 +41,118 @@
 #include <netinet/in.h>
 #include <string.h>
 #include <string>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <iomanip>
 
 using namespace std;
 
+/**
+ * These are the epoll tokens for the listening socket and the stop event.  The token for a client is the index of its slot.
+ */
+#define LISTEN_TOKEN (MAX_NETWORK_CLIENTS)
+#define STOP_TOKEN (MAX_NETWORK_CLIENTS + 1)
+#define UDP_TOKEN (MAX_NETWORK_CLIENTS + 2)
+
+/**
+ * This is the number of message IDs covered by the window of a UDP sender.  It is the number of bits in the window.
+ */
+#define UDP_WINDOW_SIZE (64)
+
 /**
  * This is the constructor for the Network Manager.  It will instantiate a new instance of the class.
  * @param port This is the port that the network manager is to listen on for incoming connections.
  * @param queue This is the queue that is to be used for enqueueing received requests.
  * @param threadName This is the name given to the executing thread.  It is a simple, string that is human readable.
+ * @param udpPort This is the UDP port on which commands are also accepted.  0 means commands are only accepted over TCP.
+ * @param receiveBufferSize This is the size of each client's receive ring, in bytes.  It must hold at least one message.
  */
 NetworkManager::NetworkManager(unsigned short port, CommandQueue **queue,
-		std::string threadName) :
-		RunnableClass(threadName) {
+		std::string threadName, unsigned short udpPort, uint32_t receiveBufferSize) :
+		RunnableClass(threadName), udpDuplicates(0), udpStale(0), clientCount(0), receiveCalls(0), eventLoopWakeups(0),
+		receivedMessages(0), telemetryFrames(0) {
 	portNumber = port;
+	udpPortNumber = udpPort;
 	myThread = NULL;
 	keepGoing = true;
 	referencequeue = queue;
+
+	/**
+	 * Allocate every receive ring up front, so that a client connecting later does not allocate.
+	 */
+	if (receiveBufferSize < sizeof(networkMessageStruct)) {
+		receiveBufferSize = sizeof(networkMessageStruct);
+	}
+	this->receiveBufferSize = receiveBufferSize;
+	for (int index = 0; index < MAX_NETWORK_CLIENTS; index++) {
+		clients[index].socket = -1;
+		clients[index].receiveBuffer = new uint8_t[receiveBufferSize];
+		clients[index].receiveHead = 0;
+		clients[index].receiveCount = 0;
+	}
+	for (int index = 0; index < MAX_UDP_PEERS; index++) {
+		udpPeers[index].active = false;
+	}
+	for (int version = 0; version <= FRAME_VERSION_CRC32C; version++) {
+		versionClientCount[version].store(0);
+	}
+
+	/**
+	 * Create the stop event here rather than in run, so that stop can be called before the thread has started.
+	 */
+	stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (stop_fd < 0) {
+		perror("eventfd");
+	}
 }
 
 /**
  * This is the destructor for the class which will clean up from the instantiation and operation of the class.
  */
 NetworkManager::~NetworkManager() {
-	/**
-	 * Right now, this destructor doesn't have anything to do, as there are no dynamically allocated objects that need to be destroyed.
-	 */
+	for (int index = 0; index < MAX_NETWORK_CLIENTS; index++) {
+		delete[] clients[index].receiveBuffer;
+	}
+	if (stop_fd >= 0) {
+		close(stop_fd);
+	}
 }
 
 /**
  * This method will override the default stop method.  In doing so, it must call the base class's stop method prior to invoking it's own logic.
  */
 void NetworkManager::stop() {
+	uint64_t signal = 1;
+
 	/**
 	 * 1.0 Call the parent's stop method.
 	 */
 	RunnableClass::stop();
 
 	/**
-	 * 2.0 Call shutdown on the socket to shut down the full-duplex connection.
+	 * 2.0 Signal the stop event to wake the event loop.
 	 */
-	shutdown(server_fd, SHUT_RDWR);
+	if (write(stop_fd, &signal, sizeof(signal)) < 0) {
+		perror("stop");
+	}
 }
 
 /**
  * This is the run method for the class.  It contains the code that is to run periodically on the given thread.
  */
 void NetworkManager::run() {
-	int valread;
 	struct sockaddr_in serverAddress;
-	struct sockaddr_in clientAddress;
 	int opt = 1;
-	int addrlen = sizeof(clientAddress);
-	int socketOpen;
-	networkMessageStruct receivedMessage;
+	struct epoll_event event;
+	struct epoll_event readyEvents[NETWORK_EPOLL_EVENTS];
 
 	/**
-	 * 1.0 Create a socket file descriptor.  The socket is a tcp socket.
+	 * 1.0 Create a socket file descriptor.  The socket is a non-blocking tcp socket, so that accepting never holds up the event loop.
 	 * If there is an error, indicate that the socket failed and return from the message.
 	 */
-	if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+	if ((server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
 		perror("socket failed");
 		return;
 	}
@@ -114,6 +170,7 @@ void NetworkManager::run() {
 	/**
 	 * 3.0 The connection is to be using an internet based format.
 	 */
+	memset(&serverAddress, 0, sizeof(serverAddress));
 	serverAddress.sin_family = AF_INET;
 
 	/**
@@ -126,104 +183,821 @@ void NetworkManager::run() {
 	serverAddress.sin_port = htons(portNumber);
 
 	/**
-	 * 6.0 Now bind the listening socket to the correct port.  If there is a failure, print out an error and exit the program.
+	 * 6.0 Now bind the listening socket to the correct port and listen on it.  If there is a failure, print out an error and exit the program.
 	 */
 	if (bind(server_fd, (struct sockaddr *) &serverAddress,
 			sizeof(serverAddress)) < 0) {
 		perror("bind failed");
 		exit(EXIT_FAILURE);
 	}
+	if (listen(server_fd, NETWORK_LISTEN_BACKLOG) < 0) {
+		perror("listen");
+		exit(EXIT_FAILURE);
+	}
+
+	/**
+	 * 7.0 Create the epoll instance and register the listening socket and the stop event with it.
+	 */
+	if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		perror("epoll_create1");
+		close(server_fd);
+		return;
+	}
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = LISTEN_TOKEN;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &event);
+	event.data.u32 = STOP_TOKEN;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
 
 	/**
-	 * 7.0 Loop so long as the thread is to continue running.
+	 * 7.1 Open the UDP command port, if there is to be one.  The TCP port still works if it cannot be opened.
+	 */
+	if (udpPortNumber != 0) {
+		openUdpPort();
+	}
+
+	/**
+	 * 8.0 Loop so long as the thread is to continue running, handling every socket which is ready.
 	 */
 	while (keepGoing) {
+		int readyCount = epoll_wait(epoll_fd, readyEvents, NETWORK_EPOLL_EVENTS, -1);
+		if (readyCount < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("epoll_wait");
+			break;
+		}
+		eventLoopWakeups.fetch_add(1, std::memory_order_relaxed);
+
+		for (int index = 0; index < readyCount; index++) {
+			uint32_t token = readyEvents[index].data.u32;
+			if (token == LISTEN_TOKEN) {
+				/**
+				 * 8.1 A connection is waiting, so accept it.
+				 */
+				acceptClients();
+			} else if (token == UDP_TOKEN) {
+				/**
+				 * 8.2 Datagrams have arrived on the UDP command port.
+				 */
+				receiveDatagrams();
+			} else if (token == STOP_TOKEN) {
+				/**
+				 * 8.3 The thread has been stopped.  keepGoing is already false, so the loop ends after this pass.
+				 */
+			} else if (clients[token].socket >= 0) {
+				/**
+				 * 8.4 A client has data, or has hung up or failed, which the receive finds and closes it for.
+				 */
+				receiveFromClient(token);
+			}
+		}
+	}
+
+	/**
+	 * 9.0 Close every client and the sockets of the event loop.
+	 */
+	for (int index = 0; index < MAX_NETWORK_CLIENTS; index++) {
+		if (clients[index].socket >= 0) {
+			closeClient(index);
+		}
+	}
+	if (udp_fd >= 0) {
+		close(udp_fd);
+		udp_fd = -1;
+	}
+	close(epoll_fd);
+	epoll_fd = -1;
+	close(server_fd);
+	server_fd = -1;
+}
+
+/**
+ * This method will accept every pending connection on the listening socket.
+ */
+void NetworkManager::acceptClients() {
+	struct sockaddr_in clientAddress;
+	socklen_t addrlen = sizeof(clientAddress);
+	int clientSocket;
+
+	while ((clientSocket = accept4(server_fd, (struct sockaddr*) &clientAddress, &addrlen, SOCK_CLOEXEC)) >= 0) {
+		/**
+		 * 1.0 Find a free slot for the client.  If the table is full, turn the client away.
+		 */
+		int index = 0;
+		while ((index < MAX_NETWORK_CLIENTS) && (clients[index].socket >= 0)) {
+			index++;
+		}
+		if (index == MAX_NETWORK_CLIENTS) {
+			printf("Rejected a connection, as %d clients are already connected.\n", MAX_NETWORK_CLIENTS);
+			close(clientSocket);
+			addrlen = sizeof(clientAddress);
+			continue;
+		}
+
 		/**
-		 * 7.1 Listen for and accept the given connection.  If there is an error, print out an error and exit.
+		 * 2.0 Register the client with the event loop and fill its slot.  Sends and receives on the socket are all made with
+		 * MSG_DONTWAIT, so a client which stops reading fills its send buffer rather than stalling the thread which sends to it.
 		 */
-		if (listen(server_fd, 3) < 0) {
-			perror("listen");
-			exit(EXIT_FAILURE);
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.u32 = index;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clientSocket, &event) < 0) {
+			perror("epoll_ctl");
+			close(clientSocket);
+		} else {
+			std::lock_guard<std::mutex> guard(clientMutex);
+			clients[index].socket = clientSocket;
+			clients[index].address = clientAddress;
+			clients[index].receiveHead = 0;
+			clients[index].receiveCount = 0;
+			clients[index].frameVersion = FRAME_VERSION_LEGACY;
+			clients[index].telemetrySequence = 0;
+			for (int channel = 0; channel < TELEMETRY_FIELD_COUNT; channel++) {
+				clients[index].channelPeriod[channel] = (int64_t) TELEMETRY_DEFAULT_PERIOD_MS * 1000000;
+				clients[index].channelDue[channel] = 0;
+			}
+			memset(&clients[index].link, 0, sizeof(networkLinkStruct));
+			linkSnapshots[index].store(clients[index].link);
+			versionClientCount[FRAME_VERSION_LEGACY]++;
+			clientCount++;
 		}
+		addrlen = sizeof(clientAddress);
+	}
+
+	if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (keepGoing)) {
+		perror("accept");
+	}
+}
+
+/**
+ * This method will receive from a client whose socket is readable, and handle each message once it has arrived in full.  One receive fills
+ * all of the free space in the client's ring, and every whole message in the ring is then parsed.  The part of a message which is left
+ * over stays in the ring for the next receive.
+ * @param index This is the index of the client.
+ */
+void NetworkManager::receiveFromClient(int index) {
+	networkClientStruct &client = clients[index];
+	struct iovec freeSpace[2];
+	struct msghdr header;
+
+	/**
+	 * 1.0 Describe the free space in the ring, which wraps around the end of the buffer into at most two pieces.
+	 */
+	uint32_t tail = (client.receiveHead + client.receiveCount) % receiveBufferSize;
+	uint32_t freeBytes = receiveBufferSize - client.receiveCount;
+	uint32_t firstPiece = (freeBytes < (receiveBufferSize - tail)) ? freeBytes : (receiveBufferSize - tail);
+	freeSpace[0].iov_base = &client.receiveBuffer[tail];
+	freeSpace[0].iov_len = firstPiece;
+	freeSpace[1].iov_base = client.receiveBuffer;
+	freeSpace[1].iov_len = freeBytes - firstPiece;
+	memset(&header, 0, sizeof(header));
+	header.msg_iov = freeSpace;
+	header.msg_iovlen = (freeSpace[1].iov_len > 0) ? 2 : 1;
+
+	/**
+	 * 2.0 Receive as much as is available and fits.
+	 */
+	ssize_t valread = recvmsg(client.socket, &header, MSG_DONTWAIT);
+	int64_t receiveTime = getMonotonicTimeNs();
+	receiveCalls.fetch_add(1, std::memory_order_relaxed);
 
+	/**
+	 * 3.0 If we receive 0 bytes, the socket has been closed, so close our end.  An error other than there being nothing to read does the same.
+	 */
+	if (valread == 0) {
+		closeClient(index);
+	} else if (valread < 0) {
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+			closeClient(index);
+		}
+	} else {
 		/**
-		 * 7.2 Accept the connection from the client, setting the connected socket to the value returned from the accept call.
-		 * If there is an error and the thread is to keep going, return after printing out an error if the thread is to continue running.
+		 * 4.0 Handle every whole message in the ring.  A message which wraps around the end of the ring is copied out in two pieces.
 		 */
-		if (((connectedSocket = accept(server_fd, (struct sockaddr*) &clientAddress, (socklen_t*) &addrlen)) < 0)
-				&& (keepGoing)) {
-			perror("connect");
-			return;
+		client.receiveCount += valread;
+		while (client.receiveCount >= sizeof(networkMessageStruct)) {
+			networkMessageStruct receivedMessage;
+			uint32_t untilEnd = receiveBufferSize - client.receiveHead;
+			if (untilEnd >= sizeof(networkMessageStruct)) {
+				memcpy(&receivedMessage, &client.receiveBuffer[client.receiveHead], sizeof(networkMessageStruct));
+			} else {
+				memcpy(&receivedMessage, &client.receiveBuffer[client.receiveHead], untilEnd);
+				memcpy(((uint8_t*) &receivedMessage) + untilEnd, client.receiveBuffer, sizeof(networkMessageStruct) - untilEnd);
+			}
+			client.receiveHead = (client.receiveHead + sizeof(networkMessageStruct)) % receiveBufferSize;
+			client.receiveCount -= sizeof(networkMessageStruct);
+			receivedMessages.fetch_add(1, std::memory_order_relaxed);
+			processMessage(receivedMessage, receiveTime, index, NULL);
 		}
-		socketOpen = sizeof(networkMessageStruct);
 
 		/**
-		 * 7.3 So long as the socket remains open and the thread continues running.
+		 * 5.0 Once the ring is empty, start filling it from the beginning again, so that the next receive has one contiguous piece.
 		 */
-		while ((socketOpen > 0) && (keepGoing)) {
-			valread = 0;
-			char* buf = (char*) &receivedMessage;
+		if (client.receiveCount == 0) {
+			client.receiveHead = 0;
+		}
+	}
+}
 
-			/**
-			 * 7.3.1 Receive the message.  Make sure to wait on all of the message being received.
-			 */
-			valread = recv(connectedSocket, buf, sizeof(networkMessageStruct), MSG_WAITALL);
+/**
+ * This method will open the UDP command port and register it with the event loop.
+ * @return true if the port is open.  False otherwise.
+ */
+bool NetworkManager::openUdpPort() {
+	struct sockaddr_in udpAddress;
+	struct epoll_event event;
+
+	if ((udp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+		perror("udp socket failed");
+		return false;
+	}
+
+	memset(&udpAddress, 0, sizeof(udpAddress));
+	udpAddress.sin_family = AF_INET;
+	udpAddress.sin_addr.s_addr = INADDR_ANY;
+	udpAddress.sin_port = htons(udpPortNumber);
+	if (bind(udp_fd, (struct sockaddr *) &udpAddress, sizeof(udpAddress)) < 0) {
+		perror("udp bind failed");
+		close(udp_fd);
+		udp_fd = -1;
+		return false;
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = UDP_TOKEN;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, udp_fd, &event) < 0) {
+		perror("epoll_ctl");
+		close(udp_fd);
+		udp_fd = -1;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * This method will receive every datagram which is waiting on the UDP command port, and handle each one which holds a message.
+ */
+void NetworkManager::receiveDatagrams() {
+	networkMessageStruct messages[UDP_RECEIVE_BATCH];
+	struct sockaddr_in senders[UDP_RECEIVE_BATCH];
+	struct iovec pieces[UDP_RECEIVE_BATCH];
+	struct mmsghdr headers[UDP_RECEIVE_BATCH];
+	int received;
+
+	/**
+	 * 1.0 Describe a slot for each datagram in the batch.
+	 */
+	memset(headers, 0, sizeof(headers));
+	for (int index = 0; index < UDP_RECEIVE_BATCH; index++) {
+		pieces[index].iov_base = &messages[index];
+		pieces[index].iov_len = sizeof(networkMessageStruct);
+		headers[index].msg_hdr.msg_iov = &pieces[index];
+		headers[index].msg_hdr.msg_iovlen = 1;
+		headers[index].msg_hdr.msg_name = &senders[index];
+		headers[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+	}
+
+	/**
+	 * 2.0 Receive batches until the socket is empty.  A datagram which is not exactly one message is ignored.
+	 */
+	do {
+		received = recvmmsg(udp_fd, headers, UDP_RECEIVE_BATCH, MSG_DONTWAIT, NULL);
+		int64_t receiveTime = getMonotonicTimeNs();
+		receiveCalls.fetch_add(1, std::memory_order_relaxed);
+
+		for (int index = 0; index < received; index++) {
+			if ((headers[index].msg_len == sizeof(networkMessageStruct))
+					&& ((headers[index].msg_hdr.msg_flags & MSG_TRUNC) == 0)) {
+				receivedMessages.fetch_add(1, std::memory_order_relaxed);
+				processMessage(messages[index], receiveTime, -1, findUdpPeer(senders[index], receiveTime));
+			}
+			headers[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		}
+	} while (received == UDP_RECEIVE_BATCH);
+
+	if ((received < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+		perror("recvmmsg");
+	}
+}
+
+/**
+ * This method will find the tracking slot for a UDP sender, taking over the slot of the sender heard from least recently if it is new.
+ * @param address This is the address of the sender.
+ * @param receiveTime This is when the datagram was received.
+ * @return The tracking slot for the sender.
+ */
+udpPeerStruct *NetworkManager::findUdpPeer(const struct sockaddr_in &address, int64_t receiveTime) {
+	udpPeerStruct *oldest = &udpPeers[0];
+	udpPeerStruct *peer = NULL;
+
+	/**
+	 * 1.0 Look for the sender, noting the slot which was used least recently on the way.
+	 */
+	for (int index = 0; (index < MAX_UDP_PEERS) && (peer == NULL); index++) {
+		udpPeerStruct &candidate = udpPeers[index];
+		if ((candidate.active) && (candidate.address.sin_addr.s_addr == address.sin_addr.s_addr)
+				&& (candidate.address.sin_port == address.sin_port)) {
+			peer = &candidate;
+		} else if ((oldest->active) && ((!candidate.active) || (candidate.lastHeard < oldest->lastHeard))) {
+			oldest = &candidate;
+		}
+	}
+
+	/**
+	 * 2.0 A new sender takes over the oldest slot.  A sender which has been silent for too long starts again with an empty window.
+	 */
+	if (peer == NULL) {
+		peer = oldest;
+		peer->address = address;
+		peer->active = true;
+		memset(peer->receivedWindow, 0, sizeof(peer->receivedWindow));
+		peer->frameVersion = FRAME_VERSION_LEGACY;
+		memset(&peer->link, 0, sizeof(networkLinkStruct));
+		linkSnapshots[MAX_NETWORK_CLIENTS + (peer - udpPeers)].store(peer->link);
+	} else if ((receiveTime - peer->lastHeard) > ((int64_t) UDP_PEER_IDLE_RESET_MS * 1000000)) {
+		memset(peer->receivedWindow, 0, sizeof(peer->receivedWindow));
+	}
+	peer->lastHeard = receiveTime;
+	return peer;
+}
+
+/**
+ * This method will decide whether a command from a UDP sender is to be applied, and record its message ID in the sender's window for the
+ * queue it is addressed to.  A command newer than any before to that queue is applied.  One which has already been received is a
+ * duplicate and is dropped.  One which is older than a command already applied to the same queue is stale, and is dropped unless the
+ * queue treats it as a safety command, such as a stop.
+ * @param peer This is the sender.
+ * @param receivedMessage This is the message, in host byte order.
+ * @return true if the command is to be applied.  False if it is to be dropped.
+ */
+bool NetworkManager::acceptUdpCommand(udpPeerStruct &peer, const networkMessageStruct &receivedMessage) {
+	uint32_t messageID = (uint32_t) receivedMessage.messageID;
+	uint32_t &newestID = peer.newestID[receivedMessage.messageDestination - 1];
+	uint64_t &receivedWindow = peer.receivedWindow[receivedMessage.messageDestination - 1];
+
+	/**
+	 * 1.0 The first message from a sender to a queue starts its window.  A command to one queue never makes one to another stale, so an
+	 * out of order horn command is not dropped because a newer motion command overtook it.
+	 */
+	if (receivedWindow == 0) {
+		newestID = messageID;
+		receivedWindow = 1;
+		return true;
+	}
+
+	/**
+	 * 2.0 Compare the ID with the newest one, allowing for the IDs wrapping around.  A newer ID slides the window forward.
+	 */
+	int32_t age = (int32_t) (newestID - messageID);
+	if (age < 0) {
+		uint32_t advance = (uint32_t) (-(int64_t) age);
+		receivedWindow = (advance >= UDP_WINDOW_SIZE) ? 1 : ((receivedWindow << advance) | 1);
+		newestID = messageID;
+		return true;
+	}
+
+	/**
+	 * 3.0 An ID within the window which has been seen before is a duplicate.
+	 */
+	uint64_t bit = (age < UDP_WINDOW_SIZE) ? (((uint64_t) 1) << age) : 0;
+	if ((receivedWindow & bit) != 0) {
+		udpDuplicates.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	/**
+	 * 4.0 Otherwise the command is older than one already applied.  It would undo the newer command, so it is dropped, unless it is a
+	 * safety command, which must never be lost.
+	 */
+	if (referencequeue[receivedMessage.messageDestination - 1]->isSafetyCommand(receivedMessage.message)) {
+		receivedWindow |= bit;
+		return true;
+	}
+	udpStale.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+/**
+ * This method will close a client's socket and free its slot.
+ * @param index This is the index of the client.
+ */
+void NetworkManager::closeClient(int index) {
+	std::lock_guard<std::mutex> sendGuard(clients[index].sendMutex);
+	std::lock_guard<std::mutex> guard(clientMutex);
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, clients[index].socket, NULL);
+	close(clients[index].socket);
+	clients[index].socket = -1;
+	clients[index].receiveHead = 0;
+	clients[index].receiveCount = 0;
+	linkSnapshots[index].store(networkLinkStruct());
+	versionClientCount[clients[index].frameVersion]--;
+	clientCount--;
+}
+
+/**
+ * This method will check a received message and enqueue its command to the queue it is addressed to.
+ * @param receivedMessage This is the message, in network byte order.
+ * @param receiveTime This is when the message was received, from the monotonic clock in nanoseconds.
+ * @param clientIndex This is the index of the client the message came from, or -1 if it came in a datagram.
+ * @param udpPeer This is the sender if the message came in a datagram, whose window decides if the command is applied.  It is NULL
+ * for a message from a connected client.
+ */
+void NetworkManager::processMessage(networkMessageStruct &receivedMessage, int64_t receiveTime, int clientIndex, udpPeerStruct *udpPeer) {
+	int frameVersion;
+
+	/**
+	 * 1.0 Check the frame, in whichever format it was sent, and convert it to host byte order.
+	 */
+	if (decodeFrame(receivedMessage, frameVersion)) {
+		/**
+		 * 2.1 The sender is answered in the format it last sent.  Only this thread changes the format, so the lock is only needed to
+		 * change it.
+		 */
+		int &senderVersion = (udpPeer == NULL) ? clients[clientIndex].frameVersion : udpPeer->frameVersion;
+		if (senderVersion != frameVersion) {
+			std::lock_guard<std::mutex> guard(clientMutex);
+			if (udpPeer == NULL) {
+				versionClientCount[senderVersion]--;
+				versionClientCount[frameVersion]++;
+			}
+			senderVersion = frameVersion;
+		}
+
+		/**
+		 * 2.2 The message is valid.  A ping is answered straight away, so that the time the robot holds it is as short as possible.
+		 */
+		if (receivedMessage.messageType == PING_MSG_TYPE) {
+			answerPing(receivedMessage, receiveTime, clientIndex, udpPeer);
+		}
+
+		/**
+		 * 2.3 A subscription only applies to a connected client, since telemetry is only sent over TCP.
+		 */
+		else if ((receivedMessage.messageType == SUBSCRIBE_MSG_TYPE) && (udpPeer == NULL)) {
+			subscribe(clientIndex, (uint32_t) receivedMessage.message, (uint32_t) receivedMessage.messageDestination);
+		}
+
+		/**
+		 * 2.4 Enqueue it to the right queue if the destination queue is valid and it is a COMMAND_MSG_TYPE.
+		 * A command which came in a datagram must also be neither a duplicate nor stale.
+		 */
+		else if ((receivedMessage.messageType == COMMAND_MSG_TYPE) &&
+			(receivedMessage.messageDestination > 0) &&
+			(receivedMessage.messageDestination <= NUMBER_OF_QUEUES) &&
+			((udpPeer == NULL) || (acceptUdpCommand(*udpPeer, receivedMessage)))) {
+			CommandEnvelope envelope = CommandEnvelope();
+			envelope.command = receivedMessage.message;
+			envelope.messageID = receivedMessage.messageID;
+			envelope.source = (udpPeer == NULL) ? COMMAND_SOURCE_NETWORK : COMMAND_SOURCE_NETWORK_UDP;
+			envelope.receiveTime = receiveTime;
+			(*(referencequeue[receivedMessage.messageDestination - 1])).enqueue(envelope);
+		}
+	}
+}
+
+/**
+ * This method will set the period at which a client is sent a set of telemetry channels.
+ * @param index This is the index of the client.
+ * @param channelMask This is the mask of the channels.  Bit n is telemetry field n.
+ * @param periodMs This is the period, in milliseconds.  0 stops the channels being sent.
+ */
+void NetworkManager::subscribe(int index, uint32_t channelMask, uint32_t periodMs) {
+	std::lock_guard<std::mutex> guard(clientMutex);
+	for (int channel = 0; channel < TELEMETRY_FIELD_COUNT; channel++) {
+		if ((channelMask & (1u << channel)) != 0) {
+			clients[index].channelPeriod[channel] = (int64_t) periodMs * 1000000;
+			clients[index].channelDue[channel] = 0;
+		}
+	}
+}
+
+/**
+ * This method will find which telemetry channels in a record are due to be sent to a client, and move each of them on to its next due
+ * time.  The client mutex must be held.
+ * @param client This is the client.
+ * @param record This is the record.
+ * @param tolerance This is how early a channel may be sent, in nanoseconds, so that release jitter does not hold it back a whole
+ * period.
+ * @return The mask of the channels due.
+ */
+uint32_t NetworkManager::takeDueChannels(networkClientStruct &client, const TelemetryRecord &record, int64_t tolerance) {
+	uint32_t dueChannels = 0;
+	int64_t sampleTime = record.getSampleTime();
+
+	for (int channel = 0; channel < TELEMETRY_FIELD_COUNT; channel++) {
+		if ((client.channelPeriod[channel] > 0) && (record.has(channel)) && ((sampleTime + tolerance) >= client.channelDue[channel])) {
+			dueChannels |= (1u << channel);
 
 			/**
-			 * 7.3.2 Check to see if 0 bytes were received.
+			 * A channel keeps to its own schedule, unless it has fallen a whole period behind, when it starts again from this sample.
 			 */
-			if (valread == 0) {
-				/**
-				 * 7.3.2.1 If we receive 0 bytes, the socket has been closed so abort.
-				 */
-				socketOpen = 0;
-				close(connectedSocket);
-				connectedSocket = 0;
-			} else {
-				/**
-				 * 7.3.3.1 Otherwise, Convert the message to the appropriate endian format.
-				 * Do this by converting each individual structure element accordingly.
-				 */
-				receivedMessage.messageID = ntohl(receivedMessage.messageID);
-				receivedMessage.timestampHigh = ntohl(receivedMessage.timestampHigh);
-				receivedMessage.timestampLow = ntohl(receivedMessage.timestampLow);
-				receivedMessage.messageType = ntohl(receivedMessage.messageType);
-				receivedMessage.message = ntohl(receivedMessage.message);
-				receivedMessage.messageDestination = ntohl(receivedMessage.messageDestination);
-				receivedMessage.xorChecksum = ntohl(receivedMessage.xorChecksum);
+			client.channelDue[channel] += client.channelPeriod[channel];
+			if (client.channelDue[channel] <= sampleTime) {
+				client.channelDue[channel] = sampleTime + client.channelPeriod[channel];
+			}
+		}
+	}
+	return dueChannels;
+}
 
-				/**
-				 * 7.3.3.2 Calculate the XOR checksum of the data received, not including the checksum field.
-				 */
-				int calculatedChecksum = receivedMessage.messageID
-						^ receivedMessage.timestampHigh
-						^ receivedMessage.timestampLow
-						^ receivedMessage.messageType ^ receivedMessage.message
-						^ receivedMessage.messageDestination;
+/**
+ * This method will answer a ping straight away, on the socket it came in on, and update the latency estimates for its link.
+ * @param receivedMessage This is the ping, in host byte order.
+ * @param receiveTime This is when the ping was received, from the monotonic clock in nanoseconds.
+ * @param clientIndex This is the index of the client the ping came from, or -1 if it came in a datagram.
+ * @param udpPeer This is the sender if the ping came in a datagram.  It is NULL otherwise.
+ */
+void NetworkManager::answerPing(const networkMessageStruct &receivedMessage, int64_t receiveTime, int clientIndex, udpPeerStruct *udpPeer) {
+	networkMessageStruct reply;
 
-				/**
-				 * 7.3.3.3 Verify that the received checksum matchess the checksum that was transmitted.
-				 **/
-				if (calculatedChecksum == receivedMessage.xorChecksum) {
-					/**
-					 * 7.3.3.3.1 The message is valid.  Enqueue it to the right queue if the destination queue is valid and it is a COMMAND_MSG_TYPE.
-					 */
-					if ((receivedMessage.messageType == COMMAND_MSG_TYPE) &&
-						(receivedMessage.messageDestination > 0) &&
-						(receivedMessage.messageDestination <= NUMBER_OF_QUEUES)) {
-						(*(referencequeue[receivedMessage.messageDestination - 1])).enqueue(receivedMessage.message);
-					}
+	/**
+	 * 1.0 The client's send time and message ID go back unchanged, with the robot's receive time and send time alongside.
+	 */
+	reply.messageID = receivedMessage.messageID;
+	reply.timestampHigh = receivedMessage.timestampHigh;
+	reply.timestampLow = receivedMessage.timestampLow;
+	reply.messageType = PING_REPLY_MSG_TYPE;
+	reply.messageDestination = (int32_t) (uint32_t) (receiveTime / 1000);
+
+	/**
+	 * 2.0 Hold the client's send mutex while sending, so that the reply is not interleaved with a broadcast.  Only this thread changes
+	 * the frame format and the link, so the client mutex is not needed.  The updated link is published for other threads to read.
+	 */
+	std::unique_lock<std::mutex> sendGuard;
+	if (udpPeer == NULL) {
+		sendGuard = std::unique_lock<std::mutex>(clients[clientIndex].sendMutex);
+	}
+	reply.message = (int32_t) (uint32_t) (getMonotonicTimeNs() / 1000);
+	reply.xorChecksum = reply.messageID ^ reply.timestampHigh ^ reply.timestampLow ^ reply.messageType ^ reply.message
+			^ reply.messageDestination;
+	encodeFrame(reply, (udpPeer == NULL) ? clients[clientIndex].frameVersion : udpPeer->frameVersion);
+
+	if (udpPeer != NULL) {
+		sendto(udp_fd, &reply, sizeof(reply), MSG_DONTWAIT, (struct sockaddr *) &udpPeer->address, sizeof(udpPeer->address));
+		updateLink(udpPeer->link, receivedMessage, receiveTime);
+		linkSnapshots[MAX_NETWORK_CLIENTS + (udpPeer - udpPeers)].store(udpPeer->link);
+	} else if (clients[clientIndex].socket >= 0) {
+		if (send(clients[clientIndex].socket, &reply, sizeof(reply), MSG_NOSIGNAL | MSG_DONTWAIT) != sizeof(reply)) {
+			shutdown(clients[clientIndex].socket, SHUT_RDWR);
+		}
+		updateLink(clients[clientIndex].link, receivedMessage, receiveTime);
+		linkSnapshots[clientIndex].store(clients[clientIndex].link);
+	}
+}
+
+/**
+ * This method will update the latency estimates for a link from a ping.
+ * @param link These are the latency estimates.
+ * @param receivedMessage This is the ping, in host byte order.
+ * @param receiveTime This is when the ping was received, from the monotonic clock in nanoseconds.
+ */
+void NetworkManager::updateLink(networkLinkStruct &link, const networkMessageStruct &receivedMessage, int64_t receiveTime) {
+	int64_t sendTime = (int64_t) ((((uint64_t) (uint32_t) receivedMessage.timestampHigh) << 32) | (uint32_t) receivedMessage.timestampLow)
+			* 1000;
+	int64_t roundTrip = (int64_t) (uint32_t) receivedMessage.message * 1000;
+	int64_t clockDifference = receiveTime - sendTime;
+
+	link.pingCount++;
+
+	/**
+	 * 1.0 Smooth the round trip time reported by the client, the same way TCP does, with gains of 1/8 for the time and 1/4 for its
+	 * variation.
+	 */
+	if (roundTrip > 0) {
+		if (link.smoothedRoundTrip == 0) {
+			link.smoothedRoundTrip = roundTrip;
+			link.roundTripVariation = roundTrip / 2;
+			link.minimumRoundTrip = roundTrip;
+		} else {
+			int64_t error = (roundTrip > link.smoothedRoundTrip) ? (roundTrip - link.smoothedRoundTrip) : (link.smoothedRoundTrip - roundTrip);
+			link.roundTripVariation = (3 * link.roundTripVariation + error) / 4;
+			link.smoothedRoundTrip = (7 * link.smoothedRoundTrip + roundTrip) / 8;
+			if (roundTrip < link.minimumRoundTrip) {
+				link.minimumRoundTrip = roundTrip;
+			}
+		}
+	}
+
+	/**
+	 * 2.0 The fastest ping sets the baseline for the clock difference.  Every ping's one way time is then half the fastest round trip,
+	 * plus however much longer than the fastest ping it took to arrive.
+	 */
+	if ((link.pingCount == 1) || (clockDifference < link.minimumClockDifference)) {
+		link.minimumClockDifference = clockDifference;
+	}
+	if (link.minimumRoundTrip > 0) {
+		int64_t oneWay = (clockDifference - link.minimumClockDifference) + (link.minimumRoundTrip / 2);
+		link.smoothedOneWay = (link.smoothedOneWay == 0) ? oneWay : ((7 * link.smoothedOneWay + oneWay) / 8);
+	}
+}
+
+/**
+ * This method will send data to every connected client which takes the given frame format, with one system call per client.  A client
+ * whose send buffer cannot take the data, or whose connection has failed, is shut down, and the event loop will then close it.  The client
+ * mutex is only held while a client's telemetry is encoded, and never across a send, so a slow client does not hold up the event loop.
+ * @param pieces These are the pieces of data to send, in order.
+ * @param pieceCount This is the number of pieces.  It is at most BROADCAST_MAX_PIECES.
+ * @param frameVersion This is the frame format the data is in.  It is one of the FRAME_VERSION values.
+ * @param telemetry This is a telemetry record.  Each client using CRC32C frames is sent, after the data, the channels of it which are
+ * due under its subscription.  It may be NULL.
+ * @param sendCalls If this is not NULL, the number of send system calls made is added to it.  A send which fails or is short still
+ * counts, so it can be more than the number of clients the data was sent to.
+ * @return The number of clients the data was sent to.
+ */
+uint32_t NetworkManager::broadcast(const struct iovec *pieces, int pieceCount, int frameVersion, const TelemetryRecord *telemetry,
+		uint32_t *sendCalls) {
+	uint32_t sentCount = 0;
+	size_t dataLength = 0;
+	struct msghdr header;
+	struct iovec clientPieces[BROADCAST_MAX_PIECES + 2];
+	networkMessageStruct telemetryHeader;
+	uint8_t telemetryPayload[TELEMETRY_MAX_RECORD_SIZE];
+
+	if ((pieceCount < 0) || (pieceCount > BROADCAST_MAX_PIECES)) {
+		return 0;
+	}
+	for (int index = 0; index < pieceCount; index++) {
+		clientPieces[index] = pieces[index];
+		dataLength += pieces[index].iov_len;
+	}
+	if (frameVersion != FRAME_VERSION_CRC32C) {
+		telemetry = NULL;
+	}
+	memset(&header, 0, sizeof(header));
+	header.msg_iov = clientPieces;
+
+	/**
+	 * 1.0 A channel may be sent up to half a record interval early, so that one which falls due just after a sample is not held back to
+	 * the sample after.
+	 */
+	int64_t tolerance = 0;
+	if (telemetry != NULL) {
+		std::lock_guard<std::mutex> guard(clientMutex);
+		if ((lastTelemetrySample > 0) && (telemetry->getSampleTime() > lastTelemetrySample)) {
+			tolerance = (telemetry->getSampleTime() - lastTelemetrySample) / 2;
+		}
+		lastTelemetrySample = telemetry->getSampleTime();
+	}
+
+	for (int index = 0; index < MAX_NETWORK_CLIENTS; index++) {
+		/**
+		 * 2.0 The client's send mutex keeps its socket from being closed, and its descriptor reused, until the send is made.  The socket
+		 * and the client's telemetry are taken under the client mutex, which is then released before sending.
+		 */
+		std::lock_guard<std::mutex> sendGuard(clients[index].sendMutex);
+		int clientSocket = -1;
+		size_t length = dataLength;
+		header.msg_iovlen = pieceCount;
+		{
+			std::lock_guard<std::mutex> guard(clientMutex);
+			if ((clients[index].socket < 0) || (clients[index].frameVersion != frameVersion)) {
+				continue;
+			}
+			clientSocket = clients[index].socket;
+
+			/**
+			 * 3.0 The record was sampled once for every client.  Each client is sent only the channels which are due for it, encoded for
+			 * it, so a fast subscriber costs the others nothing.
+			 */
+			if (telemetry != NULL) {
+				uint32_t dueChannels = takeDueChannels(clients[index], *telemetry, tolerance);
+				if (dueChannels != 0) {
+					uint32_t recordLength = encodeTelemetryFrame(telemetryHeader, telemetryPayload, *telemetry, dueChannels,
+							clients[index].telemetrySequence++, TELEMETRY_ENCODING);
+					clientPieces[pieceCount].iov_base = &telemetryHeader;
+					clientPieces[pieceCount].iov_len = sizeof(telemetryHeader);
+					clientPieces[pieceCount + 1].iov_base = telemetryPayload;
+					clientPieces[pieceCount + 1].iov_len = recordLength;
+					header.msg_iovlen = pieceCount + 2;
+					length += sizeof(telemetryHeader) + recordLength;
+					telemetryFrames.fetch_add(1, std::memory_order_relaxed);
 				}
 			}
 		}
+		if (length == 0) {
+			continue;
+		}
+
+		/**
+		 * 4.0 A short send leaves the client part way through a message, so it cannot be resynchronized and is dropped like a failed one.
+		 * MSG_DONTWAIT keeps a client whose send buffer is full from stalling the others, and MSG_NOSIGNAL keeps a client which has gone
+		 * away from raising SIGPIPE.
+		 */
+		if (sendCalls != NULL) {
+			(*sendCalls)++;
+		}
+		if (sendmsg(clientSocket, &header, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t) length) {
+			sentCount++;
+		} else {
+			shutdown(clientSocket, SHUT_RDWR);
+		}
+	}
+	return sentCount;
+}
+
+/**
+ * This method will return the number of connected clients.
+ * @return The number of connected clients.
+ */
+uint32_t NetworkManager::getClientCount() {
+	return clientCount.load();
+}
+
+/**
+ * This method will return the number of connected clients which take a given frame format.  It does not take the client mutex.
+ * @param frameVersion This is the frame format.  It is one of the FRAME_VERSION values.
+ * @return The number of connected clients which take the format.
+ */
+uint32_t NetworkManager::getClientCount(int frameVersion) {
+	if ((frameVersion < 0) || (frameVersion > FRAME_VERSION_CRC32C)) {
+		return 0;
 	}
+	return versionClientCount[frameVersion].load();
+}
+
+/**
+ * This method will return the number of receive system calls made on client sockets.
+ * @return The number of receive calls.
+ */
+uint64_t NetworkManager::getReceiveCallCount() {
+	return receiveCalls.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the number of times the event loop has woken up.
+ * @return The number of wakeups.
+ */
+uint64_t NetworkManager::getEventLoopWakeupCount() {
+	return eventLoopWakeups.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the number of whole messages received from the clients, whether or not they were valid.
+ * @return The number of messages.
+ */
+uint64_t NetworkManager::getReceivedMessageCount() {
+	return receivedMessages.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the number of UDP commands dropped as duplicates.
+ * @return The number of duplicates.
+ */
+uint64_t NetworkManager::getUdpDuplicateCount() {
+	return udpDuplicates.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the number of UDP commands dropped because a newer command had already been applied.
+ * @return The number of stale commands.
+ */
+uint64_t NetworkManager::getUdpStaleCount() {
+	return udpStale.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the number of telemetry frames sent, over every client.
+ * @return The number of telemetry frames.
+ */
+uint64_t NetworkManager::getTelemetryFrameCount() {
+	return telemetryFrames.load(std::memory_order_relaxed);
 }
 
 /**
- * This method will return the socket ID for the given class.
- * @return The socket ID will be returned.
+ * This method will obtain the latency estimates for a link, from its snapshot.  It does not take the client mutex.
+ * @param link This is the link.  Links below MAX_NETWORK_CLIENTS are TCP clients, and the rest are UDP senders.
+ * @param estimates This is where the estimates are written.
+ * @return true if the link is in use and has received a ping.  False otherwise.
  */
-int NetworkManager::getSocketID() {
-	return connectedSocket;
+bool NetworkManager::getLinkStatistics(int link, networkLinkStruct &estimates) {
+	if ((link < 0) || (link >= NETWORK_LINKS)) {
+		return false;
+	}
+	estimates = linkSnapshots[link].load();
+	return (estimates.pingCount > 0);
 }
 
+/**
+ * This method will print the latency estimates for every link which has received a ping.
+ * @param os This is the stream that the estimates are to be printed to.
+ */
+void NetworkManager::printLinkStatistics(std::ostream &os) {
+	networkLinkStruct estimates;
+
+	os << std::setw(8) << "Link" << "\t" << std::setw(8) << "Pings" << "\t" << std::setw(10) << "RTT us" << "\t" << std::setw(10)
+			<< "RTTVar us" << "\t" << std::setw(10) << "MinRTT us" << "\t" << std::setw(10) << "OneWay us" << "\n";
+	for (int link = 0; link < NETWORK_LINKS; link++) {
+		if (getLinkStatistics(link, estimates)) {
+			os << std::setw(4) << ((link < MAX_NETWORK_CLIENTS) ? "TCP " : "UDP ")
+					<< std::setw(4) << ((link < MAX_NETWORK_CLIENTS) ? link : (link - MAX_NETWORK_CLIENTS)) << "\t"
+					<< std::setw(8) << estimates.pingCount << "\t" << std::setw(10) << (estimates.smoothedRoundTrip / 1000) << "\t"
+					<< std::setw(10) << (estimates.roundTripVariation / 1000) << "\t" << std::setw(10) << (estimates.minimumRoundTrip / 1000)
+					<< "\t" << std::setw(10) << (estimates.smoothedOneWay / 1000) << "\n";
+		}
+	}
+}
@@ -21,6 +21,8 @@
  *
  * @section DESCRIPTION
  * This file defines the interface for the Network Manager.  The Network Manager manages network connections and acts as a server, receiving messages sent over a socket to the class.
+ * It serves up to MAX_NETWORK_CLIENTS clients at once from a single thread, using an epoll event loop over the listening socket, the connected
+ * clients, and an event which is signalled to stop the loop.
  */
 
 #ifndef NETWORKMANAGER_H_
@@ -31,8 +33,163 @@
 #include "RunnableClass.h"
 #include "NetworkCfg.h"
 #include "NetworkMessage.h"
+#include "TelemetryRecord.h"
+#include "SeqLockSnapshot.h"
 #include <string>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <sys/uio.h>
+#include <ostream>
 
+/**
+ * This structure holds the latency estimates for the link to one client, which are updated from the client's pings.  The round trip
+ * times are reported by the client.  The one way time is the robot's own estimate of how long a message takes to reach it.  It is
+ * taken from the difference between the client's send time and the robot's receive time, with the clock offset worked out from the
+ * fastest exchange, which is assumed to have taken as long in each direction.  All times are in nanoseconds.
+ */
+struct networkLinkStruct {
+	/**
+	 * This is the number of pings received on the link.
+	 */
+	uint32_t pingCount;
+
+	/**
+	 * This is the smoothed round trip time.  It is 0 until the client has reported one.
+	 */
+	int64_t smoothedRoundTrip;
+
+	/**
+	 * This is the smoothed variation of the round trip time.
+	 */
+	int64_t roundTripVariation;
+
+	/**
+	 * This is the shortest round trip time reported.
+	 */
+	int64_t minimumRoundTrip;
+
+	/**
+	 * This is the smallest difference seen between the robot's receive time and the client's send time.  It is the clock offset plus the
+	 * fastest one way time.
+	 */
+	int64_t minimumClockDifference;
+
+	/**
+	 * This is the smoothed one way time from the client to the robot.
+	 */
+	int64_t smoothedOneWay;
+};
+
+/**
+ * This structure holds the state of one connected client.
+ */
+struct networkClientStruct {
+	/**
+	 * This is the connected socket for the client.  It is -1 when the slot is free.
+	 */
+	int socket;
+
+	/**
+	 * This is the address the client connected from.
+	 */
+	struct sockaddr_in address;
+
+	/**
+	 * This is the receive ring for the client.  It holds bytes which have been received but not yet parsed, which is at most part of one
+	 * message between receives.
+	 */
+	uint8_t *receiveBuffer;
+
+	/**
+	 * This is the index in the receive ring of the first byte which has not been parsed.
+	 */
+	uint32_t receiveHead;
+
+	/**
+	 * This is the number of bytes in the receive ring which have not been parsed.
+	 */
+	uint32_t receiveCount;
+
+	/**
+	 * This is the frame format the client last sent, which it is also sent in.  It is one of the FRAME_VERSION values, and is guarded by
+	 * the client mutex.
+	 */
+	int frameVersion;
+
+	/**
+	 * These are the periods at which each telemetry channel is sent to the client, in nanoseconds.  A period of 0 means the channel is not
+	 * sent.  They are guarded by the client mutex, as are the due times and the sequence number.
+	 */
+	int64_t channelPeriod[TELEMETRY_FIELD_COUNT];
+
+	/**
+	 * These are the sample times from which each telemetry channel is next due to be sent to the client, in nanoseconds.
+	 */
+	int64_t channelDue[TELEMETRY_FIELD_COUNT];
+
+	/**
+	 * This is the sequence number of the next telemetry frame sent to the client.
+	 */
+	uint32_t telemetrySequence;
+
+	/**
+	 * These are the latency estimates for the client.  They are only used by the thread running the event loop, which publishes them to
+	 * the client's link snapshot.
+	 */
+	networkLinkStruct link;
+
+	/**
+	 * This mutex is held while sending to the client, so that its socket is not closed, and the descriptor reused, during a send made
+	 * outside the client mutex.  It also keeps two messages sent to the client from interleaving.  It is taken before the client mutex.
+	 */
+	std::mutex sendMutex;
+};
+
+/**
+ * This structure holds the message IDs recently received from one UDP sender.  There is a window for each queue the sender commands,
+ * since commands to different queues do not supersede each other.  Each window covers the newest ID sent to its queue and the 63 before
+ * it, so that a duplicated datagram can be recognized and dropped, and a datagram which arrives after a newer one to the same queue can
+ * be recognized as stale.
+ */
+struct udpPeerStruct {
+	/**
+	 * This is the address and port the sender sends from.
+	 */
+	struct sockaddr_in address;
+
+	/**
+	 * This indicates that the slot is tracking a sender.
+	 */
+	bool active;
+
+	/**
+	 * These are the newest message IDs received from the sender for each queue, indexed by the destination less 1.
+	 */
+	uint32_t newestID[NUMBER_OF_QUEUES];
+
+	/**
+	 * These record which message IDs in each queue's window have been received.  Bit n is set if newestID - n has been received.  A
+	 * window of 0 is empty.
+	 */
+	uint64_t receivedWindow[NUMBER_OF_QUEUES];
+
+	/**
+	 * This is when the sender was last heard from, from the monotonic clock in nanoseconds.
+	 */
+	int64_t lastHeard;
+
+	/**
+	 * This is the frame format the sender last sent, which ping replies to it are also sent in.  It is one of the FRAME_VERSION values.
+	 */
+	int frameVersion;
+
+	/**
+	 * These are the latency estimates for the sender.  They are published to the sender's link snapshot.
+	 */
+	networkLinkStruct link;
+};
 
 class NetworkManager: public RunnableClass {
 private:
@@ -48,12 +205,193 @@ private:
 	/**
 	 * This integer is the file descriptor for the socket that is going to be listened to for connections.
 	 */
-	int server_fd=0;
+	int server_fd=-1;
+
+	/**
+	 * This is the epoll instance which the event loop waits on.
+	 */
+	int epoll_fd=-1;
+
+	/**
+	 * This is the UDP port for commands.  It is 0 if there is no UDP command port.
+	 */
+	unsigned short udpPortNumber;
+
+	/**
+	 * This is the socket for the UDP command port.
+	 */
+	int udp_fd=-1;
+
+	/**
+	 * These are the UDP senders whose message IDs are being tracked.  They are only used by the thread running the event loop.
+	 */
+	udpPeerStruct udpPeers[MAX_UDP_PEERS];
+
+	/**
+	 * This is the number of UDP commands dropped because their message ID had already been received.
+	 */
+	std::atomic<uint64_t> udpDuplicates;
+
+	/**
+	 * This is the number of UDP commands dropped because a newer command from the same sender to the same queue had already been applied.
+	 */
+	std::atomic<uint64_t> udpStale;
 
 	/**
-	 * This is the connected socket of the network manager.  This will be updated whenever a connection is made and it is used to send messages back to the master as well as to receive messages from the master.
+	 * This is an event file descriptor which is written to by stop, so that the event loop wakes up and sees that it is to finish.
 	 */
-	int connectedSocket=0;
+	int stop_fd=-1;
+
+	/**
+	 * These are the connected clients.  A slot is only filled and emptied by the thread running the event loop, under the client mutex.
+	 */
+	networkClientStruct clients[MAX_NETWORK_CLIENTS];
+
+	/**
+	 * This mutex guards the client slots.  It is never held across a send, as each client's send mutex keeps its socket open while one
+	 * is made.
+	 */
+	std::mutex clientMutex;
+
+	/**
+	 * This is the number of connected clients.
+	 */
+	std::atomic<uint32_t> clientCount;
+
+	/**
+	 * These are the numbers of connected clients which take each frame format, indexed by the FRAME_VERSION value.  They are kept as the
+	 * clients connect, disconnect and change format, so that they can be read without taking the client mutex.
+	 */
+	std::atomic<uint32_t> versionClientCount[FRAME_VERSION_CRC32C + 1];
+
+	/**
+	 * These are the latest latency estimates for each link, as published by the thread running the event loop.  They can be read from
+	 * any thread without taking the client mutex.  A link which is not in use has no pings.
+	 */
+	SeqLockSnapshot<networkLinkStruct> linkSnapshots[NETWORK_LINKS];
+
+	/**
+	 * This is the size of each client's receive ring, in bytes.
+	 */
+	uint32_t receiveBufferSize;
+
+	/**
+	 * This is the number of receive system calls made on client sockets.
+	 */
+	std::atomic<uint64_t> receiveCalls;
+
+	/**
+	 * This is the number of times the event loop has woken up.
+	 */
+	std::atomic<uint64_t> eventLoopWakeups;
+
+	/**
+	 * This is the number of whole messages parsed from the clients.
+	 */
+	std::atomic<uint64_t> receivedMessages;
+
+	/**
+	 * This is the sample time of the last telemetry record broadcast, in nanoseconds.  It is guarded by the client mutex.
+	 */
+	int64_t lastTelemetrySample = 0;
+
+	/**
+	 * This is the number of telemetry frames sent, over every client.
+	 */
+	std::atomic<uint64_t> telemetryFrames;
+
+	/**
+	 * This method will accept every pending connection on the listening socket.
+	 */
+	void acceptClients();
+
+	/**
+	 * This method will receive from a client whose socket is readable, and handle each message once it has arrived in full.
+	 * @param index This is the index of the client.
+	 */
+	void receiveFromClient(int index);
+
+	/**
+	 * This method will open the UDP command port and register it with the event loop.
+	 * @return true if the port is open.  False otherwise.
+	 */
+	bool openUdpPort();
+
+	/**
+	 * This method will receive every datagram which is waiting on the UDP command port, and handle each one which holds a message.
+	 */
+	void receiveDatagrams();
+
+	/**
+	 * This method will find the tracking slot for a UDP sender, taking over the slot of the sender heard from least recently if it is new.
+	 * @param address This is the address of the sender.
+	 * @param receiveTime This is when the datagram was received.
+	 * @return The tracking slot for the sender.
+	 */
+	udpPeerStruct *findUdpPeer(const struct sockaddr_in &address, int64_t receiveTime);
+
+	/**
+	 * This method will decide whether a command from a UDP sender is to be applied, and record its message ID in the sender's window for
+	 * the queue it is addressed to.  A command newer than any before to that queue is applied.  One which has already been received is a
+	 * duplicate and is dropped.  One which is older than a command already applied to the same queue is stale, and is dropped unless the
+	 * queue treats it as a safety command, such as a stop.
+	 * @param peer This is the sender.
+	 * @param receivedMessage This is the message, in host byte order.
+	 * @return true if the command is to be applied.  False if it is to be dropped.
+	 */
+	bool acceptUdpCommand(udpPeerStruct &peer, const networkMessageStruct &receivedMessage);
+
+	/**
+	 * This method will close a client's socket and free its slot.
+	 * @param index This is the index of the client.
+	 */
+	void closeClient(int index);
+
+	/**
+	 * This method will set the period at which a client is sent a set of telemetry channels.
+	 * @param index This is the index of the client.
+	 * @param channelMask This is the mask of the channels.  Bit n is telemetry field n.
+	 * @param periodMs This is the period, in milliseconds.  0 stops the channels being sent.
+	 */
+	void subscribe(int index, uint32_t channelMask, uint32_t periodMs);
+
+	/**
+	 * This method will find which telemetry channels in a record are due to be sent to a client, and move each of them on to its next due
+	 * time.  The client mutex must be held.
+	 * @param client This is the client.
+	 * @param record This is the record.
+	 * @param tolerance This is how early a channel may be sent, in nanoseconds, so that release jitter does not hold it back a whole
+	 * period.
+	 * @return The mask of the channels due.
+	 */
+	static uint32_t takeDueChannels(networkClientStruct &client, const TelemetryRecord &record, int64_t tolerance);
+
+	/**
+	 * This method will answer a ping straight away, on the socket it came in on, and update the latency estimates for its link.
+	 * @param receivedMessage This is the ping, in host byte order.
+	 * @param receiveTime This is when the ping was received, from the monotonic clock in nanoseconds.
+	 * @param clientIndex This is the index of the client the ping came from, or -1 if it came in a datagram.
+	 * @param udpPeer This is the sender if the ping came in a datagram.  It is NULL otherwise.
+	 */
+	void answerPing(const networkMessageStruct &receivedMessage, int64_t receiveTime, int clientIndex, udpPeerStruct *udpPeer);
+
+	/**
+	 * This method will update the latency estimates for a link from a ping.
+	 * @param link These are the latency estimates.
+	 * @param receivedMessage This is the ping, in host byte order.
+	 * @param receiveTime This is when the ping was received, from the monotonic clock in nanoseconds.
+	 */
+	static void updateLink(networkLinkStruct &link, const networkMessageStruct &receivedMessage, int64_t receiveTime);
+
+	/**
+	 * This method will check a received message and enqueue its command to the queue it is addressed to.
+	 * @param receivedMessage This is the message, in network byte order.
+	 * @param receiveTime This is when the message was received, from the monotonic clock in nanoseconds.
+	 * @param clientIndex This is the index of the client the message came from, or -1 if it came in a datagram.
+	 * @param udpPeer This is the sender if the message came in a datagram, whose window decides if the command is applied.  It is NULL
+	 * for a message from a connected client.
+	 */
+	void processMessage(networkMessageStruct &receivedMessage, int64_t receiveTime, int clientIndex, udpPeerStruct *udpPeer);
 
 public:
 	/**
@@ -61,8 +399,11 @@ public:
 	 * @param port This is the port that the network manager is to listen on for incoming connections.
 	 * @param queue This is the array of pointers to queues that is to be used for enqueueing received requests.
 	 * @param threadName This is the name given to the executing thread.  It is a simple, string that is human readable.
+	 * @param udpPort This is the UDP port on which commands are also accepted.  0 means commands are only accepted over TCP.
+	 * @param receiveBufferSize This is the size of each client's receive ring, in bytes.  It must hold at least one message.
 	 */
-	NetworkManager(unsigned short port, CommandQueue* queue[], std::string threadName);
+	NetworkManager(unsigned short port, CommandQueue* queue[], std::string threadName, unsigned short udpPort = 0,
+			uint32_t receiveBufferSize = CLIENT_RECEIVE_BUFFER_SIZE);
 
 	/**
 	 * This is the destructor for the class which will clean up from the instantiation and operation of the class.
@@ -79,10 +420,83 @@ public:
 	void stop();
 
 	/**
-	 * This method will return the socket ID for the given class.
-	 * @return The socket ID will be returned.
+	 * This method will send data to every connected client which takes the given frame format, with one system call per client.  A client
+	 * whose send buffer cannot take the data, or whose connection has failed, is shut down, and the event loop will then close it.  The
+	 * client mutex is never held across a send.
+	 * @param pieces These are the pieces of data to send, in order.
+	 * @param pieceCount This is the number of pieces.  It is at most BROADCAST_MAX_PIECES.
+	 * @param frameVersion This is the frame format the data is in.  It is one of the FRAME_VERSION values.
+	 * @param telemetry This is a telemetry record.  Each client using CRC32C frames is sent, after the data, the channels of it which are
+	 * due under its subscription.  It may be NULL.
+	 * @param sendCalls If this is not NULL, the number of send system calls made is added to it.  A send which fails or is short still
+	 * counts, so it can be more than the number of clients the data was sent to.
+	 * @return The number of clients the data was sent to.
+	 */
+	uint32_t broadcast(const struct iovec *pieces, int pieceCount, int frameVersion, const TelemetryRecord *telemetry = NULL,
+			uint32_t *sendCalls = NULL);
+
+	/**
+	 * This method will return the number of connected clients.
+	 * @return The number of connected clients.
+	 */
+	uint32_t getClientCount();
+
+	/**
+	 * This method will return the number of connected clients which take a given frame format.  It does not take the client mutex.
+	 * @param frameVersion This is the frame format.  It is one of the FRAME_VERSION values.
+	 * @return The number of connected clients which take the format.
+	 */
+	uint32_t getClientCount(int frameVersion);
+
+	/**
+	 * This method will return the number of receive system calls made on client sockets.
+	 * @return The number of receive calls.
+	 */
+	uint64_t getReceiveCallCount();
+
+	/**
+	 * This method will return the number of times the event loop has woken up.
+	 * @return The number of wakeups.
+	 */
+	uint64_t getEventLoopWakeupCount();
+
+	/**
+	 * This method will return the number of whole messages received from the clients, whether or not they were valid.
+	 * @return The number of messages.
+	 */
+	uint64_t getReceivedMessageCount();
+
+	/**
+	 * This method will return the number of UDP commands dropped as duplicates.
+	 * @return The number of duplicates.
+	 */
+	uint64_t getUdpDuplicateCount();
+
+	/**
+	 * This method will return the number of UDP commands dropped because a newer command had already been applied.
+	 * @return The number of stale commands.
+	 */
+	uint64_t getUdpStaleCount();
+
+	/**
+	 * This method will return the number of telemetry frames sent, over every client.
+	 * @return The number of telemetry frames.
+	 */
+	uint64_t getTelemetryFrameCount();
+
+	/**
+	 * This method will obtain the latency estimates for a link, from its snapshot.  It does not take the client mutex.
+	 * @param link This is the link.  Links below MAX_NETWORK_CLIENTS are TCP clients, and the rest are UDP senders.
+	 * @param estimates This is where the estimates are written.
+	 * @return true if the link is in use and has received a ping.  False otherwise.
+	 */
+	bool getLinkStatistics(int link, networkLinkStruct &estimates);
+
+	/**
+	 * This method will print the latency estimates for every link which has received a ping.
+	 * @param os This is the stream that the estimates are to be printed to.
 	 */
-	int getSocketID();
+	void printLinkStatistics(std::ostream &os);
 };
 
 
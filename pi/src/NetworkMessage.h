@@ -32,6 +32,57 @@
 
 #define COMMAND_MSG_TYPE (0x09)
 
+/**
+ * A ping measures the latency of the link.  The client puts the time it sent the ping into the timestamp, in microseconds on its own
+ * clock, and the round trip time it measured from its previous ping into the message, in microseconds, or 0 if it has none yet.  The
+ * destination is not used.
+ */
+#define PING_MSG_TYPE (0x0A)
+
+/**
+ * The robot answers a ping at once with a ping reply.  The message ID and timestamp are copied from the ping.  The destination holds the
+ * time the robot received the ping, and the message the time the robot sent the reply, each as the low 32 bits of the robot's
+ * monotonic clock in microseconds.  The client's round trip time is then its receive time, less the timestamp, less the time the robot
+ * held the ping.
+ */
+#define PING_REPLY_MSG_TYPE (0x0B)
+
+/**
+ * These macros define the frame formats.  The format of a frame is held in the top byte of its message type.  A legacy frame has 0 there,
+ * and its checksum is the XOR of its other words.  A CRC32C frame's checksum is the CRC32C of its first six words, as they are sent.
+ * The robot answers each client in the format of the last valid frame the client sent, so a client moves to CRC32C frames by sending
+ * one, and a client which has never done so is sent legacy frames.
+ */
+#define FRAME_VERSION_SHIFT (24)
+#define FRAME_VERSION_MASK (0xFF000000)
+#define FRAME_VERSION_LEGACY (0)
+#define FRAME_VERSION_CRC32C (2)
+
+/**
+ * A telemetry frame carries a telemetry record, which holds the state of the robot at one instant, and is only sent to clients which
+ * use CRC32C frames.  The frame is followed by the encoded record.  The message ID is the sequence number of the record, the timestamp is
+ * when it was sampled, in microseconds on the robot's monotonic clock, the message is the number of bytes of the record, and the
+ * destination is how the record is encoded.  The checksum is the CRC32C of the first six words followed by the record.
+ */
+#define TELEMETRY_MSG_TYPE (0x0C)
+
+/**
+ * These macros define how a telemetry record is encoded.  A fixed record is the 32 bit mask of the fields present followed by every
+ * field as a 32 bit integer, in network byte order.  A varint record is the mask followed by only the fields present, each as a
+ * zigzag varint, so that small values take a single byte.
+ */
+#define TELEMETRY_ENCODING_FIXED (0)
+#define TELEMETRY_ENCODING_VARINT (1)
+
+/**
+ * A subscribe message chooses which telemetry channels a connected client is sent, and how often.  The message is the mask of the
+ * channels, where bit n is telemetry field n, and the destination is the period to send them at, in milliseconds.  A period of 0 stops
+ * them being sent.  Channels not in the mask keep their current period, so a client can subscribe to different channels at different
+ * rates.  Until it subscribes, a client is sent every channel at TELEMETRY_DEFAULT_PERIOD_MS.  Telemetry is only sent in CRC32C frames,
+ * so the subscribe should be one.
+ */
+#define SUBSCRIBE_MSG_TYPE (0x0D)
+
 /**
  * This structure represents a network message.
  */
@@ -29,6 +29,7 @@
 #include "CommandQueue.h"
 #include "NetworkMessage.h"
 #include "NetworkCommands.h"
+#include "NetworkFrame.h"
 #include <sys/time.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -39,24 +40,35 @@
 #include <netinet/in.h>
 #include <string.h>
 #include <string>
+#include <iomanip>
+#include <time.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "time_util.h"
 
 using namespace std;
 
 NetworkTransmissionManager::NetworkTransmissionManager(
-		NetworkManager *associatedReceptionManager, std::string threadName) :
-		RunnableClass(threadName) {
+		NetworkManager *associatedReceptionManager, std::string threadName, uint32_t capacity, int overflowPolicy, int64_t flushWindow) :
+		RunnableClass(threadName), droppedCount(0), blockedCount(0), wakeupCount(0), systemCallCount(0), batchCount(0),
+		sentMessageCount(0), sentTelemetryCount(0) {
 	this->associatedReceptionManager = associatedReceptionManager;
-	/**
-	 * Initialize the semaphore to be a counting sem with nothing on it.
-	 **/
-	sem_init(&queueCountSemaphore, 0, 0);
+	this->capacity = (capacity > 0) ? capacity : 1;
+	this->overflowPolicy = overflowPolicy;
+	this->flushWindow = flushWindow;
 
+	/**
+	 * Allocate the whole queue now, so that nothing is allocated once the robot is running.
+	 */
+	legacyRing = new networkMessageStruct[this->capacity];
+	crcRing = new networkMessageStruct[this->capacity];
+	committed = new bool[this->capacity]();
 }
 
 NetworkTransmissionManager::~NetworkTransmissionManager() {
-	/**
-	 * Nothing is needed here for now, as there is nothing dynamically created that we need to clean up afterwards.
-	 */
+	delete[] legacyRing;
+	delete[] crcRing;
+	delete[] committed;
 }
 
 /**
@@ -69,55 +81,356 @@ void NetworkTransmissionManager::stop() {
 	 */
 	RunnableClass::stop();
 
-	networkMessageStruct endMsg;
+	/**
+	 * Wake the transmission thread so that it sees it is to stop.
+	 */
+	messagesAvailable.notify();
+}
+
+/**
+ * This method will reserve a slot on the queue for a message, which the caller fills in place and then passes to commitMessage.  The
+ * slot is zeroed, and is filled in host byte order.  Every slot which is reserved must be committed, since the messages behind it are
+ * not sent until it is.  If the queue is full, the overflow policy decides whether this method blocks or a message is lost.
+ * @return The slot to fill in, or NULL if the message is to be dropped.
+ */
+networkMessageStruct* NetworkTransmissionManager::reserveMessage() {
+	networkMessageStruct *slot = NULL;
+
+	// Lock the queue.
+	std::unique_lock<std::mutex> guard(queueMutex);
+
+	// Once the queue has overflowed, messages replace the overflow slot until it has been sent, so that they stay in order.  If another
+	// producer is still filling it in, that message is kept and this one is lost.
+	if ((overflowState == OVERFLOW_SLOT_FILLING) || (overflowState == OVERFLOW_SLOT_READY)) {
+		droppedCount.fetch_add(1, std::memory_order_relaxed);
+		if (overflowState == OVERFLOW_SLOT_FILLING) {
+			return NULL;
+		}
+		overflowState = OVERFLOW_SLOT_FILLING;
+		slot = &overflowCrc;
+	}
+
+	// Apply the overflow policy for as long as the queue is full.
+	while ((slot == NULL) && (count == capacity)) {
+		highWaterMark = capacity;
+
+		if (overflowPolicy == OVERFLOW_DROP_NEWEST) {
+			droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return NULL;
+		} else if (overflowPolicy == OVERFLOW_DROP_OLDEST) {
+			// The oldest message is only replaced if it is committed and not being sent, since its slot is then free to reuse.  Otherwise
+			// this message is the one lost.
+			droppedCount.fetch_add(1, std::memory_order_relaxed);
+			if ((inFlight > 0) || (!committed[head])) {
+				return NULL;
+			}
+			committed[head] = false;
+			head = (head + 1) % capacity;
+			count--;
+		} else if (overflowPolicy == OVERFLOW_COALESCE) {
+			if (overflowState == OVERFLOW_SLOT_SENDING) {
+				droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return NULL;
+			}
+			overflowState = OVERFLOW_SLOT_FILLING;
+			slot = &overflowCrc;
+		} else {
+			// Register as a waiter before releasing the lock, so that a dequeue after that always wakes this thread.
+			uint32_t waitKey = spaceAvailable.prepareWait();
+			guard.unlock();
+			blockedCount.fetch_add(1, std::memory_order_relaxed);
+			spaceAvailable.wait(waitKey, -1);
+			guard.lock();
+		}
+	}
+
+	// Take the slot at the end of the queue.
+	if (slot == NULL) {
+		slot = &crcRing[(head + count) % capacity];
+		count++;
+		if (count > highWaterMark) {
+			highWaterMark = count;
+		}
+	}
+	guard.unlock();
+
+	// The slot belongs to the caller now, so it is cleared without holding the lock.
+	memset(slot, 0, sizeof(networkMessageStruct));
+	return slot;
+}
+
+/**
+ * This method will commit a slot returned by reserveMessage.  The message is framed in place in both frame formats, in network byte
+ * order, and the transmission thread sends it straight from the queue.  The caller must not touch the slot afterwards.
+ * @param slot This is the slot which was reserved.
+ */
+void NetworkTransmissionManager::commitMessage(networkMessageStruct *slot) {
+	bool overflow = (slot == &overflowCrc);
+	uint32_t index = overflow ? 0 : (uint32_t) (slot - crcRing);
+	networkMessageStruct &legacy = overflow ? overflowLegacy : legacyRing[index];
 
-	enqueueMessage(endMsg);
+	// Frame the message while the slot still belongs to the caller, so that the transmission thread has nothing to do but send it.
+	legacy = *slot;
+	encodeFrame(legacy, FRAME_VERSION_LEGACY);
+	encodeFrame(*slot, FRAME_VERSION_CRC32C);
 
+	{
+		std::lock_guard<std::mutex> guard(queueMutex);
+		if (overflow) {
+			overflowState = OVERFLOW_SLOT_READY;
+		} else {
+			committed[index] = true;
+		}
+	}
+	// Wake the transmission thread if it is waiting.  This costs no system call while it is busy sending.
+	messagesAvailable.notify();
 }
 
+/**
+ * This method will enqueue a message to be sent, by copying it into a slot reserved on the queue.  If the queue is full, the overflow
+ * policy decides whether this method blocks or a message is lost.
+ * @param itemToEnqueue This is the message.
+ */
 void NetworkTransmissionManager::enqueueMessage(networkMessageStruct &itemToEnqueue) {
-	// Lock the queue.
+	networkMessageStruct *slot = reserveMessage();
+	if (slot != NULL) {
+		*slot = itemToEnqueue;
+		commitMessage(slot);
+	}
+}
+
+/**
+ * This method will publish a telemetry record, which is sent with the next batch to every client which uses CRC32C frames, limited to
+ * the channels each has subscribed to and is due.  It never blocks.  A record which has not yet been sent is replaced.
+ * @param record This is the record.
+ */
+void NetworkTransmissionManager::publishTelemetry(const TelemetryRecord &record) {
+	{
+		std::lock_guard<std::mutex> guard(queueMutex);
+		pendingTelemetry = record;
+		telemetryPending = true;
+	}
+	messagesAvailable.notify();
+}
+
+/**
+ * This method will return the number of messages waiting to be sent.
+ * @return The number of messages waiting.
+ */
+uint32_t NetworkTransmissionManager::getQueueDepth() {
 	std::lock_guard<std::mutex> guard(queueMutex);
-	// Place the given item on the end of the queue.
-	transmissionQueue.push(itemToEnqueue);
-	// Indicate that something has been enqueued through the semaphore.
-	sem_post(&queueCountSemaphore);
+	return count + ((overflowState != OVERFLOW_SLOT_EMPTY) ? 1 : 0);
 }
 
 /**
- * This is the virtual run method.  It will execute the given code that is to be executed by this class.
+ * This method will print the capacity, high water mark, dropped and blocked counts, and the occupancy percentiles for the transmission
+ * queue, in the same format as CommandQueue::printBackpressureStatistics.
+ * @param os This is the stream that the statistics are to be printed to.
+ */
+void NetworkTransmissionManager::printBackpressureStatistics(std::ostream &os) {
+	uint32_t currentHighWaterMark;
+	{
+		std::lock_guard<std::mutex> guard(queueMutex);
+		currentHighWaterMark = highWaterMark;
+	}
+
+	os << std::setw(18) << myName << "\t" << std::setw(8) << "All" << "\t" << std::setw(8) << capacity << "\t" << std::setw(8)
+			<< currentHighWaterMark << "\t" << std::setw(8) << droppedCount.load(std::memory_order_relaxed) << "\t" << std::setw(8)
+			<< blockedCount.load(std::memory_order_relaxed) << "\t";
+	occupancyHistogram.printPercentiles(os);
+	os << "\n";
+}
+
+/**
+ * This method will print the number of batches and messages sent, and the wakeups, system calls and messages per batch.  A batch is
+ * normally one telemetry cycle.
+ * @param os This is the stream that the statistics are to be printed to.
+ */
+void NetworkTransmissionManager::printTransmissionStatistics(std::ostream &os) {
+	uint64_t batches = batchCount.load(std::memory_order_relaxed);
+	double divisor = (batches > 0) ? (double) batches : 1.0;
+
+	os << myName << ": " << batches << " batches, " << sentMessageCount.load(std::memory_order_relaxed) << " messages, "
+			<< sentTelemetryCount.load(std::memory_order_relaxed) << " telemetry records.  Per batch: "
+			<< std::fixed << std::setprecision(2) << (sentMessageCount.load(std::memory_order_relaxed) / divisor) << " messages, "
+			<< (wakeupCount.load(std::memory_order_relaxed) / divisor) << " wakeups, "
+			<< (systemCallCount.load(std::memory_order_relaxed) / divisor) << " system calls.\n";
+}
+
+/**
+ * This method will return the number of times the transmission thread has woken up from waiting for messages.
+ * @return The number of wakeups.
+ */
+uint64_t NetworkTransmissionManager::getWakeupCount() {
+	return wakeupCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the number of system calls the transmission thread has made, counting its waits, its flush window sleeps
+ * and its sends.
+ * @return The number of system calls.
+ */
+uint64_t NetworkTransmissionManager::getSystemCallCount() {
+	return systemCallCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will return the number of batches which have been sent.
+ * @return The number of batches.
+ */
+uint64_t NetworkTransmissionManager::getBatchCount() {
+	return batchCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * This is the virtual run method.  It will execute the given code that is to be executed by this class.  Each pass waits for a message,
+ * holds the batch open for the flush window, takes every committed message which is queued, and sends it to each client with one system
+ * call, straight from the queue.  The slots are only released once they have been sent.
  */
 void NetworkTransmissionManager::run() {
+	TelemetryRecord telemetry;
+
 	while (keepGoing) {
-		networkMessageStruct itemToTransmit;
+		uint32_t batchSize = 0;
+		uint32_t batchHead;
+		bool overflowTaken = false;
+		bool telemetryTaken = false;
+		bool roomForProducers;
+		bool queueEmpty;
 
 		/**
-		 * Block if there is nothing on the queue until something is enqueued.
+		 * 1.0 Block if there is nothing to send until something is committed.  Registering as a waiter before looking means a commit made
+		 * after the look always wakes this thread.  A slot which is reserved but not committed holds back the messages behind it.
 		 */
-		sem_wait(&queueCountSemaphore);
+		uint32_t waitKey = messagesAvailable.prepareWait();
+		{
+			std::lock_guard<std::mutex> guard(queueMutex);
+			queueEmpty = (!((count > 0) && (committed[head])) && !((count == 0) && (overflowState == OVERFLOW_SLOT_READY))
+					&& (!telemetryPending));
+		}
+		if (queueEmpty) {
+			messagesAvailable.wait(waitKey, -1);
+			wakeupCount.fetch_add(1, std::memory_order_relaxed);
+			systemCallCount.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		/**
+		 * 2.0 Hold the batch open for the flush window, so that the rest of the messages a task is enqueueing join it.
+		 */
+		if (flushWindow > 0) {
+			struct timespec deadline = nsToTimespec(getMonotonicTimeNs() + flushWindow);
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+			}
+			systemCallCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
 		{
 			/**
-			 * Lock the queue and dequeue an item from it.
+			 * 3.0 Lock the queue and mark every committed message at its head as in flight, up to a batch.  Nothing is copied.  The
+			 * producers keep using the rest of the ring while the batch is sent.
 			 */
 			std::lock_guard<std::mutex> guard(queueMutex);
+			occupancyHistogram.record(count);
+
+			batchHead = head;
+			while ((batchSize < count) && (batchSize < TRANSMISSION_BATCH_SIZE) && (committed[(head + batchSize) % capacity])) {
+				batchSize++;
+			}
+			inFlight = batchSize;
+
+			/**
+			 * 3.1 The overflow slot holds the newest message, so it is only sent along with the last of the queue.
+			 */
+			if ((batchSize == count) && (overflowState == OVERFLOW_SLOT_READY)) {
+				overflowState = OVERFLOW_SLOT_SENDING;
+				overflowTaken = true;
+			}
 
 			/**
-			 * Obtain the first item from the queue and then dispose of it.
+			 * 3.2 The telemetry record is copied out, so that a new one can be published while this one is sent.
 			 */
-			itemToTransmit = transmissionQueue.front();
-			transmissionQueue.pop();
+			if (telemetryPending) {
+				telemetry = pendingTelemetry;
+				telemetryPending = false;
+				telemetryTaken = true;
+			}
 		}
 
-		// Now that we have an item to transmit,
-		itemToTransmit.message = htonl(itemToTransmit.message);
-		itemToTransmit.messageDestination = htonl(itemToTransmit.messageDestination);
-		itemToTransmit.xorChecksum = htonl(itemToTransmit.xorChecksum);
+		/**
+		 * 4.0 Send the batch in each frame format to the clients which take it.  The batch is one piece of the ring, or two if it wraps
+		 * around the end, followed by the overflow slot.  If there are no clients, it is simply discarded.
+		 */
+		uint32_t firstPart = ((batchHead + batchSize) <= capacity) ? batchSize : (capacity - batchHead);
+		uint32_t sendCalls = 0;
+		struct iovec pieces[3];
+		int pieceCount = 0;
+		if (firstPart > 0) {
+			pieces[pieceCount].iov_base = &legacyRing[batchHead];
+			pieces[pieceCount++].iov_len = firstPart * sizeof(networkMessageStruct);
+		}
+		if (batchSize > firstPart) {
+			pieces[pieceCount].iov_base = &legacyRing[0];
+			pieces[pieceCount++].iov_len = (batchSize - firstPart) * sizeof(networkMessageStruct);
+		}
+		if (overflowTaken) {
+			pieces[pieceCount].iov_base = &overflowLegacy;
+			pieces[pieceCount++].iov_len = sizeof(networkMessageStruct);
+		}
+		if (pieceCount > 0) {
+			associatedReceptionManager->broadcast(pieces, pieceCount, FRAME_VERSION_LEGACY, NULL, &sendCalls);
+		}
 
-		if (associatedReceptionManager->getSocketID() > 0) {
-			// Now send it.
-			send(associatedReceptionManager->getSocketID(), &itemToTransmit, sizeof(networkMessageStruct), 0);
-		} else {
-			// DO nothing, as we are not connected through a socket right now.
+		/**
+		 * 4.1 The CRC32C frames use the same pieces of the other ring.  The telemetry record follows the batch, in the same system call,
+		 * and each client is sent only the channels it is due.
+		 */
+		if ((pieceCount > 0) || (telemetryTaken)) {
+			pieceCount = 0;
+			if (firstPart > 0) {
+				pieces[pieceCount].iov_base = &crcRing[batchHead];
+				pieces[pieceCount++].iov_len = firstPart * sizeof(networkMessageStruct);
+			}
+			if (batchSize > firstPart) {
+				pieces[pieceCount].iov_base = &crcRing[0];
+				pieces[pieceCount++].iov_len = (batchSize - firstPart) * sizeof(networkMessageStruct);
+			}
+			if (overflowTaken) {
+				pieces[pieceCount].iov_base = &overflowCrc;
+				pieces[pieceCount++].iov_len = sizeof(networkMessageStruct);
+			}
+			associatedReceptionManager->broadcast(pieces, pieceCount, FRAME_VERSION_CRC32C, telemetryTaken ? &telemetry : NULL, &sendCalls);
 		}
+		if (telemetryTaken) {
+			sentTelemetryCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		{
+			/**
+			 * 5.0 Release the slots which were sent, so that producers can reuse them.
+			 */
+			std::lock_guard<std::mutex> guard(queueMutex);
+			for (uint32_t index = 0; index < batchSize; index++) {
+				committed[(head + index) % capacity] = false;
+			}
+			head = (head + batchSize) % capacity;
+			count -= batchSize;
+			inFlight = 0;
+			if (overflowTaken) {
+				overflowState = OVERFLOW_SLOT_EMPTY;
+			}
+			roomForProducers = (count <= (capacity / 2));
+		}
+
+		/**
+		 * 6.0 Wake any producers blocked on a full queue once it has drained to half full, rather than for every message sent.
+		 */
+		if (roomForProducers) {
+			spaceAvailable.notify();
+		}
+
+		systemCallCount.fetch_add(sendCalls, std::memory_order_relaxed);
+		batchCount.fetch_add(1, std::memory_order_relaxed);
+		sentMessageCount.fetch_add(batchSize + (overflowTaken ? 1 : 0), std::memory_order_relaxed);
 	}
 }
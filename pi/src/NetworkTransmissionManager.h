@@ -29,29 +29,260 @@
 #include "RunnableClass.h"
 #include "NetworkCfg.h"
 #include "NetworkMessage.h"
+#include "QueueCfg.h"
+#include "FutexEvent.h"
+#include "LatencyHistogram.h"
+#include "TelemetryRecord.h"
 #include <string>
+#include <ostream>
+#include <atomic>
 #include "NetworkManager.h"
 
 
 class NetworkTransmissionManager: public RunnableClass {
 private:
+	/**
+	 * This is the network manager whose clients the messages are sent to.
+	 */
 	NetworkManager *associatedReceptionManager;
-	std::queue<networkMessageStruct> transmissionQueue;
 	/**
-	 * This is a counting semaphore which keeps track of how many items are on the queue.
+	 * This enumeration defines the states of the overflow slot used by the coalescing overflow policy.
+	 */
+	enum OverflowSlotState {
+		/**
+		 * The slot holds no message.
+		 */
+		OVERFLOW_SLOT_EMPTY,
+		/**
+		 * The slot has been reserved by a producer, which is filling it in.
+		 */
+		OVERFLOW_SLOT_FILLING,
+		/**
+		 * The slot holds a committed message which is waiting to be sent.
+		 */
+		OVERFLOW_SLOT_READY,
+		/**
+		 * The transmission thread is sending the message in the slot.
+		 */
+		OVERFLOW_SLOT_SENDING
+	};
+
+	/**
+	 * This is the transmission queue of messages framed for legacy clients.  It is a ring which is allocated in full by the constructor.
+	 * Each message is framed in place by the producer which committed it, and is sent straight from the ring.
+	 */
+	networkMessageStruct *legacyRing;
+
+	/**
+	 * This is the transmission queue of messages framed for clients which use CRC32C frames.  Its slots match those of the legacy ring,
+	 * and it is the slot in this ring which a producer is given to fill in.
+	 */
+	networkMessageStruct *crcRing;
+
+	/**
+	 * This indicates, for each slot of the rings, that the producer which reserved it has committed it.  It is guarded by the queue mutex.
+	 */
+	bool *committed;
+
+	/**
+	 * This is the number of slots in each ring.
 	 */
-	sem_t queueCountSemaphore;
+	uint32_t capacity;
+
+	/**
+	 * This is the index of the oldest slot in use.
+	 */
+	uint32_t head = 0;
+
+	/**
+	 * This is the number of slots in use, counting those which are reserved, committed, or being sent.
+	 */
+	uint32_t count = 0;
+
+	/**
+	 * This is the number of slots, starting at the head, which the transmission thread is sending.  Producers must not touch them until
+	 * they have been released.
+	 */
+	uint32_t inFlight = 0;
+
+	/**
+	 * This is what happens to a message which is enqueued while the queue is full.  It is one of the overflow policies in QueueCfg.h.
+	 */
+	int overflowPolicy;
+
+	/**
+	 * These are the overflow slots used by the coalescing overflow policy, in each frame format.  Once the queue is full, the newest message
+	 * waits here, and each later message replaces it until the queue has emptied and it has been sent.
+	 */
+	networkMessageStruct overflowLegacy;
+	networkMessageStruct overflowCrc;
+
+	/**
+	 * This is the state of the overflow slot.  It is guarded by the queue mutex.
+	 */
+	OverflowSlotState overflowState = OVERFLOW_SLOT_EMPTY;
+
+	/**
+	 * This is the latest telemetry record, which is sent with the next batch.  A record which has not been sent by the time the next is
+	 * published is replaced, since only the latest state matters.  It is guarded by the queue mutex.
+	 */
+	TelemetryRecord pendingTelemetry;
+
+	/**
+	 * This indicates that the telemetry record has not been sent.
+	 */
+	bool telemetryPending = false;
+
+	/**
+	 * This is how long a batch is held open after its first message arrives, in nanoseconds.
+	 */
+	int64_t flushWindow;
+
+	/**
+	 * This event is notified when a message is enqueued, and when the thread is stopped.  The transmission thread waits on it while the
+	 * queue is empty.
+	 */
+	FutexEvent messagesAvailable;
 	/**
 	 * This is a mutex for the class which is used to lock critical sections in different methods.
 	 */
 	std::mutex queueMutex;
 
+	/**
+	 * This event is notified when the queue has drained to half full.  Producers wait on it while the queue is full.
+	 */
+	FutexEvent spaceAvailable;
+
+	/**
+	 * This is the number of messages which were lost because the queue was full.
+	 */
+	std::atomic<uint32_t> droppedCount;
+
+	/**
+	 * This is the number of times a producer had to wait for room on the queue.
+	 */
+	std::atomic<uint32_t> blockedCount;
+
+	/**
+	 * This is the largest number of messages seen on the queue at once.  It is guarded by the queue mutex.
+	 */
+	uint32_t highWaterMark = 0;
+
+	/**
+	 * This histogram holds the number of messages on the queue, sampled each time one is dequeued.  It is only written by the transmission
+	 * thread.
+	 */
+	LatencyHistogram occupancyHistogram;
+
+	/**
+	 * This is the number of times the transmission thread has woken up from waiting for messages.
+	 */
+	std::atomic<uint64_t> wakeupCount;
+
+	/**
+	 * This is the number of system calls the transmission thread has made, counting its waits, its flush window sleeps and its sends.
+	 */
+	std::atomic<uint64_t> systemCallCount;
+
+	/**
+	 * This is the number of batches which have been sent.
+	 */
+	std::atomic<uint64_t> batchCount;
+
+	/**
+	 * This is the number of messages which have been sent.
+	 */
+	std::atomic<uint64_t> sentMessageCount;
+
+	/**
+	 * This is the number of telemetry records which have been sent.
+	 */
+	std::atomic<uint64_t> sentTelemetryCount;
+
 
 public:
-	NetworkTransmissionManager(NetworkManager* associatedReceptionManager, std::string threadName);
+	/**
+	 * This is the constructor for the class.
+	 * @param associatedReceptionManager This is the network manager whose connected clients the messages are sent to.
+	 * @param threadName This is the name of the thread.
+	 * @param capacity This is the number of messages the transmission queue can hold.
+	 * @param overflowPolicy This is what happens to a message which is enqueued while the queue is full.  It is one of the overflow
+	 * policies in QueueCfg.h.
+	 * @param flushWindow This is how long a batch is held open after its first message arrives, in nanoseconds.  0 sends at once.
+	 */
+	NetworkTransmissionManager(NetworkManager* associatedReceptionManager, std::string threadName,
+			uint32_t capacity = TRANSMISSION_QUEUE_CAPACITY, int overflowPolicy = TRANSMISSION_QUEUE_OVERFLOW_POLICY,
+			int64_t flushWindow = TRANSMISSION_FLUSH_WINDOW_NS);
 	virtual ~NetworkTransmissionManager();
+
+	/**
+	 * This method will reserve a slot on the queue for a message, which the caller fills in place and then passes to commitMessage.  The
+	 * slot is zeroed, and is filled in host byte order.  Every slot which is reserved must be committed, since the messages behind it are
+	 * not sent until it is.  If the queue is full, the overflow policy decides whether this method blocks or a message is lost.
+	 * @return The slot to fill in, or NULL if the message is to be dropped.
+	 */
+	networkMessageStruct* reserveMessage();
+
+	/**
+	 * This method will commit a slot returned by reserveMessage.  The message is framed in place in both frame formats, in network byte
+	 * order, and the transmission thread sends it straight from the queue.  The caller must not touch the slot afterwards.
+	 * @param slot This is the slot which was reserved.
+	 */
+	void commitMessage(networkMessageStruct *slot);
+
+	/**
+	 * This method will enqueue a message to be sent, by copying it into a slot reserved on the queue.  If the queue is full, the overflow
+	 * policy decides whether this method blocks or a message is lost.
+	 * @param itemToEnqueue This is the message.
+	 */
 	void enqueueMessage(networkMessageStruct &itemToEnqueue);
 
+	/**
+	 * This method will publish a telemetry record, which is sent with the next batch to every client which uses CRC32C frames, limited to
+	 * the channels each has subscribed to and is due.  It never blocks.  A record which has not yet been sent is replaced.
+	 * @param record This is the record.
+	 */
+	void publishTelemetry(const TelemetryRecord &record);
+
+	/**
+	 * This method will return the number of messages waiting to be sent.
+	 * @return The number of messages waiting.
+	 */
+	uint32_t getQueueDepth();
+
+	/**
+	 * This method will print the capacity, high water mark, dropped and blocked counts, and the occupancy percentiles for the transmission
+	 * queue, in the same format as CommandQueue::printBackpressureStatistics.
+	 * @param os This is the stream that the statistics are to be printed to.
+	 */
+	void printBackpressureStatistics(std::ostream &os);
+
+	/**
+	 * This method will print the number of batches and messages sent, and the wakeups, system calls and messages per batch.  A batch is
+	 * normally one telemetry cycle.
+	 * @param os This is the stream that the statistics are to be printed to.
+	 */
+	void printTransmissionStatistics(std::ostream &os);
+
+	/**
+	 * This method will return the number of times the transmission thread has woken up from waiting for messages.
+	 * @return The number of wakeups.
+	 */
+	uint64_t getWakeupCount();
+
+	/**
+	 * This method will return the number of system calls the transmission thread has made, counting its waits, its flush window sleeps
+	 * and its sends.
+	 * @return The number of system calls.
+	 */
+	uint64_t getSystemCallCount();
+
+	/**
+	 * This method will return the number of batches which have been sent.
+	 * @return The number of batches.
+	 */
+	uint64_t getBatchCount();
+
 	/**
 	 * This method will override the default stop method.  In doing so, it must call the base class's stop method prior to invoking it's own logic.
 	 */
@@ -26,9 +26,18 @@
  */
 
 #include "PeriodicTask.h"
+#include "CyclicExecutive.h"
+#include "Clock.h"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <time.h>
+#include <thread>
+
+/**
+ * This is the cyclic executive that periodic tasks are multiplexed onto.  It is NULL unless multiplexed execution is selected at startup.
+ */
+CyclicExecutive *PeriodicTask::defaultExecutive = NULL;
 
 /**
  * This is the default constructor for the class.
@@ -37,7 +46,7 @@
  * Must be at least 100 microseconds.
  */
 PeriodicTask::PeriodicTask(std::string threadName, uint32_t period) :
-		RunnableClass(threadName) {
+		RunnableClass(threadName), statistics(), resetRequested(false) {
 	this->setTaskPeriod(period);
 	this->setPriority(1);
 }
@@ -73,6 +82,103 @@ uint32_t PeriodicTask::getTaskPeriod() {
 	return taskPeriod;
 }
 
+/**
+ * This method will set the mode that is used to schedule the releases of this task.
+ * @param mode This is the scheduling mode that is to be used.
+ */
+void PeriodicTask::setSchedulingMode(SchedulingMode mode) {
+	schedulingMode = mode;
+}
+
+/**
+ * This method will return the mode that is used to schedule the releases of this task.
+ * @return The scheduling mode will be returned.
+ */
+PeriodicTask::SchedulingMode PeriodicTask::getSchedulingMode() {
+	return schedulingMode;
+}
+
+/**
+ * This method will set the policy that is used when the task runs past its next release time.
+ * @param policy This is the overrun policy that is to be used.
+ */
+void PeriodicTask::setOverrunPolicy(OverrunPolicy policy) {
+	overrunPolicy = policy;
+}
+
+/**
+ * This method will return the policy that is used when the task runs past its next release time.
+ * @return The overrun policy will be returned.
+ */
+PeriodicTask::OverrunPolicy PeriodicTask::getOverrunPolicy() {
+	return overrunPolicy;
+}
+
+/**
+ * This method will select the cyclic executive that periodic tasks are multiplexed onto when they are started.  It must be called at startup,
+ * before any periodic task is started.
+ * @param executive This is the executive that is to be used.  If it is NULL, each periodic task will run on its own thread.
+ */
+void PeriodicTask::setDefaultExecutive(CyclicExecutive *executive) {
+	defaultExecutive = executive;
+}
+
+/**
+ * This method will determine whether this task may be multiplexed onto the cyclic executive.  It must be called before the task is started.
+ * @param allowed If true, the task will run on the default executive if one has been selected.  If false, the task always gets its own thread.
+ */
+void PeriodicTask::setMultiplexingAllowed(bool allowed) {
+	multiplexingAllowed = allowed;
+}
+
+/**
+ * This method will return the cyclic executive that this task has been multiplexed onto.
+ * @return The executive will be returned, or NULL if the task runs on its own thread.
+ */
+CyclicExecutive *PeriodicTask::getExecutive() {
+	return executive;
+}
+
+/**
+ * This method will hand the task to the default cyclic executive instead of starting a new thread, if multiplexed execution has been selected.
+ * @return true if the task has been registered with a cyclic executive.  False if a thread is to be started for it.
+ */
+bool PeriodicTask::startOnExternalExecutor() {
+	if ((defaultExecutive == NULL) || (multiplexingAllowed == false)) {
+		return false;
+	}
+
+	executive = defaultExecutive;
+	runStarted = true;
+	runCompleted = false;
+	executive->registerTask(this);
+	return true;
+}
+
+/**
+ * This method will determine whether the thread of this task takes part in the clock.  A periodic task only waits on the clock, so it does.
+ * @return true will be returned.
+ */
+bool PeriodicTask::isClockParticipant() {
+	return true;
+}
+
+/**
+ * This method will block waiting for the task to terminate.  If the task has been multiplexed, this waits for the executive to release it.
+ */
+void PeriodicTask::waitForShutdown() {
+	if (executive != NULL) {
+		/**
+		 * There is no thread to join.  Wait for the executive to indicate that it will no longer run this task.
+		 */
+		while (runCompleted == false) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	} else {
+		RunnableClass::waitForShutdown();
+	}
+}
+
 /**
  * This method will suspend execution until the next period has been reached.  It will do this by blocking.
  */
@@ -81,14 +187,23 @@ void PeriodicTask::waitForNextExecution(
 	/**
 	 * Sleep for the given amount of time.
 	 */
-	std::this_thread::sleep_for(remainingSleepTime);
+	Clock::getClock()->sleepFor(((int64_t) remainingSleepTime.count()) * 1000);
+}
+
+/**
+ * This method will suspend execution until the given absolute time on the clock has been reached.  It will do this by blocking.
+ * @param releaseTimeNs This is the absolute release time, in nanoseconds, on the clock.
+ */
+void PeriodicTask::waitForNextExecution(int64_t releaseTimeNs) {
+	Clock::getClock()->sleepUntil(releaseTimeNs);
 }
 
 /**
  * This method will return the CPU usage for the given task.  The usage will be as a percentage value.
  */
 double PeriodicTask::getCPUUsageInfo() {
-	double cpuUsage = ((double) worstCaseExecutionTime / (double) taskPeriod)
+	TaskStatistics current = publishedStatistics.load();
+	double cpuUsage = ((double) current.worstCaseExecutionTime / (double) taskPeriod)
 			* 100.0;
 	return cpuUsage;
 }
@@ -97,28 +212,186 @@ double PeriodicTask::getCPUUsageInfo() {
  * This method will print out information about the given thread.  The info will be dependent upon the given thread.
  */
 void PeriodicTask::printInformation() {
+	/**
+	 * Take one snapshot so that every column printed comes from the same point in time.
+	 */
+	TaskStatistics current = publishedStatistics.load();
+	double cpuUsage = ((double) current.worstCaseExecutionTime / (double) taskPeriod) * 100.0;
+
 	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t "
 			<< std::setw(5) << getPriority() << "\t " << std::setw(10)
-			<< taskPeriod << "\t " << std::setw(18) << lastExecutionTime
-			<< "\t " << std::setw(8) << worstCaseExecutionTime << "\t "
-			<< std::setw(18) << lastWallTime.count() << "\t " << std::setw(8)
-			<< worstCaseWallTime.count() << "\t" << std::fixed
-			<< std::setprecision(3) << getCPUUsageInfo() << "%";
-	if (worstCaseWallTime.count() > taskPeriod) {
+			<< taskPeriod << "\t " << std::setw(18) << current.lastExecutionTime
+			<< "\t " << std::setw(8) << current.worstCaseExecutionTime << "\t "
+			<< std::setw(18) << current.lastWallTime << "\t " << std::setw(8)
+			<< current.worstCaseWallTime << "\t" << std::fixed
+			<< std::setprecision(3) << cpuUsage << "%";
+	if (current.worstCaseWallTime > taskPeriod) {
 		std::cout << "**";
 	}
+	std::cout << "\t " << std::setw(10) << current.lastReleaseJitter << "\t "
+			<< std::setw(13) << current.worstCaseReleaseJitter << "\t "
+			<< std::setw(9) << current.cumulativeDrift << "\t " << std::setw(8)
+			<< current.overrunCount << "\t " << std::setw(7) << current.skippedReleaseCount
+			<< "\t" << (schedulingMode == ABSOLUTE_DEADLINE ? "ABS" : "REL");
+	std::cout << "\n";
+}
+
+/**
+ * This method will print out the release latency, CPU time and wall time percentiles for the task.
+ */
+void PeriodicTask::printHistogramInformation() {
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t" << std::setw(16) << "Release latency" << "\t";
+	releaseLatencyHistogram.printPercentiles(std::cout);
+	std::cout << "\n" << myOSThreadID << "\t" << std::setw(18) << myName << "\t" << std::setw(16) << "CPU time" << "\t";
+	cpuTimeHistogram.printPercentiles(std::cout);
+	std::cout << "\n" << myOSThreadID << "\t" << std::setw(18) << myName << "\t" << std::setw(16) << "Wall time" << "\t";
+	wallTimeHistogram.printPercentiles(std::cout);
 	std::cout << "\n";
 }
 
 /**
- * This method will reset thread diagnostics back to their default values.
+ * This method will write the release latency, CPU time and wall time histograms for the task in CSV format.
+ * @param os This is the stream that the CSV data is to be written to.
+ */
+void PeriodicTask::writeHistogramCSV(std::ostream &os) {
+	releaseLatencyHistogram.writeCSV(os, myName, "release_latency");
+	cpuTimeHistogram.writeCSV(os, myName, "cpu_time");
+	wallTimeHistogram.writeCSV(os, myName, "wall_time");
+}
+
+/**
+ * This method will return a consistent copy of the latest statistics for the task.  It may be called from any thread, and it never blocks
+ * or delays the thread which executes the task.
+ * @return The statistics will be returned.
+ */
+PeriodicTask::TaskStatistics PeriodicTask::getStatistics() {
+	return publishedStatistics.load();
+}
+
+/**
+ * This method will return the number of times any periodic task has run past its next release time.  It must not be called while
+ * tasks are still being created.
+ * @return The total overrun count of every periodic task.
+ */
+uint32_t PeriodicTask::getTotalOverrunCount() {
+	uint32_t overruns = 0;
+	for (std::list<RunnableClass*>::iterator it = runningThreads.begin(); it != runningThreads.end(); it++) {
+		PeriodicTask *pt = dynamic_cast<PeriodicTask*>(*it);
+		if (pt != NULL) {
+			overruns += pt->getStatistics().overrunCount;
+		}
+	}
+	return overruns;
+}
+
+/**
+ * This method will reset thread diagnostics back to their default values.  The reset takes effect at the start of the next release of the task.
  */
 void PeriodicTask::resetThreadDiagnostics() {
-	// Reset all diagnostic variables to zero.
-	worstCaseExecutionTime = 0;
-	lastExecutionTime = 0;
-	lastWallTime = std::chrono::microseconds(0);
-	worstCaseWallTime = std::chrono::microseconds(0);
+	/**
+	 * Only the thread which executes the releases writes the statistics and histograms, so ask it to do the reset.
+	 */
+	resetRequested.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * This method will execute a single release of the task.  It invokes the task method and updates the release jitter, drift, CPU time
+ * and wall time statistics for the task.
+ * @param scheduledReleaseNs This is the monotonic time, in nanoseconds, at which this release was scheduled to occur.
+ * @return The monotonic time, in nanoseconds, at which the release completed will be returned.
+ */
+int64_t PeriodicTask::executeRelease(int64_t scheduledReleaseNs) {
+	// Get the start time for the given iteration of the task.
+	clockid_t threadTimer;
+	struct timespec startTs;
+	struct timespec endTs;
+	int64_t periodNs = ((int64_t) taskPeriod) * 1000;
+
+	/**
+	 * The following gets the wall time, for determining next execution time.
+	 */
+	int64_t start = Clock::getClock()->now();
+	lastReleaseStart = start;
+
+	/**
+	 * If a reset of the diagnostics has been requested, carry it out before this release is measured.
+	 */
+	if (resetRequested.exchange(false, std::memory_order_relaxed)) {
+		statistics = TaskStatistics();
+		releaseLatencyHistogram.reset();
+		cpuTimeHistogram.reset();
+		wallTimeHistogram.reset();
+
+		// Re-establish the drift reference at this release.
+		driftReferenceValid = false;
+	}
+
+	/**
+	 * Determine the release jitter, which is how late the task woke up relative to when it was scheduled to be released.
+	 */
+	statistics.lastReleaseJitter = (start - scheduledReleaseNs) / 1000;
+	if (statistics.lastReleaseJitter > statistics.worstCaseReleaseJitter) {
+		statistics.worstCaseReleaseJitter = statistics.lastReleaseJitter;
+	}
+	releaseLatencyHistogram.record(statistics.lastReleaseJitter);
+
+	/**
+	 * Determine the cumulative drift relative to the drift reference.  If the reference has been invalidated, this release becomes the new reference.
+	 */
+	if (driftReferenceValid == false) {
+		driftReference = start;
+		releaseIndex = 0;
+		driftReferenceValid = true;
+	}
+	statistics.cumulativeDrift = (start - (driftReference + releaseIndex * periodNs)) / 1000;
+	releaseIndex++;
+
+	/**
+	 * Obtain the cpu time at the start of this periodic task. This is for CPU time measurement.
+	 **/
+	pthread_getcpuclockid(pthread_self(), &threadTimer);
+	clock_gettime(threadTimer, &startTs);
+
+	/**Now run the task.
+	 * Call the task method.
+	 */
+	this->taskMethod();
+
+	/**
+	 *Now get the end CPU time entry.
+	 **/
+	clock_gettime(threadTimer, &endTs);
+	long deltaInus = (endTs.tv_sec * 1000000 + endTs.tv_nsec / 1000)
+			- (startTs.tv_sec * 1000000 + startTs.tv_nsec / 1000);
+
+	/**
+	 * Determine where we are in terms of the worst case execution time.
+	 */
+	if (deltaInus > statistics.worstCaseExecutionTime) {
+		statistics.worstCaseExecutionTime = deltaInus;
+	}
+	statistics.lastExecutionTime = deltaInus;
+	cpuTimeHistogram.record(deltaInus);
+
+	/**
+	 * Now figure out exactly what time it is to schedule the next execution.
+	 */
+	int64_t end = Clock::getClock()->now();
+
+	// Now figure out the difference.
+	statistics.lastWallTime = (end - start) / 1000;
+	if (statistics.lastWallTime > statistics.worstCaseWallTime) {
+		statistics.worstCaseWallTime = statistics.lastWallTime;
+	}
+	wallTimeHistogram.record(statistics.lastWallTime);
+	statistics.releaseCount++;
+
+	/**
+	 * Publish the statistics for this release so that other threads can read them.
+	 */
+	publishedStatistics.store(statistics);
+
+	return end;
 }
 
 /**
@@ -130,69 +403,71 @@ void PeriodicTask::run() {
 	 */
 	keepGoing = true;
 
+	/**
+	 * The first release happens right now.  The release time is the time at which the current release was scheduled to occur.
+	 */
+	int64_t releaseTime = Clock::getClock()->now();
+	driftReferenceValid = false;
+
 	while (keepGoing == true) {
-		// Get the start time for the given iteration of the task.
-		clockid_t threadTimer;
-		struct timespec startTs;
-		struct timespec endTs;
+		int64_t periodNs = ((int64_t) taskPeriod) * 1000;
 
 		/**
-		 * The following gets the wall time, for determining next execution time.
+		 * Run the task for this release.
 		 */
-		std::chrono::high_resolution_clock::time_point start =
-				std::chrono::high_resolution_clock::now();
-
-		/**
-		 * Obtain the cpu time at the start of this periodic task. This is for CPU time measurement.
-		 **/
-		pthread_getcpuclockid(pthread_self(), &threadTimer);
-		clock_gettime(threadTimer, &startTs);
+		int64_t end = executeRelease(releaseTime);
 
-		/**Now run the task.
-		 * Call the task method.
-		 */
-		this->taskMethod();
+		if (schedulingMode == RELATIVE_SLEEP) {
+			/**
+			 * Figure out how long to sleep.  The next release is scheduled one period after the start of this one.
+			 */
+			std::chrono::microseconds remainingSleepTime =
+					std::chrono::microseconds(taskPeriod) - std::chrono::microseconds(statistics.lastWallTime);
+			releaseTime = lastReleaseStart + periodNs;
 
-		/**
-		 *Now get the end CPU time entry.
-		 **/
-		clock_gettime(threadTimer, &endTs);
-		long deltaInus = (endTs.tv_sec * 1000000 + endTs.tv_nsec / 1000)
-				- (startTs.tv_sec * 1000000 + startTs.tv_nsec / 1000);
+			if (remainingSleepTime.count() < 0) {
+				statistics.overrunCount++;
+				publishedStatistics.store(statistics);
+			}
 
-		/**
-		 * Determine where we are in terms of the worst case execution time.
-		 */
-		if (deltaInus > worstCaseExecutionTime) {
-			worstCaseExecutionTime = deltaInus;
-		}
-		lastExecutionTime = deltaInus;
+			/**
+			 * Sleep until the next execution should occur.
+			 */
+			waitForNextExecution(remainingSleepTime);
+		} else {
+			/**
+			 * The next release is exactly one period after the release that was scheduled for this iteration, regardless of when it actually started.
+			 */
+			releaseTime += periodNs;
 
-		/**
-		 * Now figure out exactly what time it is to schedule the next execution.
-		 */
-		std::chrono::high_resolution_clock::time_point end =
-				std::chrono::high_resolution_clock::now();
+			/**
+			 * If the task has run past its next release, apply the overrun policy.
+			 */
+			if (end > releaseTime) {
+				statistics.overrunCount++;
 
-		// Now figure out the difference.
-		std::chrono::microseconds executionTime = std::chrono::duration_cast<
-				std::chrono::microseconds>(end - start);
+				if (overrunPolicy == SKIP_MISSED_RELEASES) {
+					// Skip every release that has already passed.
+					int64_t missedReleases = ((end - releaseTime) / periodNs) + 1;
+					releaseTime += missedReleases * periodNs;
+					releaseIndex += missedReleases;
+					statistics.skippedReleaseCount += missedReleases;
+				} else if (overrunPolicy == REPHASE) {
+					// Release right away and shift the schedule so that it is relative to this late release.  The drift is then measured
+					// from the new phase.
+					releaseTime = end;
+					driftReferenceValid = false;
+				} else {
+					// CATCH_UP: Leave the release time alone so that the missed releases run back to back.
+				}
+				publishedStatistics.store(statistics);
+			}
 
-		lastWallTime = executionTime;
-		if (lastWallTime > worstCaseWallTime) {
-			worstCaseWallTime = lastWallTime;
+			/**
+			 * Sleep until the next release should occur.
+			 */
+			waitForNextExecution(releaseTime);
 		}
-
-		/**
-		 * Figure out how long to sleep.
-		 */
-		std::chrono::microseconds remainingSleepTime =
-				std::chrono::microseconds(taskPeriod) - executionTime;
-
-		/**
-		 * Sleep until the next execution should occur.
-		 */
-		waitForNextExecution(remainingSleepTime);
 	}
 }
 
@@ -29,10 +29,103 @@
 #define PERIODICTASK_H_
 
 #include "RunnableClass.h"
+#include "LatencyHistogram.h"
+#include "SeqLockSnapshot.h"
 
+#include <atomic>
 #include <chrono>
+#include <stdint.h>
+
+class CyclicExecutive;
 
 class PeriodicTask: public RunnableClass {
+	/**
+	 * The cyclic executive invokes the releases of the tasks that it multiplexes, so it needs access to the release accounting.
+	 */
+	friend class CyclicExecutive;
+
+public:
+	/**
+	 * This enumeration defines how the task determines when its next release is to occur.
+	 */
+	enum SchedulingMode {
+		/**
+		 * The task sleeps for the period minus the measured execution time.  Each release slips by the wakeup latency and the
+		 * bookkeeping time, so the task drifts over a long run.
+		 */
+		RELATIVE_SLEEP,
+		/**
+		 * The task keeps an absolute next release time on CLOCK_MONOTONIC and sleeps until it using clock_nanosleep(TIMER_ABSTIME).
+		 * Releases do not drift relative to one another.
+		 */
+		ABSOLUTE_DEADLINE
+	};
+
+	/**
+	 * This enumeration defines what happens in ABSOLUTE_DEADLINE mode when the task method runs past the next release time.
+	 */
+	enum OverrunPolicy {
+		/**
+		 * Any releases which have already passed are skipped.  The task runs again at the next release time that is still in the future.
+		 */
+		SKIP_MISSED_RELEASES,
+		/**
+		 * Every missed release is executed back to back until the task has caught up with its schedule.
+		 */
+		CATCH_UP,
+		/**
+		 * The task is released immediately and the schedule is shifted so that future releases are one period apart from this late release.
+		 */
+		REPHASE
+	};
+
+	/**
+	 * This structure holds the execution statistics for a task.  All times are given in microseconds.
+	 */
+	struct TaskStatistics {
+		/**
+		 * This is the CPU time of the last release.
+		 */
+		long lastExecutionTime;
+		/**
+		 * This is the worst case CPU time of any release.
+		 */
+		long worstCaseExecutionTime;
+		/**
+		 * This is the wall time of the last release.  The wall time is the time from the start to the end of the task running.
+		 */
+		long lastWallTime;
+		/**
+		 * This is the worst case wall time of any release.
+		 */
+		long worstCaseWallTime;
+		/**
+		 * This is the release jitter of the last release.  It is the time from when the release was scheduled to occur until the task actually woke up.
+		 */
+		long lastReleaseJitter;
+		/**
+		 * This is the worst case release jitter that has been observed.
+		 */
+		long worstCaseReleaseJitter;
+		/**
+		 * This is the cumulative drift.  It is how far the start of the latest release is from where it would be if every release had
+		 * occurred exactly one period after the first one.
+		 */
+		long cumulativeDrift;
+		/**
+		 * This is the number of times that the task has run past its next release time.
+		 */
+		uint32_t overrunCount;
+		/**
+		 * This is the number of releases that have been skipped because of the SKIP_MISSED_RELEASES overrun policy.
+		 */
+		uint32_t skippedReleaseCount;
+		/**
+		 * This is the number of releases that have been executed.
+		 */
+		uint64_t releaseCount;
+	};
+
 private:
 	/**
 	 * This variable sets the period for the task.  The period defines the length of
@@ -42,24 +135,84 @@ private:
 	uint32_t taskPeriod = 100000;
 
 	/**
-	 * This variable stores the worst case execution time from a CPU time standpoint.
+	 * These are the statistics for the task.  They are only ever written by the thread which executes the releases of the task.
+	 */
+	TaskStatistics statistics;
+
+	/**
+	 * This is the latest consistent copy of the statistics.  It is published by the thread which executes the releases, and is what
+	 * every other thread reads.
+	 */
+	SeqLockSnapshot<TaskStatistics> publishedStatistics;
+
+	/**
+	 * This flag is set when another thread requests that the diagnostics be reset.  The reset is carried out by the thread which executes
+	 * the releases at the start of the next release, so the statistics and histograms keep a single writer.
+	 */
+	std::atomic<bool> resetRequested;
+
+	/**
+	 * This histogram holds the release latency of every release, in microseconds.  The release latency is the time from when the release
+	 * was scheduled until the task actually started running.
+	 */
+	LatencyHistogram releaseLatencyHistogram;
+
+	/**
+	 * This histogram holds the CPU time of every release, in microseconds.
+	 */
+	LatencyHistogram cpuTimeHistogram;
+
+	/**
+	 * This histogram holds the wall time of every release, in microseconds.
+	 */
+	LatencyHistogram wallTimeHistogram;
+
+	/**
+	 * This is the mode that is used to schedule the next release of the task.
+	 */
+	SchedulingMode schedulingMode = ABSOLUTE_DEADLINE;
+
+	/**
+	 * This is the policy that is applied when the task runs past its next release time in ABSOLUTE_DEADLINE mode.
+	 */
+	OverrunPolicy overrunPolicy = SKIP_MISSED_RELEASES;
+
+	/**
+	 * This flag indicates whether the drift reference is valid.  It is cleared when the reference is to be re-established at the next release,
+	 * such as after the diagnostics have been reset.
+	 */
+	bool driftReferenceValid = false;
+
+	/**
+	 * This is the monotonic time, in nanoseconds, at which the drift reference release started.
+	 */
+	int64_t driftReference = 0;
+
+	/**
+	 * This is the number of periods which have elapsed since the drift reference release.
+	 */
+	int64_t releaseIndex = 0;
+
+	/**
+	 * This is the monotonic time, in nanoseconds, at which the last release started.
 	 */
-	long worstCaseExecutionTime = 0;
+	int64_t lastReleaseStart = 0;
 
 	/**
-	 * This variable holds the last execution value for the CPU, showing the time it took to execute.
+	 * This is the cyclic executive that all periodic tasks are multiplexed onto when they are started.  If it is NULL, each periodic task gets its own thread.
 	 */
-	long lastExecutionTime = 0;
+	static CyclicExecutive *defaultExecutive;
 
 	/**
-	 * This variable holds the last wall time measurement for the given periodic task.  The wall time is the time from the start to the end of the task running.
+	 * This is the cyclic executive that this task has been registered with.  It is NULL if the task runs on its own thread.
 	 */
-	std::chrono::microseconds lastWallTime = std::chrono::microseconds(0);
+	CyclicExecutive *executive = NULL;
 
 	/**
-	 * This variable holds the worst case wall time.  This is the worst case from start to finish of the given periodic task.
+	 * This flag determines whether the task may be multiplexed onto the cyclic executive.  Tasks which block for a long time, such as the camera, must
+	 * run on their own thread.
 	 */
-	std::chrono::microseconds worstCaseWallTime = std::chrono::microseconds(0);
+	bool multiplexingAllowed = true;
 
 	/**
 	 * This is a private method that will be used by start to invoke the run method.
@@ -75,6 +228,33 @@ private:
 	 */
 	void waitForNextExecution();
 
+	/**
+	 * This method will suspend execution until the given absolute time on the clock has been reached.  It will do this by blocking.
+	 * @param releaseTimeNs This is the absolute release time, in nanoseconds, on the clock.
+	 */
+	void waitForNextExecution(int64_t releaseTimeNs);
+
+protected:
+	/**
+	 * This method will execute a single release of the task.  It invokes the task method and updates the release jitter, drift, CPU time
+	 * and wall time statistics for the task.
+	 * @param scheduledReleaseNs This is the monotonic time, in nanoseconds, at which this release was scheduled to occur.
+	 * @return The monotonic time, in nanoseconds, at which the release completed will be returned.
+	 */
+	int64_t executeRelease(int64_t scheduledReleaseNs);
+
+	/**
+	 * This method will hand the task to the default cyclic executive instead of starting a new thread, if multiplexed execution has been selected.
+	 * @return true if the task has been registered with a cyclic executive.  False if a thread is to be started for it.
+	 */
+	virtual bool startOnExternalExecutor();
+
+	/**
+	 * This method will determine whether the thread of this task takes part in the clock.  A periodic task only waits on the clock, so it does.
+	 * @return true will be returned.
+	 */
+	virtual bool isClockParticipant();
+
 public:
 	/**
 	 * This is the default constructor for the class.
@@ -108,20 +288,94 @@ public:
 	 */
 	virtual uint32_t getTaskPeriod() final;
 
+	/**
+	 * This method will set the mode that is used to schedule the releases of this task.
+	 * @param mode This is the scheduling mode that is to be used.
+	 */
+	virtual void setSchedulingMode(SchedulingMode mode) final;
+
+	/**
+	 * This method will return the mode that is used to schedule the releases of this task.
+	 * @return The scheduling mode will be returned.
+	 */
+	virtual SchedulingMode getSchedulingMode() final;
+
+	/**
+	 * This method will set the policy that is used when the task runs past its next release time.
+	 * @param policy This is the overrun policy that is to be used.
+	 */
+	virtual void setOverrunPolicy(OverrunPolicy policy) final;
+
+	/**
+	 * This method will return the policy that is used when the task runs past its next release time.
+	 * @return The overrun policy will be returned.
+	 */
+	virtual OverrunPolicy getOverrunPolicy() final;
+
+	/**
+	 * This method will select the cyclic executive that periodic tasks are multiplexed onto when they are started.  It must be called at startup,
+	 * before any periodic task is started.
+	 * @param executive This is the executive that is to be used.  If it is NULL, each periodic task will run on its own thread.
+	 */
+	static void setDefaultExecutive(CyclicExecutive *executive);
+
+	/**
+	 * This method will determine whether this task may be multiplexed onto the cyclic executive.  It must be called before the task is started.
+	 * @param allowed If true, the task will run on the default executive if one has been selected.  If false, the task always gets its own thread.
+	 */
+	virtual void setMultiplexingAllowed(bool allowed) final;
+
+	/**
+	 * This method will return the cyclic executive that this task has been multiplexed onto.
+	 * @return The executive will be returned, or NULL if the task runs on its own thread.
+	 */
+	virtual CyclicExecutive *getExecutive() final;
+
+	/**
+	 * This method will block waiting for the task to terminate.  If the task has been multiplexed, this waits for the executive to release it.
+	 */
+	virtual void waitForShutdown();
+
 	/**
 	 * This is the run method for the class.
 	 */
 	void run() final;
 
+	/**
+	 * This method will return a consistent copy of the latest statistics for the task.  It may be called from any thread, and it never blocks
+	 * or delays the thread which executes the task.
+	 * @return The statistics will be returned.
+	 */
+	virtual TaskStatistics getStatistics() final;
+
+	/**
+	 * This method will return the number of times any periodic task has run past its next release time.  It must not be called while
+	 * tasks are still being created.
+	 * @return The total overrun count of every periodic task.
+	 */
+	static uint32_t getTotalOverrunCount();
+
 	/**
 	 * This method will print out information about the given thread.  The info will be dependent upon the given thread.
 	 */
 	virtual void printInformation();
 
+	/**
+	 * This method will print out the release latency, CPU time and wall time percentiles for the task.
+	 */
+	virtual void printHistogramInformation();
+
+	/**
+	 * This method will write the release latency, CPU time and wall time histograms for the task in CSV format.
+	 * @param os This is the stream that the CSV data is to be written to.
+	 */
+	virtual void writeHistogramCSV(std::ostream &os);
+
 	virtual double getCPUUsageInfo();
 
 	/**
-	 * This method will reset thread diagnostics back to their default values.  The wall times and CPU times will be set to 0.
+	 * This method will reset thread diagnostics back to their default values.  The wall times and CPU times will be set to 0.  The reset
+	 * takes effect at the start of the next release of the task.
 	 */
 	virtual void resetThreadDiagnostics();
 
@@ -0,0 +1,123 @@
+/**
+ * @file QueueCfg.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines the configuration for the command queues, including which implementation each queue uses.
+ */
+#ifndef QUEUECFG_H_
+#define QUEUECFG_H_
+
+/**
+ * These macros select the implementation behind a command queue.  The locked queue is a preallocated ring guarded by a mutex and any
+ * number of threads may enqueue and dequeue.  The MPSC queue is a preallocated lock-free ring which allows many producers and one consumer.
+ * The SPSC queue is a lighter lock-free ring which allows exactly one producer and one consumer.
+ */
+#define LOCKED_COMMAND_QUEUE (0)
+#define MPSC_COMMAND_QUEUE (1)
+#define SPSC_COMMAND_QUEUE (2)
+
+/**
+ * This is the default number of commands each priority level of a command queue can hold.  It is rounded up to a power of two.
+ */
+#define COMMAND_QUEUE_CAPACITY (256)
+
+/**
+ * These macros define what happens to a command which is enqueued while its priority level is full.
+ * OVERFLOW_BLOCK blocks the producer until the consumer makes room.
+ * OVERFLOW_DROP_NEWEST discards the command being enqueued.
+ * OVERFLOW_DROP_OLDEST discards the oldest command on the level to make room.  A single producer queue cannot remove commands from the
+ * producer side, so it drops the newest command instead.
+ * OVERFLOW_COALESCE keeps one command beyond the capacity of the level.  Each further command replaces it, so the consumer gets everything
+ * that fitted followed by the latest command.
+ * A full safety level always blocks, whatever the policy, so that a safety command is never lost.
+ */
+#define OVERFLOW_BLOCK (0)
+#define OVERFLOW_DROP_NEWEST (1)
+#define OVERFLOW_DROP_OLDEST (2)
+#define OVERFLOW_COALESCE (3)
+
+/**
+ * This is the size of a cache line, in bytes.  The producer and consumer indices of the lock-free queues are kept this far apart so that
+ * they never share a cache line.
+ */
+#define CACHE_LINE_SIZE (64)
+
+/**
+ * These macros define the priority levels of a command queue which has a classifier, where 0 is the highest priority.
+ * Safety commands, such as an emergency stop, are dequeued ahead of everything else.  Motion commands are direction changes, which a
+ * later safety command overrides.  Routine commands are everything else, such as speed and steering setpoints.
+ */
+#define SAFETY_COMMAND_PRIORITY (0)
+#define MOTION_COMMAND_PRIORITY (1)
+#define ROUTINE_COMMAND_PRIORITY (2)
+#define COMMAND_PRIORITY_LEVELS (3)
+
+/**
+ * These macros define the keys of the coalescing slots of a command queue which has a coalescer.  A command with a key only ever
+ * occupies one place in the queue.  If a newer command with the same key is enqueued before the consumer reaches it, the newer command
+ * overwrites it, so the consumer always acts on the latest value.
+ */
+#define SPEED_COALESCING_KEY (0)
+#define STEERING_COALESCING_KEY (1)
+#define DIRECTION_COALESCING_KEY (2)
+#define COMMAND_COALESCING_KEYS (3)
+
+/**
+ * These macros select the implementation for each of the queues in the system.
+ * The robot controller queue is fed by the network manager, the line sensor and the collision sensor.
+ * The horn queue is fed by the network manager, the collision sensor, the robot controller and the console.
+ * The line sensor queue is only fed by the network manager.
+ */
+#define ROBOT_CONTROLLER_QUEUE_IMPLEMENTATION (MPSC_COMMAND_QUEUE)
+#define HORN_QUEUE_IMPLEMENTATION (MPSC_COMMAND_QUEUE)
+#define LINE_SENSOR_QUEUE_IMPLEMENTATION (SPSC_COMMAND_QUEUE)
+
+/**
+ * These macros set the number of commands each priority level of the given queue can hold.  Every queue is allocated in full when it is
+ * constructed, so these fix the memory used by the queues.
+ */
+#define ROBOT_CONTROLLER_QUEUE_CAPACITY (64)
+#define HORN_QUEUE_CAPACITY (16)
+#define LINE_SENSOR_QUEUE_CAPACITY (16)
+
+/**
+ * These macros select the overflow policy for each queue.  The robot controller blocks its producers, which pushes back on the network
+ * client through TCP rather than losing commands.  Only the latest horn and line sensor commands matter once those queues back up.
+ */
+#define ROBOT_CONTROLLER_QUEUE_OVERFLOW_POLICY (OVERFLOW_BLOCK)
+#define HORN_QUEUE_OVERFLOW_POLICY (OVERFLOW_DROP_OLDEST)
+#define LINE_SENSOR_QUEUE_OVERFLOW_POLICY (OVERFLOW_COALESCE)
+
+/**
+ * These macros select whether a safety command enqueued on the given queue discards the motion commands that were queued before it.
+ * When the robot controller queue flushes, a stop from the collision sensor cancels any direction change still waiting behind it.
+ * The horn queue must flush, since sounding the horn jumps ahead of the mutes queued before it, which would otherwise silence it.
+ */
+#define ROBOT_CONTROLLER_QUEUE_FLUSH_SUPERSEDED (1)
+#define HORN_QUEUE_FLUSH_SUPERSEDED (1)
+
+/**
+ * This macro selects whether the speed, steering and direction setpoints on the robot controller queue are coalesced, so that the
+ * controller skips setpoints which have already been replaced by newer ones.
+ */
+#define ROBOT_CONTROLLER_QUEUE_COALESCING (1)
+
+#endif /* QUEUECFG_H_ */
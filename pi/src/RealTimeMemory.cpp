@@ -0,0 +1,326 @@
+/**
+ * @file RealTimeMemory.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the real time memory hardening mode.  It also replaces the global operator new and operator delete, so that
+ *      heap allocations made by real time threads after startup can be counted.
+ */
+
+#include "RealTimeMemory.h"
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+/**
+ * These are the records for the real time threads that have been registered.
+ */
+RealTimeMemory::ThreadRecord RealTimeMemory::threads[REALTIME_MEMORY_MAX_THREADS];
+
+/**
+ * This is the number of records which have been claimed.
+ */
+std::atomic<uint32_t> RealTimeMemory::threadCount(0);
+
+/**
+ * This flag is set once the hardening mode has been enabled.
+ */
+std::atomic<bool> RealTimeMemory::enabled(false);
+
+/**
+ * This flag is set if all memory was successfully locked.
+ */
+std::atomic<bool> RealTimeMemory::memoryLocked(false);
+
+/**
+ * This flag is set once startup is complete.
+ */
+std::atomic<bool> RealTimeMemory::heapFrozen(false);
+
+/**
+ * This is the index of the record for the calling thread, or -1 if the calling thread is not a registered real time thread.
+ */
+static thread_local int currentThreadRecord = -1;
+
+/**
+ * This method will enable the hardening mode.  It disables heap trimming, locks all current memory, locks future memory as it is faulted in,
+ * bounds the stacks of the threads started later, and prefaults the heap and the stack of the calling thread.  It must be called at the start of main, before any thread has been started.
+ * @return true if all memory was locked.  False if locking failed, in which case allocations are still tracked.
+ */
+bool RealTimeMemory::enable() {
+	/**
+	 * 1.0 Keep freed memory in the heap, and serve large allocations from the heap rather than from new mappings, so that memory which has been
+	 * faulted in once stays resident.
+	 */
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	/**
+	 * 2.0 Lock all current pages into RAM.  Future pages are only locked once they are faulted in.  Locking them outright would fault in
+	 * and pin the whole of every thread stack, which is 8 MB each by default, when only the prefaulted part of it is ever used.
+	 */
+	if (mlockall(MCL_CURRENT) != 0) {
+		perror("Failed to lock memory");
+	} else if (mlockall(MCL_FUTURE | MCL_ONFAULT) != 0) {
+		perror("Failed to lock future memory");
+	} else {
+		memoryLocked = true;
+	}
+
+	/**
+	 * 2.1 Give every thread started from now on a bounded stack, so that each one adds no more than REALTIME_THREAD_STACK_SIZE to the
+	 * locked memory.
+	 */
+	pthread_attr_t attributes;
+	if (pthread_attr_init(&attributes) == 0) {
+		if ((pthread_attr_setstacksize(&attributes, REALTIME_THREAD_STACK_SIZE) != 0)
+				|| (pthread_setattr_default_np(&attributes) != 0)) {
+			printf("Failed to set the default thread stack size.\n");
+		}
+		pthread_attr_destroy(&attributes);
+	}
+
+	/**
+	 * 3.0 Grow the heap and touch every page of it.  Once freed, the memory stays in the heap, so later allocations do not fault.
+	 */
+	long pageSize = sysconf(_SC_PAGESIZE);
+	char *heap = (char*) malloc(REALTIME_HEAP_PREFAULT_SIZE);
+	if (heap != NULL) {
+		for (long offset = 0; offset < REALTIME_HEAP_PREFAULT_SIZE; offset += pageSize) {
+			heap[offset] = 0;
+		}
+		free(heap);
+	}
+
+	/**
+	 * 4.0 Prefault the stack of the main thread.
+	 */
+	prefaultStack();
+
+	enabled = true;
+	return memoryLocked;
+}
+
+/**
+ * This method will determine whether the hardening mode has been enabled.
+ * @return true if the mode is enabled.  False otherwise.
+ */
+bool RealTimeMemory::isEnabled() {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will touch every page of the first REALTIME_STACK_PREFAULT_SIZE bytes of the calling thread's stack, so that they are resident.
+ */
+void RealTimeMemory::prefaultStack() {
+	volatile char stack[REALTIME_STACK_PREFAULT_SIZE];
+	long pageSize = sysconf(_SC_PAGESIZE);
+
+	for (long offset = 0; offset < REALTIME_STACK_PREFAULT_SIZE; offset += pageSize) {
+		stack[offset] = 0;
+	}
+
+	// Read the stack back so that the compiler cannot discard the writes.
+	(void) stack[0];
+}
+
+/**
+ * This method will register the calling thread as a real time thread, so that its allocations after the heap is frozen are counted.
+ * @param name This is the name of the thread.
+ * @param tid This is the OS thread id of the calling thread.
+ */
+void RealTimeMemory::registerRealTimeThread(const std::string &name, pid_t tid) {
+	uint32_t index = threadCount.fetch_add(1);
+	if (index >= REALTIME_MEMORY_MAX_THREADS) {
+		printf("Too many real time threads to track the allocations of %s\n", name.c_str());
+		return;
+	}
+
+	ThreadRecord &record = threads[index];
+	strncpy(record.name, name.c_str(), sizeof(record.name) - 1);
+	record.name[sizeof(record.name) - 1] = '\0';
+	record.tid = tid;
+	record.allocationCount = 0;
+	captureBaseline(record);
+	record.valid.store(true, std::memory_order_release);
+
+	currentThreadRecord = (int) index;
+}
+
+/**
+ * This method will mark startup as complete.  From then on, heap allocations and page faults of real time threads are counted.
+ */
+void RealTimeMemory::freezeHeap() {
+	/**
+	 * Page faults are counted from the point at which the heap is frozen, so take the baseline of every thread registered so far.
+	 */
+	uint32_t count = threadCount.load();
+	for (uint32_t index = 0; (index < count) && (index < REALTIME_MEMORY_MAX_THREADS); index++) {
+		if (threads[index].valid.load(std::memory_order_acquire)) {
+			captureBaseline(threads[index]);
+		}
+	}
+	heapFrozen = true;
+	std::cout << "Heap frozen.  Allocations from real time threads will now be reported.\n";
+}
+
+/**
+ * This method is called for every heap allocation made through operator new.  If the heap is frozen and the calling thread is a real time
+ * thread, the allocation is counted against the thread.
+ */
+void RealTimeMemory::recordAllocation() {
+	int index = currentThreadRecord;
+	if ((index >= 0) && (heapFrozen.load(std::memory_order_relaxed))) {
+		threads[index].allocationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * This method will read the number of page faults that a thread of this process has taken.  It does not allocate memory.
+ * @param tid This is the OS thread id of the thread.
+ * @param minorFaults This is filled in with the number of minor page faults.
+ * @param majorFaults This is filled in with the number of major page faults.
+ * @return true if the page faults could be read.  False otherwise.
+ */
+bool RealTimeMemory::readPageFaults(pid_t tid, long &minorFaults, long &majorFaults) {
+	char path[64];
+	char stat[512];
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int) tid);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	ssize_t length = read(fd, stat, sizeof(stat) - 1);
+	close(fd);
+	if (length <= 0) {
+		return false;
+	}
+	stat[length] = '\0';
+
+	/**
+	 * The thread name is in parentheses and may contain spaces, so start parsing after the last closing parenthesis.  The fields after it are
+	 * state, ppid, pgrp, session, tty_nr, tpgid, flags, minflt, cminflt and majflt.
+	 */
+	char *fields = strrchr(stat, ')');
+	if (fields == NULL) {
+		return false;
+	}
+	return (sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %ld %*d %ld", &minorFaults, &majorFaults) == 2);
+}
+
+/**
+ * This method will record the current page faults of a thread as its baseline.
+ * @param record This is the record for the thread.
+ */
+void RealTimeMemory::captureBaseline(ThreadRecord &record) {
+	long minorFaults = 0;
+	long majorFaults = 0;
+
+	readPageFaults(record.tid, minorFaults, majorFaults);
+	record.baselineMinorFaults = minorFaults;
+	record.baselineMajorFaults = majorFaults;
+}
+
+/**
+ * This method will print out the allocations and page faults of each real time thread since the heap was frozen.
+ */
+void RealTimeMemory::printReport() {
+	std::cout
+			<< "===============================================================================================\nReal Time Memory Report:\n";
+	std::cout << "Hardening enabled: " << (isEnabled() ? "yes" : "no")
+			<< "\tMemory locked: " << (memoryLocked ? "yes" : "no")
+			<< "\tHeap frozen: " << (heapFrozen ? "yes" : "no") << "\n";
+	std::cout << "Thread\tTask              \tAllocations\tMinor Faults\tMajor Faults\n";
+
+	uint32_t count = threadCount.load();
+	for (uint32_t index = 0; (index < count) && (index < REALTIME_MEMORY_MAX_THREADS); index++) {
+		ThreadRecord &record = threads[index];
+		if (record.valid.load(std::memory_order_acquire) == false) {
+			continue;
+		}
+
+		long minorFaults = 0;
+		long majorFaults = 0;
+		if (readPageFaults(record.tid, minorFaults, majorFaults)) {
+			minorFaults -= record.baselineMinorFaults;
+			majorFaults -= record.baselineMajorFaults;
+		}
+
+		std::cout << record.tid << "\t" << std::setw(18) << record.name << "\t"
+				<< std::setw(11) << record.allocationCount << "\t" << std::setw(12)
+				<< minorFaults << "\t" << std::setw(12) << majorFaults;
+		if ((heapFrozen) && ((record.allocationCount > 0) || (minorFaults > 0) || (majorFaults > 0))) {
+			std::cout << "**";
+		}
+		std::cout << "\n";
+	}
+	std::cout << "===============================================================================================\n";
+}
+
+/**
+ * These replace the global allocation functions, so that every allocation made through new is seen by the allocation tracking.
+ */
+void *operator new(std::size_t size) {
+	RealTimeMemory::recordAllocation();
+	void *memory = malloc((size == 0) ? 1 : size);
+	if (memory == NULL) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void *operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	RealTimeMemory::recordAllocation();
+	return malloc((size == 0) ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void *memory) noexcept {
+	free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t&) noexcept {
+	free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t&) noexcept {
+	free(memory);
+}
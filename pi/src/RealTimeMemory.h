@@ -0,0 +1,157 @@
+/**
+ * @file RealTimeMemory.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the real time memory hardening mode.  At startup, all memory is locked into RAM, the heap is prefaulted and
+ *      trimming is disabled so that freed memory stays resident.  Memory mapped later, such as a thread stack, is locked as it is faulted
+ *      in.  Threads are started with a bounded stack, and each thread started by a runnable class prefaults its stack, so only that part
+ *      of the stack is resident.  Once startup is complete the heap is frozen, and from then on every heap allocation made through operator
+ *      new by a real time (SCHED_FIFO) thread is counted, along with the page faults taken by that thread, so that they can be reported on the console.
+ */
+
+#ifndef REALTIMEMEMORY_H_
+#define REALTIMEMEMORY_H_
+
+#include "MemoryCfg.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+class RealTimeMemory {
+private:
+	/**
+	 * This structure holds the allocation tracking for a single real time thread.
+	 */
+	struct ThreadRecord {
+		/**
+		 * This is the name of the thread.  It is a fixed size array so that registering a thread does not allocate.
+		 */
+		char name[32];
+		/**
+		 * This is the OS thread id of the thread.
+		 */
+		pid_t tid;
+		/**
+		 * This flag is set once the record has been filled in.
+		 */
+		std::atomic<bool> valid;
+		/**
+		 * This is the number of heap allocations the thread has made since the heap was frozen.
+		 */
+		std::atomic<uint32_t> allocationCount;
+		/**
+		 * This is the number of minor page faults the thread had taken when the heap was frozen.
+		 */
+		std::atomic<long> baselineMinorFaults;
+		/**
+		 * This is the number of major page faults the thread had taken when the heap was frozen.
+		 */
+		std::atomic<long> baselineMajorFaults;
+	};
+
+	/**
+	 * These are the records for the real time threads that have been registered.
+	 */
+	static ThreadRecord threads[REALTIME_MEMORY_MAX_THREADS];
+
+	/**
+	 * This is the number of records which have been claimed.
+	 */
+	static std::atomic<uint32_t> threadCount;
+
+	/**
+	 * This flag is set once the hardening mode has been enabled.
+	 */
+	static std::atomic<bool> enabled;
+
+	/**
+	 * This flag is set if all memory was successfully locked.
+	 */
+	static std::atomic<bool> memoryLocked;
+
+	/**
+	 * This flag is set once startup is complete.  From then on, allocations made by real time threads are counted.
+	 */
+	static std::atomic<bool> heapFrozen;
+
+	/**
+	 * This method will read the number of page faults that a thread of this process has taken.  It does not allocate memory.
+	 * @param tid This is the OS thread id of the thread.
+	 * @param minorFaults This is filled in with the number of minor page faults.
+	 * @param majorFaults This is filled in with the number of major page faults.
+	 * @return true if the page faults could be read.  False otherwise.
+	 */
+	static bool readPageFaults(pid_t tid, long &minorFaults, long &majorFaults);
+
+	/**
+	 * This method will record the current page faults of a thread as its baseline.
+	 * @param record This is the record for the thread.
+	 */
+	static void captureBaseline(ThreadRecord &record);
+
+public:
+	/**
+	 * This method will enable the hardening mode.  It disables heap trimming, locks all current memory, locks future memory as it is faulted
+	 * in, bounds the stacks of the threads started later, and prefaults the heap and the stack of the calling thread.  It must be called at the start of main, before any thread has been
+	 * started.
+	 * @return true if all memory was locked.  False if locking failed, in which case allocations are still tracked.
+	 */
+	static bool enable();
+
+	/**
+	 * This method will determine whether the hardening mode has been enabled.
+	 * @return true if the mode is enabled.  False otherwise.
+	 */
+	static bool isEnabled();
+
+	/**
+	 * This method will touch every page of the first REALTIME_STACK_PREFAULT_SIZE bytes of the calling thread's stack, so that they are resident.
+	 */
+	static void prefaultStack();
+
+	/**
+	 * This method will register the calling thread as a real time thread, so that its allocations after the heap is frozen are counted.
+	 * @param name This is the name of the thread.
+	 * @param tid This is the OS thread id of the calling thread.
+	 */
+	static void registerRealTimeThread(const std::string &name, pid_t tid);
+
+	/**
+	 * This method will mark startup as complete.  From then on, heap allocations and page faults of real time threads are counted.
+	 */
+	static void freezeHeap();
+
+	/**
+	 * This method is called for every heap allocation made through operator new.  If the heap is frozen and the calling thread is a real time
+	 * thread, the allocation is counted against the thread.
+	 */
+	static void recordAllocation();
+
+	/**
+	 * This method will print out the allocations and page faults of each real time thread since the heap was frozen.
+	 */
+	static void printReport();
+};
+
+#endif /* REALTIMEMEMORY_H_ */
@@ -0,0 +1,63 @@
+/**
+ * @file RingBuffer.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the parts of the ring buffer interface which are shared by every ring.
+ */
+
+#include "RingBuffer.h"
+
+/**
+ * This is the constructor for the class.
+ * @param requestedCapacity This is the requested number of slots.  It is rounded up to a power of two.
+ */
+RingBuffer::RingBuffer(uint32_t requestedCapacity) {
+	capacity = roundUpToPowerOfTwo(requestedCapacity);
+	mask = capacity - 1;
+}
+
+/**
+ * This is the destructor for the class.
+ */
+RingBuffer::~RingBuffer() {
+}
+
+/**
+ * This method will round a requested capacity up to the next power of two.
+ * @param requestedCapacity This is the requested number of slots.
+ * @return The capacity which will be used.  It is at least 2.
+ */
+uint32_t RingBuffer::roundUpToPowerOfTwo(uint32_t requestedCapacity) {
+	uint32_t result = 2;
+
+	while ((result < requestedCapacity) && (result < 0x80000000U)) {
+		result = result << 1;
+	}
+	return result;
+}
+
+/**
+ * This method will return the number of slots in the ring.
+ * @return The capacity of the ring.
+ */
+uint32_t RingBuffer::getCapacity() {
+	return capacity;
+}
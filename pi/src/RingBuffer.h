@@ -0,0 +1,92 @@
+/**
+ * @file RingBuffer.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines the interface shared by the preallocated, lock-free ring buffers which back the command queues.
+ * A ring buffer never allocates after construction and never blocks.  Pushing to a full ring or popping from an empty ring fails,
+ * and it is up to the owner to decide whether to wait.  Every ring allows exactly one consumer thread.
+ */
+#ifndef RINGBUFFER_H_
+#define RINGBUFFER_H_
+
+#include <stdint.h>
+#include "CommandEnvelope.h"
+
+class RingBuffer {
+protected:
+	/**
+	 * This is the number of slots in the ring.  It is always a power of two.
+	 */
+	uint32_t capacity;
+
+	/**
+	 * This is the mask which maps a position onto a slot.  It is one less than the capacity.
+	 */
+	uint32_t mask;
+
+	/**
+	 * This method will round a requested capacity up to the next power of two, so that positions can be mapped onto slots with a mask.
+	 * @param requestedCapacity This is the requested number of slots.
+	 * @return The capacity which will be used.  It is at least 2.
+	 */
+	static uint32_t roundUpToPowerOfTwo(uint32_t requestedCapacity);
+
+public:
+	/**
+	 * This is the constructor for the class.
+	 * @param requestedCapacity This is the requested number of slots.  It is rounded up to a power of two.
+	 */
+	RingBuffer(uint32_t requestedCapacity);
+
+	/**
+	 * This is the destructor for the class.
+	 */
+	virtual ~RingBuffer();
+
+	/**
+	 * This method will add a command to the ring.
+	 * @param value This is the command to be added.
+	 * @return true if the command was added.  False if the ring was full.
+	 */
+	virtual bool push(const CommandEnvelope &value) = 0;
+
+	/**
+	 * This method will remove the oldest command from the ring.  It may only be called from the consumer thread.
+	 * @param value This is the location into which the command is written.  It is not modified if nothing was removed.
+	 * @return true if a command was removed.  False if the ring was empty.
+	 */
+	virtual bool pop(CommandEnvelope &value) = 0;
+
+	/**
+	 * This method will return the number of commands in the ring.  When it is called while other threads are pushing and popping, the
+	 * result is only a snapshot.
+	 * @return The number of commands in the ring.
+	 */
+	virtual uint32_t getOccupancy() = 0;
+
+	/**
+	 * This method will return the number of slots in the ring.
+	 * @return The capacity of the ring.
+	 */
+	virtual uint32_t getCapacity() final;
+};
+
+#endif /* RINGBUFFER_H_ */
@@ -14,6 +14,7 @@
 #include "CommandQueue.h"
 #include <string>
 #include <iostream>
+#include <iomanip>
 #include <stdio.h>
 
 using namespace std;
@@ -34,6 +35,12 @@ RobotController::RobotController(CommandQueue* queue, std::string threadName) :
 	leftRearMotor->setSpeed(500);
 	rightFrontMotor->setSpeed(500);
 	rightRearMotor->setSpeed(500);
+
+	// The motors are started by the controller thread, so give them the control cores explicitly rather than inheriting them.
+	leftFrontMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
+	leftRearMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
+	rightFrontMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
+	rightRearMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
 }
 
 RobotController::RobotController(CommandQueue* queue, CommandQueue* hornQueue, std::string threadName) : RunnableClass(threadName) {
@@ -50,6 +57,12 @@ RobotController::RobotController(CommandQueue* queue, CommandQueue* hornQueue, s
 	rightFrontMotor->setSpeed(500);
 	rightRearMotor->setSpeed(500);
 
+	// The motors are started by the controller thread, so give them the control cores explicitly rather than inheriting them.
+	leftFrontMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
+	leftRearMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
+	rightFrontMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
+	rightRearMotor->setAffinity(MOTOR_CTRL_TASK_CPUS);
+
 }
 
 RobotController::~RobotController() {
@@ -59,32 +72,30 @@ RobotController::~RobotController() {
 	delete rightRearMotor;
 }
 
-void RobotController::run() {
-
+/**
+ * This method will start the motor controllers.  They are started from start, on the thread which starts the robot controller, so that
+ * they are started in the same order every time.
+ */
+void RobotController::startChildRunnables() {
 	leftFrontMotor->start();
 	leftRearMotor->start();
 	rightFrontMotor->start();
 	rightRearMotor->start();
+}
 
-	while (keepGoing) {
-		if (referencequeue->hasItem()) {
-			int taskNumber = referencequeue->dequeue();
-
-			int commandArg = taskNumber & 0xFFF;
-			int command = taskNumber - commandArg;
-
-			if (command == STEERINGOFFSETBITMAP) {
-				processSteeringControlCommand(commandArg);
-
-			} else if (command == MOTORDIRECTIONBITMAP) {
-				processMotionControlCommand(commandArg);
+void RobotController::run() {
+	CommandEnvelope commands[ROBOT_CONTROLLER_BATCH_SIZE];
 
-			} else if (command == SPEEDDIRECTIONBITMAP) {
-				processSpeedControlCommand(commandArg);
+	while (keepGoing) {
+		// 1.0 Block until a command arrives.  The timeout only bounds how long a stop request can go unnoticed.
+		if (referencequeue->dequeueFor(commands[0], ROBOT_CONTROLLER_IDLE_TIMEOUT)) {
+			// 2.0 Handle the command that woke the thread along with every command that queued up behind it.
+			int commandCount = 1 + referencequeue->drainTo(&commands[1], ROBOT_CONTROLLER_BATCH_SIZE - 1);
 
+			for (int index = 0; index < commandCount; index++) {
+				processCommand(commands[index]);
 			}
 		}
-
 	}
 
 	leftFrontMotor->stop();
@@ -96,6 +107,12 @@ void RobotController::run() {
 
 void RobotController::waitForShutdown() {
 	RunnableClass::waitForShutdown();
+
+	// The motors were started by this controller, so their threads must be joined before it deletes them.
+	leftFrontMotor->waitForShutdown();
+	leftRearMotor->waitForShutdown();
+	rightFrontMotor->waitForShutdown();
+	rightRearMotor->waitForShutdown();
 }
 
 void RobotController::stop() {
@@ -106,7 +123,88 @@ void RobotController::stop() {
 	rightFrontMotor->stop();
 	rightRearMotor->stop();
 
-	referencequeue->enqueue(STOP);
+	referencequeue->enqueue(STOP, COMMAND_SOURCE_CONTROLLER);
+}
+
+int RobotController::classifyCommand(int command) {
+	int commandArg = command & 0xFFF;
+	int commandType = command - commandArg;
+
+	if (commandType == MOTORDIRECTIONBITMAP) {
+		if (commandArg == STOP) {
+			return SAFETY_COMMAND_PRIORITY;
+		}
+		return MOTION_COMMAND_PRIORITY;
+	}
+	return ROUTINE_COMMAND_PRIORITY;
+}
+
+int RobotController::coalescingKey(int command) {
+	int commandArg = command & 0xFFF;
+	int commandType = command - commandArg;
+
+	if (commandType == SPEEDDIRECTIONBITMAP) {
+		return SPEED_COALESCING_KEY;
+	} else if (commandType == STEERINGOFFSETBITMAP) {
+		return STEERING_COALESCING_KEY;
+	} else if ((commandType == MOTORDIRECTIONBITMAP) && (commandArg != STOP)) {
+		return DIRECTION_COALESCING_KEY;
+	}
+	return -1;
+}
+
+void RobotController::processCommand(const CommandEnvelope &envelope) {
+	int commandArg = envelope.command & 0xFFF;
+	int command = envelope.command - commandArg;
+
+	if ((envelope.source == COMMAND_SOURCE_NETWORK) || (envelope.source == COMMAND_SOURCE_NETWORK_UDP)) {
+		networkToQueueHistogram.record((envelope.enqueueTime - envelope.receiveTime) / 1000);
+	}
+	queueWaitHistogram.record((envelope.dequeueTime - envelope.enqueueTime) / 1000);
+
+	if (command == STEERINGOFFSETBITMAP) {
+		processSteeringControlCommand(commandArg);
+
+	} else if (command == MOTORDIRECTIONBITMAP) {
+		currentOperation = processMotionControlCommand(commandArg);
+
+	} else if (command == SPEEDDIRECTIONBITMAP) {
+		processSpeedControlCommand(commandArg);
+
+	} else {
+		return;
+	}
+
+	MotionState motion;
+	motion.speed = currentSpeed;
+	motion.steering = currentSteering;
+	motion.operation = currentOperation;
+	publishedMotion.store(motion);
+
+	leftFrontMotor->traceCommand(envelope);
+	leftRearMotor->traceCommand(envelope);
+	rightFrontMotor->traceCommand(envelope);
+	rightRearMotor->traceCommand(envelope);
+}
+
+void RobotController::printLatencyInformation(std::ostream &os) {
+	os << "Task              \t           Stage\t Samples\t     p50\t     p90\t     p99\t   p99.9\t     max\n";
+	os << std::setw(18) << myName << "\t" << std::setw(16) << "Network->Queue" << "\t" << std::setw(8)
+			<< networkToQueueHistogram.getCount() << "\t";
+	networkToQueueHistogram.printPercentiles(os);
+	os << "\n" << std::setw(18) << myName << "\t" << std::setw(16) << "Queue wait" << "\t" << std::setw(8)
+			<< queueWaitHistogram.getCount() << "\t";
+	queueWaitHistogram.printPercentiles(os);
+	os << "\n";
+
+	leftFrontMotor->printLatencyInformation(os);
+	leftRearMotor->printLatencyInformation(os);
+	rightFrontMotor->printLatencyInformation(os);
+	rightRearMotor->printLatencyInformation(os);
+}
+
+RobotController::MotionState RobotController::getMotionState() {
+	return publishedMotion.load();
 }
 
 int RobotController::processMotionControlCommand(int value) {
@@ -125,7 +223,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(F);
 		rightRearMotor->setDirection(F);
 
-		hornQueue->enqueue(HORN_MUTE_COMMAND);
+		hornQueue->enqueue(HORN_MUTE_COMMAND, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == LEFT) {
 		leftFrontMotor->setDirection(R);
@@ -133,7 +231,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(F);
 		rightRearMotor->setDirection(F);
 
-		hornQueue->enqueue(HORN_MUTE_COMMAND);
+		hornQueue->enqueue(HORN_MUTE_COMMAND, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == RIGHT) {
 		leftFrontMotor->setDirection(F);
@@ -141,7 +239,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(R);
 		rightRearMotor->setDirection(R);
 
-		hornQueue->enqueue(HORN_MUTE_COMMAND);
+		hornQueue->enqueue(HORN_MUTE_COMMAND, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == BACKWARD) {
 		leftFrontMotor->setDirection(R);
@@ -149,7 +247,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(R);
 		rightRearMotor->setDirection(R);
 
-		hornQueue->enqueue(hornCommand);
+		hornQueue->enqueue(hornCommand, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == (FORWARD + LEFT)) {
 		leftFrontMotor->setDirection(S);
@@ -157,7 +255,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(F);
 		rightRearMotor->setDirection(F);
 
-		hornQueue->enqueue(HORN_MUTE_COMMAND);
+		hornQueue->enqueue(HORN_MUTE_COMMAND, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == (FORWARD + RIGHT)) {
 		leftFrontMotor->setDirection(F);
@@ -165,7 +263,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(S);
 		rightRearMotor->setDirection(S);
 
-		hornQueue->enqueue(HORN_MUTE_COMMAND);
+		hornQueue->enqueue(HORN_MUTE_COMMAND, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == (BACKWARD + LEFT)) {
 		leftFrontMotor->setDirection(S);
@@ -173,7 +271,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(R);
 		rightRearMotor->setDirection(R);
 
-		hornQueue->enqueue(hornCommand);
+		hornQueue->enqueue(hornCommand, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == (BACKWARD + RIGHT)) {
 		leftFrontMotor->setDirection(R);
@@ -181,7 +279,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(S);
 		rightRearMotor->setDirection(S);
 
-		hornQueue->enqueue(hornCommand);
+		hornQueue->enqueue(hornCommand, COMMAND_SOURCE_CONTROLLER);
 
 	} else if (value == STOP) {
 		leftFrontMotor->setDirection(S);
@@ -189,7 +287,7 @@ int RobotController::processMotionControlCommand(int value) {
 		rightFrontMotor->setDirection(S);
 		rightRearMotor->setDirection(S);
 
-		hornQueue->enqueue(HORN_MUTE_COMMAND);
+		hornQueue->enqueue(HORN_MUTE_COMMAND, COMMAND_SOURCE_CONTROLLER);
 
 	}
 
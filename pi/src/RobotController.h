@@ -28,17 +28,39 @@
 #define ROBOTCONTROLLER_H
 
 #include <pthread.h>
+#include <ostream>
 #include <string>
 
 #include "CommandQueue.h"
+#include "LatencyHistogram.h"
 #include "MotorController.h"
 #include "RunnableClass.h"
+#include "SeqLockSnapshot.h"
 #include "labcfg.h"
 
 
 using namespace se3910RPi;
 
 class RobotController : public RunnableClass {
+public:
+	/**
+	 * This structure holds the motion state of the robot, which is published for other threads to read.
+	 */
+	struct MotionState {
+		/**
+		 * This is the current speed, from 0 to 1000.
+		 */
+		int speed;
+		/**
+		 * This is the current steering offset, from -100 to 100.
+		 */
+		int steering;
+		/**
+		 * This is the current operation.
+		 */
+		int operation;
+	};
+
 protected:
 	/**
 	 * This is a pointer to the queue that will be used for receiving commands.  Commands can come from the network or other portions of the robot.
@@ -88,6 +110,31 @@ protected:
 	 */
 	int currentOperation=0;
 
+	/**
+	 * This is the motion state as of the last command processed.  It is only written by the controller thread.
+	 */
+	SeqLockSnapshot<MotionState> publishedMotion;
+
+	/**
+	 * This is the time from a network command being received to it being enqueued, in microseconds.  It is only written by the
+	 * controller thread.
+	 */
+	LatencyHistogram networkToQueueHistogram;
+
+	/**
+	 * This is the time commands spend waiting in the queue, from being enqueued to being dequeued by the controller, in microseconds.
+	 * It is only written by the controller thread.
+	 */
+	LatencyHistogram queueWaitHistogram;
+
+	/**
+	 * This method will decode a single command received from the queue and pass its argument to the matching handler.
+	 * Commands that are not recognized are ignored.  Recognized commands are traced through to the motors.
+	 * @param envelope This is the envelope of the command that was dequeued.  The command has the command bitmap in the upper bits and
+	 * the argument in the lower 12 bits.
+	 */
+	void processCommand(const CommandEnvelope &envelope);
+
 	/**
 	 * This method will process a command that is related to motion control.
 	 * @param value This is the command that was received.
@@ -144,6 +191,27 @@ public:
 	 */
 	void run();
 
+	/**
+	 * This method is the command classifier for the robot controller queue.  A stop is a safety command, so it is dequeued ahead of
+	 * anything which was queued before it.  Other direction changes are motion commands, and speed and steering setpoints are routine.
+	 * @param command This is the command.
+	 * @return The priority level that the command is to be queued at.
+	 */
+	static int classifyCommand(int command);
+
+	/**
+	 * This method is the coalescer for the robot controller queue.  Speed, steering and direction commands are setpoints, where only the
+	 * latest value matters, so each has its own coalescing slot.  A stop is never coalesced.
+	 * @param command This is the command.
+	 * @return The coalescing key for the command, or -1 if it is not coalesced.
+	 */
+	static int coalescingKey(int command);
+
+	/**
+	 * This method will start the motor controllers, which are runnable objects contained within the robot controller.
+	 */
+	void startChildRunnables();
+
 	/**
 	 * this method will stop the thread and its execution, as well as the robot.
 	 */
@@ -155,6 +223,18 @@ public:
 	 *
 	 */
 	void waitForShutdown();
+
+	/**
+	 * This method will print the latency percentiles for each stage that a command passes through, from the network to the PWM write.
+	 * @param os This is the stream that the latencies are to be printed to.
+	 */
+	void printLatencyInformation(std::ostream &os);
+
+	/**
+	 * This method will return the motion state as of the last command processed.  It may be called from any thread.
+	 * @return The motion state.
+	 */
+	MotionState getMotionState();
 };
 
 #endif /* ROBOTCONTROLLER_H */
@@ -8,13 +8,19 @@
 #include "RobotStatusManager.h"
 #include "NetworkMessage.h"
 #include "NetworkCommands.h"
+#include "time_util.h"
+#include "TaskRates.h"
 
 namespace se3910RPi {
 
-	RobotStatusManager::RobotStatusManager(NetworkTransmissionManager *nti, se3910RPiHCSR04::DistanceSensor* dsi, std::string threadName, uint32_t period) : PeriodicTask(threadName, period)
+	RobotStatusManager::RobotStatusManager(NetworkTransmissionManager *nti, se3910RPiHCSR04::DistanceSensor* dsi, std::string threadName, uint32_t period,
+			NetworkManager *nmi) : PeriodicTask(threadName, period)
 	{
 		this->nti = nti;
 		this->dsi = dsi;
+		this->nmi = nmi;
+		this->legacyReportInterval = (period < ROBOT_STATUS_LEGACY_REPORT_PERIOD) ? (ROBOT_STATUS_LEGACY_REPORT_PERIOD / period) : 1;
+		this->releasesSinceLegacyReport = legacyReportInterval - 1;
 	}
 
 	RobotStatusManager::~RobotStatusManager()
@@ -22,66 +28,153 @@ namespace se3910RPi {
 
 	}
 
+	void RobotStatusManager::setTelemetrySources(RobotController *rci, LineSensor *lsi, CommandQueue *cqi[])
+	{
+		this->rci = rci;
+		this->lsi = lsi;
+		for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+			this->cqi[index] = (cqi != NULL) ? cqi[index] : NULL;
+		}
+	}
+
+	void RobotStatusManager::publishTelemetry(int currentDistance, int minDistance, int maxDistance, int aveDistance)
+	{
+		record.clear();
+		record.setSampleTime(getMonotonicTimeNs());
+		record.set(TELEMETRY_DISTANCE_CURRENT, currentDistance);
+		record.set(TELEMETRY_DISTANCE_MIN, minDistance);
+		record.set(TELEMETRY_DISTANCE_MAX, maxDistance);
+		record.set(TELEMETRY_DISTANCE_AVERAGE, aveDistance);
+		if (rci != NULL) {
+			RobotController::MotionState motion = rci->getMotionState();
+			record.set(TELEMETRY_SPEED, motion.speed);
+			record.set(TELEMETRY_STEERING, motion.steering);
+			record.set(TELEMETRY_OPERATION, motion.operation);
+		}
+		if (lsi != NULL) {
+			record.set(TELEMETRY_LINE_SENSOR, (int32_t) lsi->getState());
+		}
+		for (int index = 0; (index < NUMBER_OF_QUEUES) && (index < TELEMETRY_COMMAND_QUEUES); index++) {
+			if (cqi[index] != NULL) {
+				record.set(TELEMETRY_COMMAND_QUEUE_DEPTH + index, (int32_t) cqi[index]->getDepth());
+			}
+		}
+		record.set(TELEMETRY_TRANSMISSION_QUEUE_DEPTH, (int32_t) nti->getQueueDepth());
+		record.set(TELEMETRY_DEADLINE_MISSES, (int32_t) PeriodicTask::getTotalOverrunCount());
+		if (nmi != NULL) {
+			networkLinkStruct estimates;
+			int64_t bestRoundTrip = 0;
+			int slot = 0;
+			for (int link = 0; link < NETWORK_LINKS; link++) {
+				if (nmi->getLinkStatistics(link, estimates) && (estimates.smoothedRoundTrip > 0)) {
+					if ((bestRoundTrip == 0) || (estimates.smoothedRoundTrip < bestRoundTrip)) {
+						bestRoundTrip = estimates.smoothedRoundTrip;
+					}
+					if (slot < TELEMETRY_LINK_SLOTS) {
+						record.set(TELEMETRY_LINK_NUMBER + slot, link);
+						record.set(TELEMETRY_LINK_ROUND_TRIP_US + slot, (int32_t) (estimates.smoothedRoundTrip / 1000));
+						record.set(TELEMETRY_LINK_ONE_WAY_US + slot, (int32_t) (estimates.smoothedOneWay / 1000));
+						slot++;
+					}
+				}
+			}
+			if (bestRoundTrip > 0) {
+				record.set(TELEMETRY_ROUND_TRIP_US, (int32_t) (bestRoundTrip / 1000));
+			}
+		}
+		nti->publishTelemetry(record);
+	}
+
 	void RobotStatusManager::taskMethod()
 	{
 		/**
-		 * 1.0 Start by reading the current, max, min, and average distance from the distance sensor.  Then reset the sensor.
+		 * 1.0 Start by reading the current, max, min, and average distance from the distance sensor.  The ranges are reset at each legacy
+		 * report, so that they cover the same span as they always have.
 		 */
+		bool legacyReportDue = (++releasesSinceLegacyReport >= legacyReportInterval);
 		int currentDistance = dsi->getCurrentDistance();
 		int maxDistance = dsi->getMaxDistance();
 		int minDistance = dsi->getMinDistance();
 		int aveDistance = dsi->getAverageDistance();
-		dsi->resetDistanceRanges();
-
-		/**
-		 * 2.0 Now populate an instance of the network message structure for current distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
-		 */
-		networkMessageStruct nms;
-		nms.messageDestination=1;
-		nms.message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_CURRENTREADINGBITMAP | currentDistance;
-		nms.xorChecksum = nms.message ^ nms.messageDestination;
-
-		/**
-		 * 3.0 Enqueue the item to be sent.
-		 */
-		nti->enqueueMessage(nms);
-
-
-		/**
-		 * 4.0 Now populate an instance of the network message structure for max distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
-		 */
-		nms.messageDestination=1;
-		nms.message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_MAXREADINGBITMAP | maxDistance;
-		nms.xorChecksum = nms.message ^ nms.messageDestination;
-
-		/**
-		 * 5.0 Enqueue the item to be sent.
-		 */
-		nti->enqueueMessage(nms);
-
-		/**
-		 * 6.0 Now populate an instance of the network message structure for max distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
-		 */
-		nms.messageDestination=1;
-		nms.message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_MINREADINGBITMAP | minDistance;
-		nms.xorChecksum = nms.message ^ nms.messageDestination;
-
-		/**
-		 * 7.0 Enqueue the item to be sent.
-		 */
-		nti->enqueueMessage(nms);
+		if (legacyReportDue) {
+			releasesSinceLegacyReport = 0;
+			dsi->resetDistanceRanges();
+		}
 
 		/**
-		 * 8.0 Now populate an instance of the network message structure for max distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
+		 * 1.1 Fill the telemetry record with the whole state of the robot, and publish it.  Each channel is sampled once here, and the
+		 * network manager sends each client the channels it has subscribed to as they fall due.  Only the latest record is sent, so it is
+		 * never queued behind older ones.
 		 */
-		nms.messageDestination=1;
-		nms.message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_AVEREADINGBITMAP | aveDistance;
-		nms.xorChecksum = nms.message ^ nms.messageDestination;
+		if ((nmi == NULL) || (nmi->getClientCount(FRAME_VERSION_CRC32C) > 0)) {
+			publishTelemetry(currentDistance, minDistance, maxDistance, aveDistance);
+		}
 
 		/**
-		 * 9.0 Enqueue the item to be sent.
+		 * 1.2 The separate distance reports below are only needed by clients which still use legacy frames, since the record holds the
+		 * same readings.
 		 */
-		nti->enqueueMessage(nms);
+		if ((legacyReportDue) && ((nmi == NULL) || (nmi->getClientCount(FRAME_VERSION_LEGACY) > 0))) {
+			/**
+			 * 2.0 Reserve a slot on the transmission queue and populate it in place for current distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
+			 */
+			networkMessageStruct *nms = nti->reserveMessage();
+			if (nms != NULL) {
+				nms->messageDestination=1;
+				nms->message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_CURRENTREADINGBITMAP | currentDistance;
+				nms->xorChecksum = nms->message ^ nms->messageDestination;
+
+				/**
+				 * 3.0 Commit the slot so that it is sent.
+				 */
+				nti->commitMessage(nms);
+			}
+
+			/**
+			 * 4.0 Now reserve and populate a slot for max distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
+			 */
+			nms = nti->reserveMessage();
+			if (nms != NULL) {
+				nms->messageDestination=1;
+				nms->message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_MAXREADINGBITMAP | maxDistance;
+				nms->xorChecksum = nms->message ^ nms->messageDestination;
+
+				/**
+				 * 5.0 Commit the slot so that it is sent.
+				 */
+				nti->commitMessage(nms);
+			}
+
+			/**
+			 * 6.0 Now reserve and populate a slot for min distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
+			 */
+			nms = nti->reserveMessage();
+			if (nms != NULL) {
+				nms->messageDestination=1;
+				nms->message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_MINREADINGBITMAP | minDistance;
+				nms->xorChecksum = nms->message ^ nms->messageDestination;
+
+				/**
+				 * 7.0 Commit the slot so that it is sent.
+				 */
+				nti->commitMessage(nms);
+			}
+
+			/**
+			 * 8.0 Now reserve and populate a slot for average distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
+			 */
+			nms = nti->reserveMessage();
+			if (nms != NULL) {
+				nms->messageDestination=1;
+				nms->message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_AVEREADINGBITMAP | aveDistance;
+				nms->xorChecksum = nms->message ^ nms->messageDestination;
+
+				/**
+				 * 9.0 Commit the slot so that it is sent.
+				 */
+				nti->commitMessage(nms);
+			}
+		}
 	}
 
 
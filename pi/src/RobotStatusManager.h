@@ -30,6 +30,10 @@
 #include "CommandQueue.h"
 #include "DistanceSensor.h"
 #include "NetworkTransmissionManager.h"
+#include "NetworkManager.h"
+#include "RobotController.h"
+#include "LineSensor.h"
+#include "TelemetryRecord.h"
 
 namespace se3910RPi {
 
@@ -45,8 +49,53 @@ private:
 	 */
 	NetworkTransmissionManager *nti;
 
+	/**
+	 * This is the network manager whose link latency estimates are reported.  It may be NULL, in which case they are not reported.
+	 */
+	NetworkManager *nmi;
+
+	/**
+	 * This is the robot controller whose motion state is reported.  It may be NULL.
+	 */
+	RobotController *rci = NULL;
+
+	/**
+	 * This is the line sensor whose state is reported.  It may be NULL.
+	 */
+	LineSensor *lsi = NULL;
+
+	/**
+	 * These are the command queues whose depths are reported.  Any may be NULL.
+	 */
+	CommandQueue *cqi[NUMBER_OF_QUEUES] = {};
+
+	/**
+	 * This is the telemetry record, which is filled once per period.
+	 */
+	TelemetryRecord record;
+
+	/**
+	 * This is the number of releases between legacy reports.
+	 */
+	uint32_t legacyReportInterval;
+
+	/**
+	 * This is the number of releases since the last legacy report.
+	 */
+	uint32_t releasesSinceLegacyReport;
+
+	/**
+	 * This method will fill the telemetry record with the whole state of the robot, and publish it.
+	 * @param currentDistance This is the current distance reading.
+	 * @param minDistance This is the smallest distance reading since the ranges were reset.
+	 * @param maxDistance This is the largest distance reading since the ranges were reset.
+	 * @param aveDistance This is the average distance reading since the ranges were reset.
+	 */
+	void publishTelemetry(int currentDistance, int minDistance, int maxDistance, int aveDistance);
+
 public:
-	RobotStatusManager(NetworkTransmissionManager *nti, se3910RPiHCSR04::DistanceSensor* dsi, std::string threadName, uint32_t period);
+	RobotStatusManager(NetworkTransmissionManager *nti, se3910RPiHCSR04::DistanceSensor* dsi, std::string threadName, uint32_t period,
+			NetworkManager *nmi = NULL);
 
 	/**
 	 * This is the default destructor which will clean up from the distance sensor.
@@ -58,6 +107,15 @@ public:
 	 * units of time.
 	 */
 	virtual void taskMethod();
+
+	/**
+	 * This method will give the status manager the rest of the robot's state to report in its telemetry record.  It must be called
+	 * before the task is started.
+	 * @param rci This is the robot controller whose motion state is reported.  It may be NULL.
+	 * @param lsi This is the line sensor whose state is reported.  It may be NULL.
+	 * @param cqi These are the command queues whose depths are reported.  It may be NULL.
+	 */
+	void setTelemetrySources(RobotController *rci, LineSensor *lsi, CommandQueue *cqi[]);
 };
 
 }
@@ -28,6 +28,9 @@
  */
 
 #include "RunnableClass.h"
+#include "LatencyHistogram.h"
+#include "RealTimeMemory.h"
+#include "Clock.h"
 #include <thread>
 #include <string>
 #include <iostream>
@@ -35,6 +38,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <sched.h>
+#include <sstream>
 
 /*
  * This is a file scopes variable which holds a list of the threads that are running.
@@ -73,7 +78,7 @@ void RunnableClass::printThreads() {
 	std::cout
 			<< "===============================================================================================\nThread Diagnostic Information:\n";
 	// Print the header out
-	std::cout << "Thread\tTask              \tPrio.\tperiod(us)\tLast Execution(us)\tWCET(us)\tLast Wall Time(us)\tWCWT(us)\tCPU Usage\n";
+	std::cout << "Thread\tTask              \tPrio.\tperiod(us)\tLast Execution(us)\tWCET(us)\tLast Wall Time(us)\tWCWT(us)\tCPU Usage\tJitter(us)\tWC Jitter(us)\tDrift(us)\tOverruns\tSkipped\tMode\n";
 	double totalCPUUsage = 0.0;
 	for (std::list<RunnableClass*>::iterator it = runningThreads.begin();
 			it != runningThreads.end(); it++) {
@@ -82,10 +87,73 @@ void RunnableClass::printThreads() {
 		totalCPUUsage += rc->getCPUUsageInfo();
 	}
 	std::cout<< "Total CPU Usage: "<< std::fixed << std::setprecision(3) << totalCPUUsage << "\n";
+	std::cout<< "-----------------------------------------------------------------------------------------------\nLatency Percentiles (us):\n";
+	std::cout << "Thread\tTask              \tMetric          \t     p50\t     p90\t     p99\t   p99.9\t     max\n";
+	for (std::list<RunnableClass*>::iterator it = runningThreads.begin();
+			it != runningThreads.end(); it++) {
+		RunnableClass *rc = *it;
+		rc->printHistogramInformation();
+	}
+	std::cout<< "-----------------------------------------------------------------------------------------------\nCPU Affinity:\n";
+	std::cout << "Thread\tTask              \tRequested CPUs\tEffective CPUs\n";
+	for (std::list<RunnableClass*>::iterator it = runningThreads.begin();
+			it != runningThreads.end(); it++) {
+		RunnableClass *rc = *it;
+		std::cout << rc->myOSThreadID << "\t" << std::setw(18) << rc->myName
+				<< "\t" << std::setw(14) << formatCPUMask(rc->getAffinity())
+				<< "\t" << std::setw(14) << formatCPUMask(rc->getEffectiveAffinity()) << "\n";
+	}
 	std::cout<< "===============================================================================================\n";
 
 }
 
+/**
+ * This method will write the latency histograms of all running threads to the given stream in CSV format.
+ * @param os This is the stream that the CSV data is to be written to.
+ */
+void RunnableClass::writeThreadHistogramsCSV(std::ostream &os) {
+	LatencyHistogram::writeCSVHeader(os);
+	for (std::list<RunnableClass*>::iterator it = runningThreads.begin();
+			it != runningThreads.end(); it++) {
+		RunnableClass *rc = *it;
+		rc->writeHistogramCSV(os);
+	}
+}
+
+/**
+ * This method will convert a CPU mask into a human readable list of CPUs, such as "0-1,3".
+ * @param mask This is the CPU mask, where bit n selects CPU n.
+ * @return The list of CPUs will be returned.  A mask of 0 is shown as "any".
+ */
+std::string RunnableClass::formatCPUMask(uint32_t mask) {
+	if (mask == 0) {
+		return "any";
+	}
+
+	/**
+	 * Walk the mask, printing each run of consecutive CPUs as a range.
+	 */
+	std::ostringstream cpus;
+	int cpu = 0;
+	while (cpu < 32) {
+		if ((mask & (1U << cpu)) != 0) {
+			int first = cpu;
+			while ((cpu < 31) && ((mask & (1U << (cpu + 1))) != 0)) {
+				cpu++;
+			}
+			if (cpus.tellp() > 0) {
+				cpus << ",";
+			}
+			cpus << first;
+			if (cpu != first) {
+				cpus << "-" << cpu;
+			}
+		}
+		cpu++;
+	}
+	return cpus.str();
+}
+
 /**
 	 * This method will obtain the thread ID for this runnable.
 	 * @return The OS Thread ID.
@@ -124,6 +192,21 @@ void RunnableClass::printInformation() {
 			<< std::setw(5) << getPriority() << "\n ";
 }
 
+/**
+ * This method will print out the latency percentiles for the given thread.  Threads without latency histograms print nothing.
+ */
+void RunnableClass::printHistogramInformation() {
+	// A simple runnable class does not currently have any latency histograms.
+}
+
+/**
+ * This method will write the latency histograms for the given thread in CSV format.  Threads without latency histograms write nothing.
+ * @param os This is the stream that the CSV data is to be written to.
+ */
+void RunnableClass::writeHistogramCSV(std::ostream &os) {
+	// A simple runnable class does not currently have any latency histograms.
+}
+
 /*
  * This is the default destructor for the class.  It must properly clean up the instantiated thread.
  */
@@ -142,6 +225,7 @@ RunnableClass::~RunnableClass() {
 void RunnableClass::invokeRunMethod() {
 	// Setup the operating thread to be a real time thread.
 	struct sched_param p;
+	bool realTime = false;
 
 	runStarted = true;
 	runCompleted = false;
@@ -156,18 +240,40 @@ void RunnableClass::invokeRunMethod() {
 
 		if (sched_setscheduler(0, SCHED_FIFO, &p) != 0) {
 			printf("Failed to set the scheduler\n");
+		} else {
+			realTime = true;
 		}
 	}
 
 	// Obtain the thread id by making a system call.
 	myOSThreadID = syscall(SYS_gettid);
 
+	// Pin the thread to its CPUs before it starts running the real time work.
+	applyAffinity(0);
+
+	// In the real time memory mode, make the stack resident and track the heap allocations of real time threads.
+	if (RealTimeMemory::isEnabled()) {
+		RealTimeMemory::prefaultStack();
+		if (realTime) {
+			RealTimeMemory::registerRealTimeThread(myName, myOSThreadID);
+		}
+	}
+
+	// A thread which takes part in the clock waits for its turn before running.
+	if (isClockParticipant()) {
+		Clock::getClock()->attachParticipant(this);
+	}
+
 	// Now invoke the run method,
 	this->run();
 
 	// When run returns, indicate that the run is completed.
 	runCompleted = true;
 	runStarted = false;
+
+	if (isClockParticipant()) {
+		Clock::getClock()->detachParticipant(this);
+	}
 }
 
 /**
@@ -177,7 +283,13 @@ void RunnableClass::invokeRunMethod() {
 void RunnableClass::start() {
 	keepGoing = true;
 	startChildRunnables();
-	myThread = new std::thread(&RunnableClass::invokeRunMethod, this);
+	if (startOnExternalExecutor() == false) {
+		// Register with the clock from the starting thread, so that the order of the participants does not depend on thread start up.
+		if (isClockParticipant()) {
+			Clock::getClock()->registerParticipant(this);
+		}
+		myThread = new std::thread(&RunnableClass::invokeRunMethod, this);
+	}
 }
 
 /**
@@ -189,6 +301,105 @@ void RunnableClass::start(int priority) {
 	this->start();
 }
 
+/**
+ * This virtual method is the start method.  The purpose of this method is to instantiate a new thread and invoke the run method.
+ * @param priority This is the priority for the task.  It must be between 0 and 99, with 99 being the highest priority.
+ * @param cpuMask This is the set of CPUs that the task is to run on, where bit n selects CPU n.  0 leaves the affinity alone.
+ */
+void RunnableClass::start(int priority, uint32_t cpuMask) {
+	this->cpuMask = cpuMask;
+	this->start(priority);
+}
+
+/**
+ * This method will set the set of CPUs that the given task is to run on.  If the task is already running, the affinity is changed right away.
+ * @param cpuMask This is the set of CPUs, where bit n selects CPU n.  0 leaves the affinity alone.
+ */
+void RunnableClass::setAffinity(uint32_t cpuMask) {
+	this->cpuMask = cpuMask;
+	if ((myThread != NULL) && (runStarted == true) && (myOSThreadID != 0)) {
+		applyAffinity(myOSThreadID);
+	}
+}
+
+/**
+ * This method will obtain the set of CPUs that has been requested for this runnable class.
+ * @return The requested CPU mask will be returned.  0 indicates that no affinity was requested.
+ */
+uint32_t RunnableClass::getAffinity() {
+	return cpuMask;
+}
+
+/**
+ * This method will obtain the set of CPUs that the thread running this runnable class is actually allowed to run on, as reported by the OS.
+ * @return The effective CPU mask will be returned.  0 is returned if the thread has not been started or the OS cannot be queried.
+ */
+uint32_t RunnableClass::getEffectiveAffinity() {
+	cpu_set_t cpus;
+	uint32_t mask = 0;
+
+	if (myOSThreadID == 0) {
+		return 0;
+	}
+
+	CPU_ZERO(&cpus);
+	if (sched_getaffinity(myOSThreadID, sizeof(cpus), &cpus) != 0) {
+		return 0;
+	}
+	for (int cpu = 0; cpu < 32; cpu++) {
+		if (CPU_ISSET(cpu, &cpus)) {
+			mask |= (1U << cpu);
+		}
+	}
+	return mask;
+}
+
+/**
+ * This method will pin the given thread to the CPUs in the affinity mask.  It does nothing if the mask is 0.
+ * @param tid This is the OS thread id of the thread that is to be pinned.  0 selects the calling thread.
+ */
+void RunnableClass::applyAffinity(pid_t tid) {
+	cpu_set_t cpus;
+
+	if (cpuMask == 0) {
+		return;
+	}
+
+	CPU_ZERO(&cpus);
+	for (int cpu = 0; cpu < 32; cpu++) {
+		if ((cpuMask & (1U << cpu)) != 0) {
+			CPU_SET(cpu, &cpus);
+		}
+	}
+
+	if (sched_setaffinity(tid, sizeof(cpus), &cpus) != 0) {
+		printf("Failed to set the affinity of %s to CPUs %s\n", myName.c_str(), formatCPUMask(cpuMask).c_str());
+	}
+}
+
+/**
+ * This method allows a derived class to run on something other than a thread of its own, such as a cyclic executive.  It is invoked by start.
+ * @return true if the derived class has arranged for its own execution and no thread is to be started.  False otherwise.
+ */
+bool RunnableClass::startOnExternalExecutor() {
+	/**
+	 * By default, every runnable class gets its own thread.
+	 */
+	return false;
+}
+
+/**
+ * This method will determine whether the thread of this runnable takes part in the clock.  Threads which take part are tracked by a
+ * simulated clock, so that it only advances when they are asleep.  Threads which wait on anything other than the clock must not take part.
+ * @return true if the thread takes part in the clock.  False otherwise.
+ */
+bool RunnableClass::isClockParticipant() {
+	/**
+	 * By default, a runnable class may block on anything, so it does not take part.
+	 */
+	return false;
+}
+
 /**
  * This method will start up any runnable objects which are contained within a class that implements the RUnnable interface.
  * If there are no other objects that are runnable, there is no need to override this method.  However, if a child class
@@ -33,12 +33,19 @@
 #include <thread>
 #include <string>
 #include <list>
+#include <ostream>
+#include <stdint.h>
 #include <sys/types.h>
 
 /**
  * This is the runnable class, which mimics the runnable interface from Java.  It is a virtual class which should not directly be instantiated.
  */
 class RunnableClass {
+	/**
+	 * The schedulability analyzer walks the list of threads to find the task set.
+	 */
+	friend class SchedulabilityAnalyzer;
+
 protected:
 	/**
 	 * This is a list of all of the running threads which have been started by this set of libraries.
@@ -81,18 +88,57 @@ protected:
 	 */
 	bool runStarted = false;
 
+	/**
+	 * This is the set of CPUs that the thread is to run on.  Bit n of the mask selects CPU n.  A value of 0 indicates no change in the
+	 * affinity, so the thread runs wherever the thread which started it was allowed to run.
+	 */
+	uint32_t cpuMask = 0;
+
 private:
 	/**
 	 * This private method initializes the runnable class.  It is actually the method invoked when the thread starts, and it will ultimately call the Run method.
 	 */
 	virtual void invokeRunMethod() final;
 
+	/**
+	 * This method will pin the given thread to the CPUs in the affinity mask.  It does nothing if the mask is 0.
+	 * @param tid This is the OS thread id of the thread that is to be pinned.  0 selects the calling thread.
+	 */
+	void applyAffinity(pid_t tid);
+
+protected:
+	/**
+	 * This method allows a derived class to run on something other than a thread of its own, such as a cyclic executive.  It is invoked by start.
+	 * @return true if the derived class has arranged for its own execution and no thread is to be started.  False otherwise.
+	 */
+	virtual bool startOnExternalExecutor();
+
+	/**
+	 * This method will determine whether the thread of this runnable takes part in the clock.  Threads which take part are tracked by a
+	 * simulated clock, so that it only advances when they are asleep.  Threads which wait on anything other than the clock must not take part.
+	 * @return true if the thread takes part in the clock.  False otherwise.
+	 */
+	virtual bool isClockParticipant();
+
 public:
 	/**
 	 * This method will print out to the console each of the running threads and their thread ID's.
 	 */
 	static void printThreads();
 
+	/**
+	 * This method will write the latency histograms of all running threads to the given stream in CSV format.
+	 * @param os This is the stream that the CSV data is to be written to.
+	 */
+	static void writeThreadHistogramsCSV(std::ostream &os);
+
+	/**
+	 * This method will convert a CPU mask into a human readable list of CPUs, such as "0-1,3".
+	 * @param mask This is the CPU mask, where bit n selects CPU n.
+	 * @return The list of CPUs will be returned.  A mask of 0 is shown as "any".
+	 */
+	static std::string formatCPUMask(uint32_t mask);
+
 	/**
 	 * This method will reset the thread information which is dynamic in nature and changes as the robot runs.
 	 * This predominantly impacts threads which are not part of the Runnable class.
@@ -109,6 +155,17 @@ public:
 	 */
 	virtual void printInformation();
 
+	/**
+	 * This method will print out the latency percentiles for the given thread.  Threads without latency histograms print nothing.
+	 */
+	virtual void printHistogramInformation();
+
+	/**
+	 * This method will write the latency histograms for the given thread in CSV format.  Threads without latency histograms write nothing.
+	 * @param os This is the stream that the CSV data is to be written to.
+	 */
+	virtual void writeHistogramCSV(std::ostream &os);
+
 	/**
 	 * This method will return the CPU usage for the given task.  The usage will be as a percentage value.
 	 */
@@ -143,6 +200,31 @@ public:
 	 */
 	virtual void start(int priority) final;
 
+	/**
+	 * This virtual method is the start method.  The purpose of this method is to instantiate a new thread and invoke the run method.
+	 * @param priority This is the priority for the task.  It must be between 0 and 99, with 99 being the highest priority.
+	 * @param cpuMask This is the set of CPUs that the task is to run on, where bit n selects CPU n.  0 leaves the affinity alone.
+	 */
+	virtual void start(int priority, uint32_t cpuMask) final;
+
+	/**
+	 * This method will set the set of CPUs that the given task is to run on.  If the task is already running, the affinity is changed right away.
+	 * @param cpuMask This is the set of CPUs, where bit n selects CPU n.  0 leaves the affinity alone.
+	 */
+	virtual void setAffinity(uint32_t cpuMask) final;
+
+	/**
+	 * This method will obtain the set of CPUs that has been requested for this runnable class.
+	 * @return The requested CPU mask will be returned.  0 indicates that no affinity was requested.
+	 */
+	virtual uint32_t getAffinity() final;
+
+	/**
+	 * This method will obtain the set of CPUs that the thread running this runnable class is actually allowed to run on, as reported by the OS.
+	 * @return The effective CPU mask will be returned.  0 is returned if the thread has not been started or the OS cannot be queried.
+	 */
+	virtual uint32_t getEffectiveAffinity() final;
+
 
 	/**
 	 * This method will set the priority for the given task, using the real time FIFO scheduler as well as setting the priority.
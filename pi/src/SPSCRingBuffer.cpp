@@ -0,0 +1,98 @@
+/**
+ * @file SPSCRingBuffer.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the bounded, lock-free, single producer, single consumer ring.
+ */
+
+#include "SPSCRingBuffer.h"
+
+/**
+ * This is the constructor for the class.
+ * @param requestedCapacity This is the requested number of slots.  It is rounded up to a power of two.
+ */
+SPSCRingBuffer::SPSCRingBuffer(uint32_t requestedCapacity) : RingBuffer(requestedCapacity), tail(0), cachedHead(0), head(0), cachedTail(0) {
+	slots = new CommandEnvelope[capacity]();
+}
+
+/**
+ * This is the destructor for the class.  It releases the slots.
+ */
+SPSCRingBuffer::~SPSCRingBuffer() {
+	delete[] slots;
+}
+
+/**
+ * This method will add a command to the ring.  It may only be called from the producer thread.
+ * @param value This is the command to be added.
+ * @return true if the command was added.  False if the ring was full.
+ */
+bool SPSCRingBuffer::push(const CommandEnvelope &value) {
+	uint32_t position = tail.load(std::memory_order_relaxed);
+
+	if (position - cachedHead >= capacity) {
+		// The ring looks full.  Refresh the consumer's position before giving up.
+		cachedHead = head.load(std::memory_order_acquire);
+		if (position - cachedHead >= capacity) {
+			return false;
+		}
+	}
+
+	slots[position & mask] = value;
+	tail.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+ * This method will remove the oldest command from the ring.  It may only be called from the consumer thread.
+ * @param value This is the location into which the command is written.  It is not modified if nothing was removed.
+ * @return true if a command was removed.  False if the ring was empty.
+ */
+bool SPSCRingBuffer::pop(CommandEnvelope &value) {
+	uint32_t position = head.load(std::memory_order_relaxed);
+
+	if (position == cachedTail) {
+		// The ring looks empty.  Refresh the producer's position before giving up.
+		cachedTail = tail.load(std::memory_order_acquire);
+		if (position == cachedTail) {
+			return false;
+		}
+	}
+
+	value = slots[position & mask];
+	head.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+ * This method will return the number of commands in the ring.
+ * @return The number of commands in the ring.
+ */
+uint32_t SPSCRingBuffer::getOccupancy() {
+	uint32_t dequeued = head.load(std::memory_order_acquire);
+	uint32_t enqueued = tail.load(std::memory_order_acquire);
+	uint32_t occupancy = enqueued - dequeued;
+
+	if (occupancy > capacity) {
+		occupancy = capacity;
+	}
+	return occupancy;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file SPSCRingBuffer.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines a bounded, lock-free ring which exactly one thread may push to and exactly one thread may pop from.
+ * With a single producer no compare and swap is needed.  Each side publishes its own position with a release store and keeps a private
+ * copy of the other side's position, which it only refreshes when the ring looks full or empty.  The producer's and the consumer's
+ * data are kept on separate cache lines.
+ */
+#ifndef SPSCRINGBUFFER_H_
+#define SPSCRINGBUFFER_H_
+
+#include "RingBuffer.h"
+#include "QueueCfg.h"
+#include <atomic>
+
+class SPSCRingBuffer : public RingBuffer {
+private:
+	/**
+	 * This is the array of slots.  It is allocated once, when the ring is constructed.
+	 */
+	CommandEnvelope *slots;
+
+	/**
+	 * This keeps the producer's data off of the cache line holding the slot pointer and capacity, which both threads read.
+	 */
+	char padding0[CACHE_LINE_SIZE];
+
+	/**
+	 * This is the next position the producer will write.  Only the producer writes it.
+	 */
+	std::atomic<uint32_t> tail;
+
+	/**
+	 * This is the producer's copy of the consumer's position.
+	 */
+	uint32_t cachedHead;
+
+	/**
+	 * This keeps the producer's and the consumer's data on separate cache lines.
+	 */
+	char padding1[CACHE_LINE_SIZE];
+
+	/**
+	 * This is the next position the consumer will read.  Only the consumer writes it.
+	 */
+	std::atomic<uint32_t> head;
+
+	/**
+	 * This is the consumer's copy of the producer's position.
+	 */
+	uint32_t cachedTail;
+
+	/**
+	 * This keeps the consumer's data off of the cache line of whatever follows the ring in memory.
+	 */
+	char padding2[CACHE_LINE_SIZE];
+
+public:
+	/**
+	 * This is the constructor for the class.
+	 * @param requestedCapacity This is the requested number of slots.  It is rounded up to a power of two.
+	 */
+	SPSCRingBuffer(uint32_t requestedCapacity);
+
+	/**
+	 * This is the destructor for the class.  It releases the slots.
+	 */
+	virtual ~SPSCRingBuffer();
+
+	/**
+	 * This method will add a command to the ring.  It may only be called from the producer thread.
+	 * @param value This is the command to be added.
+	 * @return true if the command was added.  False if the ring was full.
+	 */
+	virtual bool push(const CommandEnvelope &value);
+
+	/**
+	 * This method will remove the oldest command from the ring.  It may only be called from the consumer thread.
+	 * @param value This is the location into which the command is written.  It is not modified if nothing was removed.
+	 * @return true if a command was removed.  False if the ring was empty.
+	 */
+	virtual bool pop(CommandEnvelope &value);
+
+	/**
+	 * This method will return the number of commands in the ring.
+	 * @return The number of commands in the ring.
+	 */
+	virtual uint32_t getOccupancy();
+};
+
+#endif /* SPSCRINGBUFFER_H_ */
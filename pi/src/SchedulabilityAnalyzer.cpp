@@ -0,0 +1,253 @@
+/**
+ * @file SchedulabilityAnalyzer.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the schedulability analyzer.  The analysis assumes that each task's deadline is the end of its period, that tasks
+ *      on the same set of CPUs behave as if they shared a single CPU, and that tasks do not block one another.  Tasks which have not yet
+ *      run have a measured worst case execution time of 0, so the analysis should be run once the robot has been exercised.
+ */
+
+#include "SchedulabilityAnalyzer.h"
+#include "CyclicExecutive.h"
+#include "TaskRates.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <list>
+
+/**
+ * This method will build the list of periodic tasks that are to be analyzed from the running threads.
+ * @param tasks This is the list that the tasks are added to.
+ */
+void SchedulabilityAnalyzer::collectTasks(std::vector<AnalyzedTask> &tasks) {
+	for (std::list<RunnableClass*>::iterator it = RunnableClass::runningThreads.begin();
+			it != RunnableClass::runningThreads.end(); it++) {
+		PeriodicTask *pt = dynamic_cast<PeriodicTask*>(*it);
+		if (pt == NULL) {
+			continue;
+		}
+
+		AnalyzedTask task;
+		PeriodicTask::TaskStatistics statistics = pt->getStatistics();
+		CyclicExecutive *executive = pt->getExecutive();
+
+		task.tid = pt->getThreadID();
+		task.name = pt->myName;
+		task.period = pt->getTaskPeriod();
+		task.wcet = statistics.worstCaseExecutionTime;
+		task.multiplexed = (executive != NULL);
+		task.suggestedPriority = 0;
+
+		/**
+		 * A multiplexed task runs on the executive's thread, so it has the executive's priority and CPUs.
+		 */
+		RunnableClass *thread = (executive != NULL) ? (RunnableClass*) executive : (RunnableClass*) pt;
+		task.priority = thread->getPriority();
+		task.cpus = thread->getEffectiveAffinity();
+		if (task.cpus == 0) {
+			task.cpus = thread->getAffinity();
+		}
+
+		tasks.push_back(task);
+	}
+}
+
+/**
+ * This method will determine whether one task is listed before another.  Tasks are listed from the highest to the lowest priority, and
+ * tasks with the same priority are listed from the shortest to the longest period.
+ * @param a This is the first task.
+ * @param b This is the second task.
+ * @return true if the first task is to be listed before the second.
+ */
+bool SchedulabilityAnalyzer::hasHigherPriority(const AnalyzedTask &a, const AnalyzedTask &b) {
+	return (a.priority > b.priority) || ((a.priority == b.priority) && (a.period < b.period));
+}
+
+/**
+ * This method will assign a rate monotonic priority to each task.  Shorter periods get higher priorities, and equal periods share a priority.
+ * @param tasks This is the list of tasks.
+ */
+void SchedulabilityAnalyzer::suggestPriorities(std::vector<AnalyzedTask> &tasks) {
+	std::vector<long> periods;
+	for (uint32_t index = 0; index < tasks.size(); index++) {
+		periods.push_back(tasks[index].period);
+	}
+	std::sort(periods.begin(), periods.end());
+	periods.erase(std::unique(periods.begin(), periods.end()), periods.end());
+
+	for (uint32_t index = 0; index < tasks.size(); index++) {
+		long rank = std::lower_bound(periods.begin(), periods.end(), tasks[index].period) - periods.begin();
+		int priority = RATE_MONOTONIC_HIGHEST_PRIORITY - (int) rank;
+		if (priority < RATE_MONOTONIC_LOWEST_PRIORITY) {
+			priority = RATE_MONOTONIC_LOWEST_PRIORITY;
+		}
+		tasks[index].suggestedPriority = priority;
+	}
+}
+
+/**
+ * This method will compute the worst case response time of a task using response time analysis.  Every other task on the same CPUs with
+ * an equal or higher priority is counted as interference.
+ * @param tasks This is the list of tasks which run on the same CPUs as the task.
+ * @param index This is the index of the task that is to be analyzed.
+ * @param useSuggested If true, the suggested priorities are used.  Otherwise the priorities that the tasks run at are used.
+ * @return The worst case response time in microseconds will be returned, or -1 if it exceeds the period of the task.
+ */
+long SchedulabilityAnalyzer::responseTime(const std::vector<AnalyzedTask> &tasks, uint32_t index, bool useSuggested) {
+	const AnalyzedTask &task = tasks[index];
+	int priority = useSuggested ? task.suggestedPriority : task.priority;
+	long response = task.wcet;
+
+	/**
+	 * Iterate R = C + sum(ceil(R / Tj) * Cj) over the interfering tasks until it stops changing or passes the deadline.
+	 */
+	while (true) {
+		long next = task.wcet;
+		for (uint32_t other = 0; other < tasks.size(); other++) {
+			int otherPriority = useSuggested ? tasks[other].suggestedPriority : tasks[other].priority;
+			if ((other != index) && (otherPriority >= priority)) {
+				next += ((response + tasks[other].period - 1) / tasks[other].period) * tasks[other].wcet;
+			}
+		}
+
+		if (next > task.period) {
+			return -1;
+		}
+		if (next == response) {
+			return response;
+		}
+		response = next;
+	}
+}
+
+/**
+ * This method will analyze the running periodic tasks and print the results to the console.
+ */
+void SchedulabilityAnalyzer::analyze() {
+	std::vector<AnalyzedTask> tasks;
+	collectTasks(tasks);
+	suggestPriorities(tasks);
+
+	/**
+	 * 1.0 Determine the distinct sets of CPUs that the tasks run on.  Each set is analyzed on its own.
+	 */
+	std::vector<uint32_t> cpuSets;
+	for (uint32_t index = 0; index < tasks.size(); index++) {
+		if (std::find(cpuSets.begin(), cpuSets.end(), tasks[index].cpus) == cpuSets.end()) {
+			cpuSets.push_back(tasks[index].cpus);
+		}
+	}
+	std::sort(cpuSets.begin(), cpuSets.end());
+
+	std::cout
+			<< "===============================================================================================\nSchedulability Analysis:\n";
+
+	for (uint32_t set = 0; set < cpuSets.size(); set++) {
+		/**
+		 * 2.0 Gather the tasks on this set of CPUs, ordered from the highest to the lowest priority.
+		 */
+		std::vector<AnalyzedTask> group;
+		for (uint32_t index = 0; index < tasks.size(); index++) {
+			if (tasks[index].cpus == cpuSets[set]) {
+				group.push_back(tasks[index]);
+			}
+		}
+		std::stable_sort(group.begin(), group.end(), hasHigherPriority);
+
+		/**
+		 * 3.0 Compute the utilization and compare it with the Liu and Layland bound for rate monotonic scheduling.
+		 */
+		double utilization = 0.0;
+		int lowestPriority = group[0].priority;
+		for (uint32_t index = 0; index < group.size(); index++) {
+			utilization += (double) group[index].wcet / (double) group[index].period;
+			if (group[index].priority < lowestPriority) {
+				lowestPriority = group[index].priority;
+			}
+		}
+		double taskCount = (double) group.size();
+		double liuLaylandBound = taskCount * (pow(2.0, 1.0 / taskCount) - 1.0);
+
+		std::cout << "-----------------------------------------------------------------------------------------------\n";
+		std::cout << "CPUs " << RunnableClass::formatCPUMask(cpuSets[set]) << ":\tTasks: " << group.size()
+				<< "\tUtilization: " << std::fixed << std::setprecision(3) << (utilization * 100.0)
+				<< "%\tRM bound: " << (liuLaylandBound * 100.0) << "%";
+		if (utilization > 1.0) {
+			std::cout << "\tOVERLOADED";
+		} else if (utilization > liuLaylandBound) {
+			std::cout << "\tAbove RM bound, see response times";
+		}
+		std::cout << "\n";
+
+		/**
+		 * 4.0 Compute the worst case response time of each task, both for the current priorities and for the suggested ones.
+		 */
+		std::cout << "Thread\tTask              \tPrio.\tperiod(us)\tWCET(us)\tWCRT(us)\tDeadline\tRM Prio.\tRM WCRT(us)\tRM Deadline\n";
+		for (uint32_t index = 0; index < group.size(); index++) {
+			AnalyzedTask &task = group[index];
+			long response = responseTime(group, index, false);
+			long suggestedResponse = responseTime(group, index, true);
+
+			std::cout << task.tid << "\t" << std::setw(18) << task.name << "\t " << std::setw(5) << task.priority
+					<< (task.multiplexed ? "*" : " ") << "\t " << std::setw(10) << task.period << "\t " << std::setw(8)
+					<< task.wcet << "\t " << std::setw(8);
+			if (response < 0) {
+				std::cout << ">period" << "\t" << std::setw(8) << "MISS";
+			} else {
+				std::cout << response << "\t" << std::setw(8) << "met";
+			}
+			std::cout << "\t " << std::setw(8) << task.suggestedPriority << "\t " << std::setw(11);
+			if (suggestedResponse < 0) {
+				std::cout << ">period" << "\t" << std::setw(11) << "MISS";
+			} else {
+				std::cout << suggestedResponse << "\t" << std::setw(11) << "met";
+			}
+			if (task.wcet == 0) {
+				std::cout << "\t(not yet measured)";
+			}
+			std::cout << "\n";
+		}
+
+		/**
+		 * 5.0 Threads which are not periodic cannot be analyzed, but warn about any which can preempt the tasks on these CPUs.
+		 */
+		for (std::list<RunnableClass*>::iterator it = RunnableClass::runningThreads.begin();
+				it != RunnableClass::runningThreads.end(); it++) {
+			RunnableClass *rc = *it;
+			if ((dynamic_cast<PeriodicTask*>(rc) != NULL) || (dynamic_cast<CyclicExecutive*>(rc) != NULL)) {
+				continue;
+			}
+			uint32_t cpus = rc->getEffectiveAffinity();
+			if (cpus == 0) {
+				cpus = rc->getAffinity();
+			}
+			bool overlaps = (cpus == 0) || (cpuSets[set] == 0) || ((cpus & cpuSets[set]) != 0);
+			if ((overlaps) && (rc->getPriority() >= lowestPriority)) {
+				std::cout << "Not analyzed: " << rc->myName << " (priority " << rc->getPriority()
+						<< ", not periodic) can preempt tasks on these CPUs.\n";
+			}
+		}
+	}
+	std::cout << "* The task is multiplexed onto the cyclic executive and runs at its priority.\n";
+	std::cout << "===============================================================================================\n";
+}
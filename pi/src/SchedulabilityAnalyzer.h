@@ -0,0 +1,118 @@
+/**
+ * @file SchedulabilityAnalyzer.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the schedulability analyzer.  It takes the periods, priorities, CPU affinity and measured worst case execution
+ *      times of the running periodic tasks, and performs response time analysis separately for each set of CPUs that tasks are pinned to.
+ *      It reports the utilization, the worst case response time of each task and which tasks can miss their deadlines, and it suggests a
+ *      rate monotonic priority assignment along with the response times that the suggested assignment would give.
+ */
+
+#ifndef SCHEDULABILITYANALYZER_H_
+#define SCHEDULABILITYANALYZER_H_
+
+#include "PeriodicTask.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+class SchedulabilityAnalyzer {
+private:
+	/**
+	 * This structure holds everything the analysis needs to know about a single periodic task.
+	 */
+	struct AnalyzedTask {
+		/**
+		 * This is the OS thread id of the thread that runs the task.
+		 */
+		pid_t tid;
+		/**
+		 * This is the name of the task.
+		 */
+		std::string name;
+		/**
+		 * This is the period of the task, in microseconds.  The deadline is taken to be the end of the period.
+		 */
+		long period;
+		/**
+		 * This is the measured worst case execution time of the task, in microseconds.
+		 */
+		long wcet;
+		/**
+		 * This is the priority that the task runs at.  For a multiplexed task, it is the priority of the cyclic executive.
+		 */
+		int priority;
+		/**
+		 * This is the set of CPUs that the task runs on.  0 indicates that the task may run on any CPU.
+		 */
+		uint32_t cpus;
+		/**
+		 * This flag is set if the task is multiplexed onto the cyclic executive.
+		 */
+		bool multiplexed;
+		/**
+		 * This is the suggested rate monotonic priority for the task.
+		 */
+		int suggestedPriority;
+	};
+
+	/**
+	 * This method will build the list of periodic tasks that are to be analyzed from the running threads.
+	 * @param tasks This is the list that the tasks are added to.
+	 */
+	static void collectTasks(std::vector<AnalyzedTask> &tasks);
+
+	/**
+	 * This method will determine whether one task is listed before another.  Tasks are listed from the highest to the lowest priority, and
+	 * tasks with the same priority are listed from the shortest to the longest period.
+	 * @param a This is the first task.
+	 * @param b This is the second task.
+	 * @return true if the first task is to be listed before the second.
+	 */
+	static bool hasHigherPriority(const AnalyzedTask &a, const AnalyzedTask &b);
+
+	/**
+	 * This method will assign a rate monotonic priority to each task.  Shorter periods get higher priorities, and equal periods share a priority.
+	 * @param tasks This is the list of tasks.
+	 */
+	static void suggestPriorities(std::vector<AnalyzedTask> &tasks);
+
+	/**
+	 * This method will compute the worst case response time of a task using response time analysis.  Every other task on the same CPUs with
+	 * an equal or higher priority is counted as interference.
+	 * @param tasks This is the list of tasks which run on the same CPUs as the task.
+	 * @param index This is the index of the task that is to be analyzed.
+	 * @param useSuggested If true, the suggested priorities are used.  Otherwise the priorities that the tasks run at are used.
+	 * @return The worst case response time in microseconds will be returned, or -1 if it exceeds the period of the task.
+	 */
+	static long responseTime(const std::vector<AnalyzedTask> &tasks, uint32_t index, bool useSuggested);
+
+public:
+	/**
+	 * This method will analyze the running periodic tasks and print the results to the console.
+	 */
+	static void analyze();
+};
+
+#endif /* SCHEDULABILITYANALYZER_H_ */
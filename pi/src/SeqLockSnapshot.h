@@ -0,0 +1,134 @@
+/**
+ * @file SeqLockSnapshot.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines a double buffered seqlock.  A single writer thread publishes snapshots of a plain structure, and any number of
+ *      reader threads obtain consistent copies of the latest snapshot.  The writer never blocks and never waits on a reader.  Each of the two
+ *      buffers has its own sequence number, and the writer always fills the buffer which is not the latest one.  A reader retrying after a
+ *      torn read therefore goes to a buffer that the writer is not touching, so even a high priority reader cannot starve a preempted writer.
+ */
+
+#ifndef SEQLOCKSNAPSHOT_H_
+#define SEQLOCKSNAPSHOT_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+template<typename T>
+class SeqLockSnapshot {
+private:
+	static_assert(std::is_trivially_copyable<T>::value, "SeqLockSnapshot copies its structure as words, so it must be trivially copyable.");
+
+	/**
+	 * This is the number of 32 bit words needed to hold the structure.  The structure must be trivially copyable.
+	 */
+	static const uint32_t WORD_COUNT = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+	/**
+	 * This structure is one of the two buffers.  The sequence number is odd while the writer is updating the buffer.
+	 */
+	struct Buffer {
+		std::atomic<uint32_t> sequence;
+		std::atomic<uint32_t> words[WORD_COUNT];
+	};
+
+	/**
+	 * These are the two buffers that the snapshots are written into.
+	 */
+	Buffer buffers[2];
+
+	/**
+	 * This is the index of the buffer holding the latest complete snapshot.
+	 */
+	std::atomic<uint32_t> latest;
+
+public:
+	/**
+	 * This is the default constructor.  It publishes a value initialized structure as the first snapshot.
+	 */
+	SeqLockSnapshot() {
+		for (uint32_t index = 0; index < 2; index++) {
+			buffers[index].sequence.store(0, std::memory_order_relaxed);
+			for (uint32_t word = 0; word < WORD_COUNT; word++) {
+				buffers[index].words[word].store(0, std::memory_order_relaxed);
+			}
+		}
+		latest.store(0, std::memory_order_relaxed);
+		store(T());
+	}
+
+	/**
+	 * This method will publish a new snapshot.  It must only ever be called from a single writer thread.  It never blocks.
+	 * @param value This is the value that is to be published.
+	 */
+	void store(const T &value) {
+		uint32_t source[WORD_COUNT];
+		source[WORD_COUNT - 1] = 0;
+		memcpy(source, &value, sizeof(T));
+
+		/**
+		 * Write into the buffer that readers are not being directed to.  Mark it as being updated, copy the data, and then mark it as complete.
+		 */
+		Buffer &target = buffers[latest.load(std::memory_order_relaxed) ^ 1];
+		uint32_t sequence = target.sequence.load(std::memory_order_relaxed);
+		target.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (uint32_t word = 0; word < WORD_COUNT; word++) {
+			target.words[word].store(source[word], std::memory_order_relaxed);
+		}
+		target.sequence.store(sequence + 2, std::memory_order_release);
+
+		/**
+		 * Now direct readers to the new snapshot.
+		 */
+		latest.store(latest.load(std::memory_order_relaxed) ^ 1, std::memory_order_release);
+	}
+
+	/**
+	 * This method will obtain a consistent copy of the latest snapshot.  It may be called from any thread.  It retries only if the writer
+	 * completed two publications while the copy was being made.
+	 * @return The latest snapshot will be returned.
+	 */
+	T load() const {
+		uint32_t destination[WORD_COUNT];
+		uint32_t before;
+		uint32_t after;
+
+		do {
+			const Buffer &source = buffers[latest.load(std::memory_order_acquire)];
+			before = source.sequence.load(std::memory_order_acquire);
+			for (uint32_t word = 0; word < WORD_COUNT; word++) {
+				destination[word] = source.words[word].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = source.sequence.load(std::memory_order_relaxed);
+		} while (((before & 1) != 0) || (before != after));
+
+		T value;
+		memcpy(&value, destination, sizeof(T));
+		return value;
+	}
+};
+
+#endif /* SEQLOCKSNAPSHOT_H_ */
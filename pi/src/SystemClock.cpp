@@ -0,0 +1,64 @@
+/**
+ * @file SystemClock.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the system clock.  It reads CLOCK_MONOTONIC and sleeps with clock_nanosleep, so the tasks run in real time.
+ */
+
+#include "SystemClock.h"
+#include "time_util.h"
+#include <chrono>
+#include <errno.h>
+#include <time.h>
+
+/**
+ * This method will return the current CLOCK_MONOTONIC time.
+ * @return The current time, in nanoseconds, will be returned.
+ */
+int64_t SystemClock::now() {
+	return getMonotonicTimeNs();
+}
+
+/**
+ * This method will block the calling thread until CLOCK_MONOTONIC reaches the given time.  It will do this with clock_nanosleep(TIMER_ABSTIME).
+ * @param timeNs This is the absolute time, in nanoseconds, to sleep until.
+ */
+void SystemClock::sleepUntil(int64_t timeNs) {
+	struct timespec wakeTs = nsToTimespec(timeNs);
+
+	/**
+	 * If a signal interrupts the sleep, simply go back to sleep, as the wake time is absolute.
+	 */
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTs, NULL) == EINTR) {
+	}
+}
+
+/**
+ * This method will wait on a condition variable for up to the given amount of real time.
+ * @param cv This is the condition variable to wait on.
+ * @param lock This is the lock that protects the condition.  It must be held by the caller.
+ * @param timeoutNs This is the longest amount of time, in nanoseconds, to wait.
+ * @return true if the condition variable was notified.  False if the wait timed out.
+ */
+bool SystemClock::waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, int64_t timeoutNs) {
+	return (cv.wait_for(lock, std::chrono::nanoseconds(timeoutNs)) == std::cv_status::no_timeout);
+}
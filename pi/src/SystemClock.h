@@ -0,0 +1,56 @@
+/**
+ * @file SystemClock.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the system clock.  It reads CLOCK_MONOTONIC and sleeps with clock_nanosleep, so the tasks run in real time.
+ */
+
+#ifndef SYSTEMCLOCK_H_
+#define SYSTEMCLOCK_H_
+
+#include "Clock.h"
+
+class SystemClock: public Clock {
+public:
+	/**
+	 * This method will return the current CLOCK_MONOTONIC time.
+	 * @return The current time, in nanoseconds, will be returned.
+	 */
+	virtual int64_t now();
+
+	/**
+	 * This method will block the calling thread until CLOCK_MONOTONIC reaches the given time.  It will do this with clock_nanosleep(TIMER_ABSTIME).
+	 * @param timeNs This is the absolute time, in nanoseconds, to sleep until.
+	 */
+	virtual void sleepUntil(int64_t timeNs);
+
+	/**
+	 * This method will wait on a condition variable for up to the given amount of real time.
+	 * @param cv This is the condition variable to wait on.
+	 * @param lock This is the lock that protects the condition.  It must be held by the caller.
+	 * @param timeoutNs This is the longest amount of time, in nanoseconds, to wait.
+	 * @return true if the condition variable was notified.  False if the wait timed out.
+	 */
+	virtual bool waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, int64_t timeoutNs);
+};
+
+#endif /* SYSTEMCLOCK_H_ */
@@ -26,50 +26,76 @@
 
 #include "Cameracfg.h"
 
+/**
+ * These macros define the core map.  Each task is pinned to a set of CPUs, given as a mask where bit n selects CPU n.  A mask of 0 leaves the
+ * affinity of the task alone.  The control core is meant to be isolated from the general scheduler (isolcpus=3 on the kernel command line),
+ * so that the motor and sensor timing is not disturbed by the image pipeline, which is kept on its own cores.  The communication core carries
+ * the network tasks and the robot controller.  The controller blocks on its command queue and wakes for each command, so it runs as often as
+ * commands arrive from the network.  Keeping it beside the network tasks which feed it means a burst of commands does not preempt the
+ * control tasks.
+ */
+#define CONTROL_CPU (3)
+#define CONTROL_CPU_MASK (1 << CONTROL_CPU)
+#define COMMUNICATION_CPU_MASK (1 << 2)
+#define VISION_CPU_MASK ((1 << 0) | (1 << 1))
+
 /**
  * This is the task rate for the horn controller.
  */
 #define HORN_TASK_PERIOD (125000)
 #define HORN_TASK_PRIORITY (10)
+#define HORN_TASK_CPUS (CONTROL_CPU_MASK)
 
 /**
  * This macro defines the task rate for the motor controllers.  All 4 motors on the robot run at the same rate.
  */
 #define MOTOR_CTRL_TASK_PERIOD (20000)
 #define MOTOR_CTRL_TASK_PRIORITY (10)
+#define MOTOR_CTRL_TASK_CPUS (CONTROL_CPU_MASK)
 
 /**
  * This macro defines the task rate for the collision sensor.
  */
 #define COLLISION_SENSOR_TASK_PERIOD (100000)
 #define COLLISION_SENSOR_TASK_PRIORITY (10)
+#define COLLISION_SENSOR_TASK_CPUS (CONTROL_CPU_MASK)
 
 /**
  * This defined the priority for the line tracker.
  */
 #define LINE_TRACKER_SENSOR_TASK_PERIOD (40000)
 #define LINE_TRACKER_SENSOR_TASK_PRIORITY (10)
+#define LINE_TRACKER_SENSOR_TASK_CPUS (CONTROL_CPU_MASK)
 
 /**
  * This variable defines the task rate for the distance sensor.  It senses the distance to objects.
  */
 #define DISTANCE_SENSOR_TASK_PERIOD (75000)
 #define DISTANCE_SENSOR_TASK_PRIORITY (54) 
+#define DISTANCE_SENSOR_TASK_CPUS (CONTROL_CPU_MASK)
 
 /**
  * These variables control the Image stream.
  */
 #define IMAGE_STREAM_TASK_PERIOD ((1000000/fps))
 #define IMAGE_STREAM_TASK_PRIORITY (10)
+#define IMAGE_STREAM_TASK_CPUS (VISION_CPU_MASK)
 
 /**
  * These variables set up the camera task rate.
  */
 #define CAMERA_TASK_PERIOD (1000000/FPS)
 #define CAMERA_TASK_PRIORITY (10)
+#define CAMERA_TASK_CPUS (VISION_CPU_MASK)
 
-#define ROBOT_STATUS_MANAGER_TASK_PERIOD (500000)
+/**
+ * These variables set up the robot status manager.  Its period is the fastest rate at which telemetry can be subscribed to.  The legacy
+ * reports, and the distance ranges they cover, run at the slower legacy report period.
+ */
+#define ROBOT_STATUS_MANAGER_TASK_PERIOD (20000)
+#define ROBOT_STATUS_LEGACY_REPORT_PERIOD (500000)
 #define ROBOT_STATUS_MANAGER_TASK_PRIORITY (10)
+#define ROBOT_STATUS_MANAGER_TASK_CPUS (COMMUNICATION_CPU_MASK)
 
 /**
  * Non periodic tasks and their priorities.
@@ -77,6 +103,41 @@
 #define ROBOT_CONTROLLER_PRIORITY (24)
 #define NETWORK_RECEPTION_TASK_PRIORITY (23)
 #define NETWORK_TRANSMIT_TASK_PRIORITY (11)
+#define ROBOT_CONTROLLER_CPUS (COMMUNICATION_CPU_MASK)
+#define NETWORK_RECEPTION_TASK_CPUS (COMMUNICATION_CPU_MASK)
+#define NETWORK_TRANSMIT_TASK_CPUS (COMMUNICATION_CPU_MASK)
+
+/**
+ * These macros configure how the robot controller waits on its command queue.  The controller blocks for up to the idle timeout,
+ * given in microseconds, and then handles up to the batch size of queued commands for each wakeup.
+ */
+#define ROBOT_CONTROLLER_IDLE_TIMEOUT (100000)
+#define ROBOT_CONTROLLER_BATCH_SIZE (32)
+
+/**
+ * These macros select how the periodic tasks are executed.  With PER_TASK_THREAD_EXECUTION, every periodic task runs on its own thread.
+ * With CYCLIC_EXECUTIVE_EXECUTION, the short periodic tasks are multiplexed onto a single pinned thread by the cyclic executive.
+ * TASK_EXECUTION_MODE is the default, which can be overridden on the command line at startup.
+ */
+#define PER_TASK_THREAD_EXECUTION (0)
+#define CYCLIC_EXECUTIVE_EXECUTION (1)
+#define TASK_EXECUTION_MODE (PER_TASK_THREAD_EXECUTION)
+
+/**
+ * These macros configure the cyclic executive.  Task periods are rounded up to a multiple of the quantum, which keeps the major frame short.
+ * The executive runs at a priority above all of the tasks it multiplexes, on the given CPU.
+ */
+#define CYCLIC_EXECUTIVE_MINOR_FRAME_QUANTUM (5000)
+#define CYCLIC_EXECUTIVE_MAX_MINOR_FRAMES (100000)
+#define CYCLIC_EXECUTIVE_PRIORITY (20)
+#define CYCLIC_EXECUTIVE_CPU (CONTROL_CPU)
+
+/**
+ * These macros define the range of priorities that the schedulability analyzer uses when it suggests a rate monotonic priority assignment.
+ * The task with the shortest period is given the highest priority, and each longer period is given the next lower priority.
+ */
+#define RATE_MONOTONIC_HIGHEST_PRIORITY (60)
+#define RATE_MONOTONIC_LOWEST_PRIORITY (10)
 
 
 
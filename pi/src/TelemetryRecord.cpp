@@ -0,0 +1,243 @@
+/**
+ * @file TelemetryRecord.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the telemetry record and its two encodings.
+ */
+
+#include "TelemetryRecord.h"
+#include <string.h>
+
+/**
+ * This method will write an unsigned value as a varint, seven bits to a byte, least significant first, with the top bit of each byte
+ * set if another byte follows.
+ * @param buffer This is where the varint is written.
+ * @param value This is the value.
+ * @return The number of bytes written, from 1 to 5.
+ */
+static uint32_t writeVarint(uint8_t *buffer, uint32_t value) {
+	uint32_t length = 0;
+	while (value >= 0x80) {
+		buffer[length++] = (uint8_t) (value | 0x80);
+		value >>= 7;
+	}
+	buffer[length++] = (uint8_t) value;
+	return length;
+}
+
+/**
+ * This method will read a varint.
+ * @param buffer This is the encoded data.
+ * @param length This is the number of bytes of encoded data.
+ * @param position This is the index of the varint.  It is advanced past it.
+ * @param value This is where the value is written.
+ * @return true if a whole varint was read.  False if the data ran out, or the varint is longer than 32 bits can need.
+ */
+static bool readVarint(const uint8_t *buffer, uint32_t length, uint32_t &position, uint32_t &value) {
+	value = 0;
+	for (int shift = 0; (shift < 35) && (position < length); shift += 7) {
+		uint8_t byte = buffer[position++];
+		value |= ((uint32_t) (byte & 0x7F)) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * This method will write a 32 bit value in network byte order.
+ * @param buffer This is where the value is written.
+ * @param value This is the value.
+ */
+static void writeWord(uint8_t *buffer, uint32_t value) {
+	buffer[0] = (uint8_t) (value >> 24);
+	buffer[1] = (uint8_t) (value >> 16);
+	buffer[2] = (uint8_t) (value >> 8);
+	buffer[3] = (uint8_t) value;
+}
+
+/**
+ * This method will read a 32 bit value in network byte order.
+ * @param buffer This is the value.
+ * @return The value.
+ */
+static uint32_t readWord(const uint8_t *buffer) {
+	return (((uint32_t) buffer[0]) << 24) | (((uint32_t) buffer[1]) << 16) | (((uint32_t) buffer[2]) << 8) | ((uint32_t) buffer[3]);
+}
+
+/**
+ * This is the constructor, which creates a record with no fields present.
+ */
+TelemetryRecord::TelemetryRecord() {
+	clear();
+	sampleTime = 0;
+}
+
+/**
+ * This method will remove every field from the record.
+ */
+void TelemetryRecord::clear() {
+	presentFields = 0;
+	memset(values, 0, sizeof(values));
+}
+
+/**
+ * This method will set a field, which makes it present.  A field this version does not know is ignored.
+ * @param field This is the number of the field.
+ * @param value This is the value.
+ */
+void TelemetryRecord::set(int field, int32_t value) {
+	if ((field >= 0) && (field < TELEMETRY_FIELD_COUNT)) {
+		values[field] = value;
+		presentFields |= (1u << field);
+	}
+}
+
+/**
+ * This method will determine whether a field is present.
+ * @param field This is the number of the field.
+ * @return true if the field is present.  False otherwise.
+ */
+bool TelemetryRecord::has(int field) const {
+	return (field >= 0) && (field < TELEMETRY_FIELD_COUNT) && ((presentFields & (1u << field)) != 0);
+}
+
+/**
+ * This method will return the value of a field.
+ * @param field This is the number of the field.
+ * @return The value of the field, or 0 if it is not present.
+ */
+int32_t TelemetryRecord::get(int field) const {
+	return has(field) ? values[field] : 0;
+}
+
+/**
+ * This method will return the mask of the fields present.
+ * @return The mask.  Bit n is set if field n is present.
+ */
+uint32_t TelemetryRecord::getPresentFields() const {
+	return presentFields;
+}
+
+/**
+ * This method will set when the record was sampled.
+ * @param sampleTime This is the time, from the monotonic clock in nanoseconds.
+ */
+void TelemetryRecord::setSampleTime(int64_t sampleTime) {
+	this->sampleTime = sampleTime;
+}
+
+/**
+ * This method will return when the record was sampled.
+ * @return The time, from the monotonic clock in nanoseconds.
+ */
+int64_t TelemetryRecord::getSampleTime() const {
+	return sampleTime;
+}
+
+/**
+ * This method will encode the record for the network.
+ * @param buffer This is where the record is written.  It must hold at least TELEMETRY_MAX_RECORD_SIZE bytes.
+ * @param encoding This is the encoding.  It is one of the TELEMETRY_ENCODING values.
+ * @param fieldMask This is the mask of the fields to encode.  Fields outside it are encoded as not present.
+ * @return The number of bytes written.
+ */
+uint32_t TelemetryRecord::encode(uint8_t *buffer, int encoding, uint32_t fieldMask) const {
+	uint32_t length = 0;
+	uint32_t encodedFields = presentFields & fieldMask;
+
+	if (encoding == TELEMETRY_ENCODING_FIXED) {
+		/**
+		 * 1.0 A fixed record holds every field at a fixed place, present or not.
+		 */
+		writeWord(&buffer[length], encodedFields);
+		length += 4;
+		for (int field = 0; field < TELEMETRY_FIELD_COUNT; field++) {
+			writeWord(&buffer[length], ((encodedFields & (1u << field)) != 0) ? (uint32_t) values[field] : 0);
+			length += 4;
+		}
+	} else {
+		/**
+		 * 2.0 A varint record holds only the fields present, in order.  Zigzag encoding maps small negative values, such as a left
+		 * steering offset, onto small unsigned ones, so that they also take a single byte.
+		 */
+		length += writeVarint(&buffer[length], encodedFields);
+		for (int field = 0; field < TELEMETRY_FIELD_COUNT; field++) {
+			if ((encodedFields & (1u << field)) != 0) {
+				uint32_t zigzag = (((uint32_t) values[field]) << 1) ^ (uint32_t) (values[field] >> 31);
+				length += writeVarint(&buffer[length], zigzag);
+			}
+		}
+	}
+	return length;
+}
+
+/**
+ * This method will decode a record received from the network.  Fields this version does not know are skipped, and fields the sender
+ * did not know are not present.  The sample time is not part of the encoding, and is left alone.
+ * @param buffer This is the encoded record.
+ * @param length This is the number of bytes in the encoded record.
+ * @param encoding This is the encoding.  It is one of the TELEMETRY_ENCODING values.
+ * @return true if the record was decoded.  False if it was truncated or the encoding is not known.
+ */
+bool TelemetryRecord::decode(const uint8_t *buffer, uint32_t length, int encoding) {
+	uint32_t mask;
+	uint32_t position = 0;
+
+	clear();
+	if (encoding == TELEMETRY_ENCODING_FIXED) {
+		/**
+		 * 1.0 The number of fields a fixed record holds is given by its length, so a record from an older sender is shorter and one from a
+		 * newer sender is longer.
+		 */
+		if ((length < 4) || ((length % 4) != 0)) {
+			return false;
+		}
+		mask = readWord(buffer);
+		uint32_t fields = (length - 4) / 4;
+		for (int field = 0; (field < TELEMETRY_FIELD_COUNT) && ((uint32_t) field < fields); field++) {
+			if ((mask & (1u << field)) != 0) {
+				set(field, (int32_t) readWord(&buffer[4 + (field * 4)]));
+			}
+		}
+	} else if (encoding == TELEMETRY_ENCODING_VARINT) {
+		/**
+		 * 2.0 Every field of a varint record is a varint, so one this version does not know can still be read past.
+		 */
+		if (!readVarint(buffer, length, position, mask)) {
+			return false;
+		}
+		for (int field = 0; field < 32; field++) {
+			if ((mask & (1u << field)) != 0) {
+				uint32_t zigzag;
+				if (!readVarint(buffer, length, position, zigzag)) {
+					clear();
+					return false;
+				}
+				set(field, (int32_t) ((zigzag >> 1) ^ (0u - (zigzag & 1))));
+			}
+		}
+	} else {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file TelemetryRecord.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines a telemetry record, which carries the state of the robot at one instant in a single message.  Each field has a
+ * fixed number, and a mask records which fields are present, so a record need only carry what the robot has.  New fields are given the
+ * next number, and a client which does not know them skips them.
+ */
+#ifndef TELEMETRYRECORD_H_
+#define TELEMETRYRECORD_H_
+
+#include <stdint.h>
+#include "NetworkMessage.h"
+
+/**
+ * These are the distance sensor's current, minimum, maximum and average readings since the last record.
+ */
+#define TELEMETRY_DISTANCE_CURRENT (0)
+#define TELEMETRY_DISTANCE_MIN (1)
+#define TELEMETRY_DISTANCE_MAX (2)
+#define TELEMETRY_DISTANCE_AVERAGE (3)
+
+/**
+ * These are the robot controller's speed, from 0 to 1000, steering, from -100 to 100, and current operation.
+ */
+#define TELEMETRY_SPEED (4)
+#define TELEMETRY_STEERING (5)
+#define TELEMETRY_OPERATION (6)
+
+/**
+ * This is the state of the line sensor, made up of the LINE_SENSOR_STATE bits.
+ */
+#define TELEMETRY_LINE_SENSOR (7)
+
+/**
+ * These are the number of commands waiting on each command queue, from the first queue to the third.
+ */
+#define TELEMETRY_COMMAND_QUEUE_DEPTH (8)
+#define TELEMETRY_COMMAND_QUEUES (3)
+
+/**
+ * This is the number of messages waiting to be sent.
+ */
+#define TELEMETRY_TRANSMISSION_QUEUE_DEPTH (11)
+
+/**
+ * This is the number of times any periodic task has run past its next release.
+ */
+#define TELEMETRY_DEADLINE_MISSES (12)
+
+/**
+ * This is the smallest smoothed round trip time of any link, in microseconds.
+ */
+#define TELEMETRY_ROUND_TRIP_US (13)
+
+/**
+ * These are the latency estimates of the links which have been pinged over, in link order, with up to TELEMETRY_LINK_SLOTS links in a
+ * record.  Each slot holds the number of the link, where links below MAX_NETWORK_CLIENTS are TCP clients and the rest are UDP senders,
+ * and its smoothed round trip and one way times in microseconds.  Slot n is held in the fields numbered n above each base.
+ */
+#define TELEMETRY_LINK_SLOTS (4)
+#define TELEMETRY_LINK_NUMBER (14)
+#define TELEMETRY_LINK_ROUND_TRIP_US (TELEMETRY_LINK_NUMBER + TELEMETRY_LINK_SLOTS)
+#define TELEMETRY_LINK_ONE_WAY_US (TELEMETRY_LINK_ROUND_TRIP_US + TELEMETRY_LINK_SLOTS)
+
+/**
+ * This is the number of fields this version of the record knows.  It may grow to 32.
+ */
+#define TELEMETRY_FIELD_COUNT (TELEMETRY_LINK_ONE_WAY_US + TELEMETRY_LINK_SLOTS)
+
+/**
+ * This is the largest an encoded record can be, in bytes, which is the mask and every field as five byte varints.
+ */
+#define TELEMETRY_MAX_RECORD_SIZE (5 * (TELEMETRY_FIELD_COUNT + 1))
+
+class TelemetryRecord {
+private:
+	/**
+	 * This is the mask of the fields present.  Bit n is set if field n is present.
+	 */
+	uint32_t presentFields;
+
+	/**
+	 * These are the values of the fields.  A field which is not present is 0.
+	 */
+	int32_t values[TELEMETRY_FIELD_COUNT];
+
+	/**
+	 * This is when the record was sampled, from the monotonic clock in nanoseconds.
+	 */
+	int64_t sampleTime;
+
+public:
+	/**
+	 * This is the constructor, which creates a record with no fields present.
+	 */
+	TelemetryRecord();
+
+	/**
+	 * This method will remove every field from the record.
+	 */
+	void clear();
+
+	/**
+	 * This method will set a field, which makes it present.  A field this version does not know is ignored.
+	 * @param field This is the number of the field.
+	 * @param value This is the value.
+	 */
+	void set(int field, int32_t value);
+
+	/**
+	 * This method will determine whether a field is present.
+	 * @param field This is the number of the field.
+	 * @return true if the field is present.  False otherwise.
+	 */
+	bool has(int field) const;
+
+	/**
+	 * This method will return the value of a field.
+	 * @param field This is the number of the field.
+	 * @return The value of the field, or 0 if it is not present.
+	 */
+	int32_t get(int field) const;
+
+	/**
+	 * This method will return the mask of the fields present.
+	 * @return The mask.  Bit n is set if field n is present.
+	 */
+	uint32_t getPresentFields() const;
+
+	/**
+	 * This method will set when the record was sampled.
+	 * @param sampleTime This is the time, from the monotonic clock in nanoseconds.
+	 */
+	void setSampleTime(int64_t sampleTime);
+
+	/**
+	 * This method will return when the record was sampled.
+	 * @return The time, from the monotonic clock in nanoseconds.
+	 */
+	int64_t getSampleTime() const;
+
+	/**
+	 * This method will encode the record for the network.
+	 * @param buffer This is where the record is written.  It must hold at least TELEMETRY_MAX_RECORD_SIZE bytes.
+	 * @param encoding This is the encoding.  It is one of the TELEMETRY_ENCODING values.
+	 * @param fieldMask This is the mask of the fields to encode.  Fields outside it are encoded as not present.
+	 * @return The number of bytes written.
+	 */
+	uint32_t encode(uint8_t *buffer, int encoding, uint32_t fieldMask = 0xFFFFFFFF) const;
+
+	/**
+	 * This method will decode a record received from the network.  Fields this version does not know are skipped, and fields the sender
+	 * did not know are not present.  The sample time is not part of the encoding, and is left alone.
+	 * @param buffer This is the encoded record.
+	 * @param length This is the number of bytes in the encoded record.
+	 * @param encoding This is the encoding.  It is one of the TELEMETRY_ENCODING values.
+	 * @return true if the record was decoded.  False if it was truncated or the encoding is not known.
+	 */
+	bool decode(const uint8_t *buffer, uint32_t length, int encoding);
+};
+
+#endif /* TELEMETRYRECORD_H_ */
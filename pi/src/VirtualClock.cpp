@@ -0,0 +1,268 @@
+/**
+ * @file VirtualClock.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the virtual clock, a deterministic, discrete event clock that lets the task set run faster than real time.
+ */
+
+#include "VirtualClock.h"
+#include "RunnableClass.h"
+
+/**
+ * This is the participant for the calling thread.  It is set when the thread attaches to a virtual clock.
+ */
+static thread_local RunnableClass *currentRunnable = NULL;
+
+/**
+ * This is the constructor for the virtual clock.  The clock starts at time 0, and does not run any participant until it is told to run.
+ */
+VirtualClock::VirtualClock() {
+	running = NULL;
+	currentTime = 0;
+	limit = -1;
+	registrationCount = 0;
+}
+
+/**
+ * This is the destructor for the virtual clock.
+ */
+VirtualClock::~VirtualClock() {
+	/**
+	 * Nothing to be done in the destructor.
+	 */
+}
+
+/**
+ * This method will return the current virtual time.
+ * @return The current time, in nanoseconds, will be returned.
+ */
+int64_t VirtualClock::now() {
+	return currentTime.load(std::memory_order_acquire);
+}
+
+/**
+ * This method will find the participant for the given runnable.
+ * @param runnable This is the runnable.
+ * @return The participant will be returned, or NULL if the runnable has not been registered.
+ */
+VirtualClock::Participant *VirtualClock::findParticipant(RunnableClass *runnable) {
+	for (std::list<Participant>::iterator it = participants.begin(); it != participants.end(); it++) {
+		if (it->runnable == runnable) {
+			return &(*it);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * This method will find the participant for the calling thread.
+ * @return The participant will be returned, or NULL if the calling thread is not a participant of this clock.
+ */
+VirtualClock::Participant *VirtualClock::callingParticipant() {
+	if (currentRunnable == NULL) {
+		return NULL;
+	}
+	return findParticipant(currentRunnable);
+}
+
+/**
+ * This method will select the next participant to run, if none is running, and advance the time to its wake time.  The mutex must be held.
+ */
+void VirtualClock::dispatch() {
+	if (running != NULL) {
+		return;
+	}
+
+	/**
+	 * 1.0 Find the ready participant with the earliest wake time.  Ties go to the higher priority, and then to the one registered first.
+	 */
+	Participant *next = NULL;
+	for (std::list<Participant>::iterator it = participants.begin(); it != participants.end(); it++) {
+		if ((it->state != READY) || (it->wakeTime > limit)) {
+			continue;
+		}
+		if ((next == NULL) || (it->wakeTime < next->wakeTime)
+				|| ((it->wakeTime == next->wakeTime) && (it->priority > next->priority))
+				|| ((it->wakeTime == next->wakeTime) && (it->priority == next->priority) && (it->order < next->order))) {
+			next = &(*it);
+		}
+	}
+
+	/**
+	 * 2.0 Advance the time to when the participant is due, or to the limit if nothing is due before it, and let the participant run.
+	 */
+	if (next != NULL) {
+		if (next->wakeTime > currentTime) {
+			currentTime.store(next->wakeTime, std::memory_order_release);
+		}
+		next->state = RUNNING;
+		running = next;
+	} else if ((limit > currentTime) && (limit != INT64_MAX)) {
+		currentTime.store(limit, std::memory_order_release);
+	}
+	cv.notify_all();
+}
+
+/**
+ * This method will determine whether the simulation has gone as far as it can.  The mutex must be held.
+ * @return true if no participant is running and none is ready to run before the limit.
+ */
+bool VirtualClock::isIdle() {
+	if (running != NULL) {
+		return false;
+	}
+	for (std::list<Participant>::iterator it = participants.begin(); it != participants.end(); it++) {
+		if ((it->state == READY) && (it->wakeTime <= limit)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * This method will block the calling thread until the virtual time reaches the given time.  A participant gives up its turn to run, and
+ * is run again once every participant due before it has run.
+ * @param timeNs This is the absolute time, in nanoseconds, to sleep until.
+ */
+void VirtualClock::sleepUntil(int64_t timeNs) {
+	std::unique_lock<std::mutex> lck(mtx);
+	Participant *self = callingParticipant();
+
+	if (self == NULL) {
+		/**
+		 * Threads which are not participants simply wait for the simulation to reach the time.
+		 */
+		cv.wait(lck, [this, timeNs]() {return currentTime >= timeNs;});
+		return;
+	}
+
+	/**
+	 * Give up the turn to run, and wait until the clock hands it back.
+	 */
+	self->wakeTime = (timeNs > currentTime) ? timeNs : (int64_t) currentTime;
+	self->state = READY;
+	running = NULL;
+	dispatch();
+	cv.wait(lck, [this, self]() {return running == self;});
+}
+
+/**
+ * This method will wait for the given amount of virtual time.  There is no hardware in a simulation, so the wait always times out.
+ * @param condition This is the condition variable to wait on.
+ * @param lock This is the lock that protects the condition.  It must be held by the caller.
+ * @param timeoutNs This is the longest amount of time, in nanoseconds, to wait.
+ * @return False will be returned, as the wait has timed out.
+ */
+bool VirtualClock::waitFor(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, int64_t timeoutNs) {
+	lock.unlock();
+	sleepFor(timeoutNs);
+	lock.lock();
+	return false;
+}
+
+/**
+ * This method will register a runnable as a participant.  It is ready to run at the current virtual time.
+ * @param participant This is the runnable which is to take part in the clock.
+ */
+void VirtualClock::registerParticipant(RunnableClass *participant) {
+	std::lock_guard<std::mutex> lck(mtx);
+
+	/**
+	 * A runnable which is restarted reuses its entry.
+	 */
+	Participant *entry = findParticipant(participant);
+	if (entry == NULL) {
+		Participant newEntry;
+		newEntry.runnable = participant;
+		participants.push_back(newEntry);
+		entry = &participants.back();
+	}
+	entry->priority = participant->getPriority();
+	entry->order = registrationCount++;
+	entry->wakeTime = currentTime;
+	entry->state = READY;
+	dispatch();
+}
+
+/**
+ * This method will block the thread of a participant until it is its turn to run for the first time.
+ * @param participant This is the runnable which is starting.
+ */
+void VirtualClock::attachParticipant(RunnableClass *participant) {
+	std::unique_lock<std::mutex> lck(mtx);
+	Participant *self = findParticipant(participant);
+	if (self == NULL) {
+		return;
+	}
+
+	currentRunnable = participant;
+	cv.wait(lck, [this, self]() {return running == self;});
+}
+
+/**
+ * This method will remove a participant from the simulation once its run method has returned.
+ * @param participant This is the runnable which has finished.
+ */
+void VirtualClock::detachParticipant(RunnableClass *participant) {
+	std::lock_guard<std::mutex> lck(mtx);
+	Participant *self = findParticipant(participant);
+	if (self == NULL) {
+		return;
+	}
+
+	self->state = FINISHED;
+	if (running == self) {
+		running = NULL;
+	}
+	currentRunnable = NULL;
+	dispatch();
+}
+
+/**
+ * This method will run the simulation until the virtual time reaches the given time.  It returns once every release due up to that time
+ * has run.
+ * @param timeNs This is the virtual time, in nanoseconds, to run until.
+ */
+void VirtualClock::runUntil(int64_t timeNs) {
+	std::unique_lock<std::mutex> lck(mtx);
+	limit = timeNs;
+	dispatch();
+	cv.wait(lck, [this]() {return isIdle();});
+}
+
+/**
+ * This method will run the simulation, without a time limit, until every participant has finished.  It is used to let the tasks shut down
+ * once they have been stopped.
+ */
+void VirtualClock::runToCompletion() {
+	std::unique_lock<std::mutex> lck(mtx);
+	limit = INT64_MAX;
+	dispatch();
+	cv.wait(lck, [this]() {
+		for (std::list<Participant>::iterator it = participants.begin(); it != participants.end(); it++) {
+			if (it->state != FINISHED) {
+				return false;
+			}
+		}
+		return true;
+	});
+}
@@ -0,0 +1,214 @@
+/**
+ * @file VirtualClock.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the virtual clock.  It is a deterministic, discrete event clock that lets the task set run faster than real time.
+ *      Every periodic task and cyclic executive which is started while the virtual clock is selected takes part in it.  Only one participant
+ *      runs at a time, and the clock only advances when every participant is asleep.  It then jumps straight to the earliest wake time, and
+ *      wakes the participants in order of wake time, then priority, then the order in which they were started.  A task method therefore takes
+ *      no virtual time, and a simulated run gives the same sequence of releases every time it is run.  Other threads, such as the network
+ *      threads, keep running in real time alongside the simulation, so anything they feed to the tasks is not reproducible.  Waits for hardware
+ *      events, such as GPIO edges, always time out, since there is no hardware in a simulation.
+ */
+
+#ifndef VIRTUALCLOCK_H_
+#define VIRTUALCLOCK_H_
+
+#include "Clock.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <stdint.h>
+
+class VirtualClock: public Clock {
+private:
+	/**
+	 * This enumeration defines the states that a participant can be in.
+	 */
+	enum ParticipantState {
+		/**
+		 * The participant is waiting to run at its wake time.
+		 */
+		READY,
+		/**
+		 * The participant is the one which is running.
+		 */
+		RUNNING,
+		/**
+		 * The run method of the participant has returned.
+		 */
+		FINISHED
+	};
+
+	/**
+	 * This structure holds the scheduling information for a single participant.
+	 */
+	struct Participant {
+		/**
+		 * This is the runnable which is participating.
+		 */
+		RunnableClass *runnable;
+		/**
+		 * This is the priority of the participant.  It breaks ties between participants with the same wake time.
+		 */
+		int priority;
+		/**
+		 * This is the order in which the participant was registered.  It breaks ties between participants with the same wake time and priority.
+		 */
+		uint32_t order;
+		/**
+		 * This is the virtual time, in nanoseconds, at which the participant is to run next.
+		 */
+		int64_t wakeTime;
+		/**
+		 * This is the state of the participant.
+		 */
+		ParticipantState state;
+	};
+
+	/**
+	 * This mutex protects all of the state of the clock.
+	 */
+	std::mutex mtx;
+
+	/**
+	 * This condition variable is notified whenever the running participant or the time changes.
+	 */
+	std::condition_variable cv;
+
+	/**
+	 * These are the participants which have been registered.  A list is used so that references to the entries stay valid as participants are added.
+	 */
+	std::list<Participant> participants;
+
+	/**
+	 * This is the participant which is running, or NULL if none is.
+	 */
+	Participant *running;
+
+	/**
+	 * This is the current virtual time, in nanoseconds.
+	 */
+	std::atomic<int64_t> currentTime;
+
+	/**
+	 * This is the time which the simulation may advance to.  The clock does not run any participant whose wake time is past it.
+	 */
+	int64_t limit;
+
+	/**
+	 * This is the number of participants which have been registered.
+	 */
+	uint32_t registrationCount;
+
+	/**
+	 * This method will find the participant for the given runnable.
+	 * @param runnable This is the runnable.
+	 * @return The participant will be returned, or NULL if the runnable has not been registered.
+	 */
+	Participant *findParticipant(RunnableClass *runnable);
+
+	/**
+	 * This method will find the participant for the calling thread.
+	 * @return The participant will be returned, or NULL if the calling thread is not a participant of this clock.
+	 */
+	Participant *callingParticipant();
+
+	/**
+	 * This method will select the next participant to run, if none is running, and advance the time to its wake time.  The mutex must be held.
+	 */
+	void dispatch();
+
+	/**
+	 * This method will determine whether the simulation has gone as far as it can.  The mutex must be held.
+	 * @return true if no participant is running and none is ready to run before the limit.
+	 */
+	bool isIdle();
+
+public:
+	/**
+	 * This is the constructor for the virtual clock.  The clock starts at time 0, and does not run any participant until it is told to run.
+	 */
+	VirtualClock();
+
+	/**
+	 * This is the destructor for the virtual clock.
+	 */
+	virtual ~VirtualClock();
+
+	/**
+	 * This method will return the current virtual time.
+	 * @return The current time, in nanoseconds, will be returned.
+	 */
+	virtual int64_t now();
+
+	/**
+	 * This method will block the calling thread until the virtual time reaches the given time.  A participant gives up its turn to run, and
+	 * is run again once every participant due before it has run.
+	 * @param timeNs This is the absolute time, in nanoseconds, to sleep until.
+	 */
+	virtual void sleepUntil(int64_t timeNs);
+
+	/**
+	 * This method will wait for the given amount of virtual time.  There is no hardware in a simulation, so the wait always times out.
+	 * @param condition This is the condition variable to wait on.
+	 * @param lock This is the lock that protects the condition.  It must be held by the caller.
+	 * @param timeoutNs This is the longest amount of time, in nanoseconds, to wait.
+	 * @return False will be returned, as the wait has timed out.
+	 */
+	virtual bool waitFor(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, int64_t timeoutNs);
+
+	/**
+	 * This method will register a runnable as a participant.  It is ready to run at the current virtual time.
+	 * @param participant This is the runnable which is to take part in the clock.
+	 */
+	virtual void registerParticipant(RunnableClass *participant);
+
+	/**
+	 * This method will block the thread of a participant until it is its turn to run for the first time.
+	 * @param participant This is the runnable which is starting.
+	 */
+	virtual void attachParticipant(RunnableClass *participant);
+
+	/**
+	 * This method will remove a participant from the simulation once its run method has returned.
+	 * @param participant This is the runnable which has finished.
+	 */
+	virtual void detachParticipant(RunnableClass *participant);
+
+	/**
+	 * This method will run the simulation until the virtual time reaches the given time.  It returns once every release due up to that time
+	 * has run.
+	 * @param timeNs This is the virtual time, in nanoseconds, to run until.
+	 */
+	void runUntil(int64_t timeNs);
+
+	/**
+	 * This method will run the simulation, without a time limit, until every participant has finished.  It is used to let the tasks shut down
+	 * once they have been stopped.
+	 */
+	void runToCompletion();
+};
+
+#endif /* VIRTUALCLOCK_H_ */
@@ -0,0 +1,184 @@
+/**
+ * @file BenchmarkReport.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the report which collects the results of a host benchmark.
+ */
+
+#include "BenchmarkReport.h"
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+
+/**
+ * This is the constructor, which creates an empty report.
+ * @param json If this is true, the report is written as JSON.  Otherwise it is written as CSV.
+ */
+BenchmarkReport::BenchmarkReport(bool json) {
+	this->json = json;
+}
+
+/**
+ * This method will start a new record.  Fields added after this belong to it.
+ */
+void BenchmarkReport::beginRecord() {
+	records.push_back(std::vector<Field>());
+}
+
+/**
+ * This method will add a field to the current record.
+ * @param name This is the name of the field.
+ * @param value This is the formatted value.
+ * @param text This indicates that the value is text.
+ */
+void BenchmarkReport::addField(const std::string &name, const std::string &value, bool text) {
+	if (records.empty()) {
+		beginRecord();
+	}
+
+	Field field;
+	field.name = name;
+	field.value = value;
+	field.text = text;
+	records.back().push_back(field);
+
+	for (size_t index = 0; index < columns.size(); index++) {
+		if (columns[index] == name) {
+			return;
+		}
+	}
+	columns.push_back(name);
+}
+
+/**
+ * This method will add a text field to the current record.
+ * @param name This is the name of the field.
+ * @param value This is the value.
+ */
+void BenchmarkReport::addText(const std::string &name, const std::string &value) {
+	addField(name, value, true);
+}
+
+/**
+ * This method will add an integer field to the current record.
+ * @param name This is the name of the field.
+ * @param value This is the value.
+ */
+void BenchmarkReport::addInteger(const std::string &name, uint64_t value) {
+	std::ostringstream formatted;
+	formatted << value;
+	addField(name, formatted.str(), false);
+}
+
+/**
+ * This method will add a real valued field to the current record.
+ * @param name This is the name of the field.
+ * @param value This is the value.
+ */
+void BenchmarkReport::addReal(const std::string &name, double value) {
+	std::ostringstream formatted;
+	formatted << std::fixed << std::setprecision(1) << value;
+	addField(name, formatted.str(), false);
+}
+
+/**
+ * This method will add the sample count, min, p50, p90, p99, p99.9, max and mean of a histogram to the current record.
+ * @param prefix This is the prefix of the field names, such as "enqueue_ns".
+ * @param histogram This is the histogram.
+ */
+void BenchmarkReport::addHistogram(const std::string &prefix, LatencyHistogram &histogram) {
+	addInteger(prefix + "_samples", histogram.getCount());
+	addInteger(prefix + "_min", histogram.getMin());
+	addInteger(prefix + "_p50", histogram.getPercentile(50.0));
+	addInteger(prefix + "_p90", histogram.getPercentile(90.0));
+	addInteger(prefix + "_p99", histogram.getPercentile(99.0));
+	addInteger(prefix + "_p99_9", histogram.getPercentile(99.9));
+	addInteger(prefix + "_max", histogram.getMax());
+	addReal(prefix + "_mean", histogram.getMean());
+}
+
+/**
+ * This method will escape a string so that it can be written inside JSON quotes.
+ * @param value This is the string.
+ * @return The escaped string.
+ */
+std::string BenchmarkReport::escape(const std::string &value) {
+	std::string escaped;
+
+	for (size_t index = 0; index < value.size(); index++) {
+		char character = value[index];
+		if ((character == '"') || (character == '\\')) {
+			escaped += '\\';
+			escaped += character;
+		} else if ((unsigned char) character < 0x20) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", character);
+			escaped += code;
+		} else {
+			escaped += character;
+		}
+	}
+	return escaped;
+}
+
+/**
+ * This method will write the report.
+ * @param os This is the stream that the report is to be written to.
+ */
+void BenchmarkReport::write(std::ostream &os) {
+	if (json) {
+		// 1.0 JSON is an array of objects, holding only the fields each record has.
+		os << "[\n";
+		for (size_t record = 0; record < records.size(); record++) {
+			os << "  {";
+			for (size_t index = 0; index < records[record].size(); index++) {
+				const Field &field = records[record][index];
+				os << ((index == 0) ? "" : ", ") << "\"" << escape(field.name) << "\": ";
+				if (field.text) {
+					os << "\"" << escape(field.value) << "\"";
+				} else {
+					os << field.value;
+				}
+			}
+			os << "}" << ((record + 1 < records.size()) ? "," : "") << "\n";
+		}
+		os << "]\n";
+		return;
+	}
+
+	// 2.0 CSV has a column for every field seen.  A record without a field leaves its column empty.
+	for (size_t column = 0; column < columns.size(); column++) {
+		os << ((column == 0) ? "" : ",") << columns[column];
+	}
+	os << "\n";
+	for (size_t record = 0; record < records.size(); record++) {
+		for (size_t column = 0; column < columns.size(); column++) {
+			os << ((column == 0) ? "" : ",");
+			for (size_t index = 0; index < records[record].size(); index++) {
+				if (records[record][index].name == columns[column]) {
+					os << records[record][index].value;
+					break;
+				}
+			}
+		}
+		os << "\n";
+	}
+}
@@ -0,0 +1,135 @@
+/**
+ * @file BenchmarkReport.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This class collects the results of a host benchmark and writes them in a machine readable format, so that runs can be compared
+ * to catch regressions.  Each record is one benchmark case, made up of named fields.  The report is written either as CSV, with one
+ * header line covering every field seen, or as a JSON array with one object per record.
+ */
+#ifndef BENCHMARKREPORT_H_
+#define BENCHMARKREPORT_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "LatencyHistogram.h"
+
+class BenchmarkReport {
+private:
+	/**
+	 * This structure is a single named field of a record.
+	 */
+	struct Field {
+		/**
+		 * This is the name of the field.  It is the CSV column and the JSON key.
+		 */
+		std::string name;
+
+		/**
+		 * This is the value of the field, already formatted.
+		 */
+		std::string value;
+
+		/**
+		 * This indicates that the value is text, which is quoted in JSON.
+		 */
+		bool text;
+	};
+
+	/**
+	 * These are the records in the report, in the order they were added.
+	 */
+	std::vector<std::vector<Field> > records;
+
+	/**
+	 * These are the names of every field seen, in the order they were first seen.  They are the CSV columns.
+	 */
+	std::vector<std::string> columns;
+
+	/**
+	 * This indicates that the report is written as JSON rather than CSV.
+	 */
+	bool json;
+
+	/**
+	 * This method will add a field to the current record.
+	 * @param name This is the name of the field.
+	 * @param value This is the formatted value.
+	 * @param text This indicates that the value is text.
+	 */
+	void addField(const std::string &name, const std::string &value, bool text);
+
+	/**
+	 * This method will escape a string so that it can be written inside JSON quotes.
+	 * @param value This is the string.
+	 * @return The escaped string.
+	 */
+	static std::string escape(const std::string &value);
+
+public:
+	/**
+	 * This is the constructor, which creates an empty report.
+	 * @param json If this is true, the report is written as JSON.  Otherwise it is written as CSV.
+	 */
+	BenchmarkReport(bool json);
+
+	/**
+	 * This method will start a new record.  Fields added after this belong to it.
+	 */
+	void beginRecord();
+
+	/**
+	 * This method will add a text field to the current record.
+	 * @param name This is the name of the field.
+	 * @param value This is the value.
+	 */
+	void addText(const std::string &name, const std::string &value);
+
+	/**
+	 * This method will add an integer field to the current record.
+	 * @param name This is the name of the field.
+	 * @param value This is the value.
+	 */
+	void addInteger(const std::string &name, uint64_t value);
+
+	/**
+	 * This method will add a real valued field to the current record.
+	 * @param name This is the name of the field.
+	 * @param value This is the value.
+	 */
+	void addReal(const std::string &name, double value);
+
+	/**
+	 * This method will add the sample count, min, p50, p90, p99, p99.9, max and mean of a histogram to the current record.
+	 * @param prefix This is the prefix of the field names, such as "enqueue_ns".
+	 * @param histogram This is the histogram.
+	 */
+	void addHistogram(const std::string &prefix, LatencyHistogram &histogram);
+
+	/**
+	 * This method will write the report.
+	 * @param os This is the stream that the report is to be written to.
+	 */
+	void write(std::ostream &os);
+};
+
+#endif /* BENCHMARKREPORT_H_ */
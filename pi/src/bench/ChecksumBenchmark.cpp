@@ -0,0 +1,193 @@
+/**
+ * @file ChecksumBenchmark.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This program benchmarks the frame checksums on a Linux host.  It times the legacy XOR of 32 bit words and each CRC32C implementation
+ * over blocks of several sizes, from a single frame up to 64 KiB, and reports the throughput of each in bytes per nanosecond.  Before
+ * timing anything it checks that every CRC32C implementation gives the same result as the bytewise one.
+ * The results are written as CSV, or as JSON with --json.
+ * 
+ * Usage: checksum_benchmark [--json] [--bytes n] [--output file]
+ */
+
+#include "BenchmarkReport.h"
+#include "Crc32c.h"
+#include "NetworkMessage.h"
+#include "time_util.h"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * This is a checksum being benchmarked.
+ */
+typedef uint32_t (*ChecksumMethod)(const void *data, size_t length, uint32_t crc);
+
+/**
+ * These are the block sizes benchmarked, in bytes.  The first is one frame.
+ */
+static const size_t BLOCK_SIZES[] = { sizeof(networkMessageStruct), 256, 4096, 65536 };
+
+/**
+ * This method will calculate the legacy checksum, the XOR of each 32 bit word, so that it can be timed alongside the CRCs.
+ * @param data This is the data.  Its length is taken to be a multiple of four bytes.
+ * @param length This is the number of bytes of data.
+ * @param crc This is the checksum of any data which came before this block.
+ * @return The XOR of the words.
+ */
+static uint32_t legacyXor(const void *data, size_t length, uint32_t crc) {
+	const uint32_t *words = (const uint32_t*) data;
+	for (size_t index = 0; index < length / sizeof(uint32_t); index++) {
+		crc ^= words[index];
+	}
+	return crc;
+}
+
+/**
+ * This method will time one checksum over one block size.
+ * @param report This is the report the result is added to.
+ * @param name This is the name of the checksum.
+ * @param method This is the checksum.
+ * @param buffer This is the data, which is at least totalBytes long.
+ * @param blockSize This is the size of each block checksummed.
+ * @param totalBytes This is the number of bytes to checksum in all.
+ */
+static void benchmarkChecksum(BenchmarkReport &report, const std::string &name, ChecksumMethod method, const std::vector<uint8_t> &buffer,
+		size_t blockSize, size_t totalBytes) {
+	size_t blocks = totalBytes / blockSize;
+	size_t blocksInBuffer = buffer.size() / blockSize;
+	volatile uint32_t sink = 0;
+
+	// 1.0 Checksum each block separately, as the network code does with frames, walking through the buffer.
+	int64_t startTime = getMonotonicTimeNs();
+	for (size_t block = 0; block < blocks; block++) {
+		sink = sink + method(&buffer[(block % blocksInBuffer) * blockSize], blockSize, 0);
+	}
+	int64_t elapsed = getMonotonicTimeNs() - startTime;
+
+	// 2.0 Add the case to the report.
+	report.beginRecord();
+	report.addText("checksum", name);
+	report.addInteger("block_bytes", blockSize);
+	report.addInteger("total_bytes", blocks * blockSize);
+	report.addInteger("elapsed_us", elapsed / 1000);
+	report.addReal("bytes_per_ns", (double) (blocks * blockSize) / (double) elapsed);
+	report.addReal("ns_per_block", (double) elapsed / (double) blocks);
+}
+
+/**
+ * This method will check that an implementation of CRC32C agrees with the bytewise one over every length and alignment of a block.
+ * @param name This is the name of the implementation.
+ * @param method This is the implementation.
+ * @param buffer This is the data.
+ * @return true if the implementation agrees.  False otherwise.
+ */
+static bool checkImplementation(const std::string &name, ChecksumMethod method, const std::vector<uint8_t> &buffer) {
+	for (size_t offset = 0; offset < 8; offset++) {
+		for (size_t length = 0; length < 300; length++) {
+			if (method(&buffer[offset], length, 0) != crc32cBytewise(&buffer[offset], length, 0)) {
+				std::cerr << name << " disagrees with the bytewise CRC32C at offset " << offset << " length " << length << ".\n";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * This method will print how the benchmark is used.
+ */
+static void printUsage() {
+	std::cerr << "Usage: checksum_benchmark [--json] [--bytes n] [--output file]\n";
+}
+
+/**
+ * This is the main program for the checksum benchmark.
+ * @param argc This is the number of arguments.
+ * @param argv These are the arguments.
+ * @return 0 if every implementation agreed.  1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+	size_t totalBytes = 256 * 1024 * 1024;
+	bool json = false;
+	std::string outputFile;
+
+	// 1.0 Parse the command line.
+	for (int index = 1; index < argc; index++) {
+		std::string argument = argv[index];
+		bool hasValue = (index + 1 < argc);
+		if (argument == "--json") {
+			json = true;
+		} else if ((argument == "--bytes") && hasValue) {
+			totalBytes = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--output") && hasValue) {
+			outputFile = argv[++index];
+		} else {
+			printUsage();
+			return 1;
+		}
+	}
+	if (totalBytes < 65536) {
+		printUsage();
+		return 1;
+	}
+
+	// 2.0 Fill a buffer larger than the caches with data, and check the implementations against each other.
+	std::vector<uint8_t> buffer(16 * 1024 * 1024);
+	srand(1);
+	for (size_t index = 0; index < buffer.size(); index++) {
+		buffer[index] = (uint8_t) rand();
+	}
+	bool hardware = crc32cHardwareAvailable();
+	bool succeeded = checkImplementation("slice-by-8", crc32cSliceBy8, buffer);
+	if (hardware) {
+		succeeded &= checkImplementation("hardware", crc32cHardware, buffer);
+	}
+
+	// 3.0 Time each checksum over each block size.
+	BenchmarkReport report(json);
+	for (size_t size = 0; size < sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]); size++) {
+		std::cerr << "checksums over " << BLOCK_SIZES[size] << " byte blocks\n";
+		benchmarkChecksum(report, "legacy_xor", legacyXor, buffer, BLOCK_SIZES[size], totalBytes);
+		benchmarkChecksum(report, "crc32c_bytewise", crc32cBytewise, buffer, BLOCK_SIZES[size], totalBytes / 4);
+		benchmarkChecksum(report, "crc32c_slice_by_8", crc32cSliceBy8, buffer, BLOCK_SIZES[size], totalBytes);
+		if (hardware) {
+			benchmarkChecksum(report, "crc32c_hardware", crc32cHardware, buffer, BLOCK_SIZES[size], totalBytes);
+		}
+	}
+
+	// 4.0 Write the results.
+	if (outputFile.empty()) {
+		report.write(std::cout);
+	} else {
+		std::ofstream output(outputFile.c_str());
+		if (!output) {
+			perror(outputFile.c_str());
+			return 1;
+		}
+		report.write(output);
+	}
+	return succeeded ? 0 : 1;
+}
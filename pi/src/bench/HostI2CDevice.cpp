@@ -0,0 +1,157 @@
+/**
+ * @file HostI2CDevice.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines a host stand-in for the I2C device class.  It is linked in place of I2CDevice.cpp by the host benchmarks.  Each
+ * register write is timestamped and counted rather than sent to a device, and holds a model of the bus for the configured write time.
+ */
+#include "I2CDevice.h"
+#include "HostI2CDevice.h"
+#include "time_util.h"
+#include <atomic>
+#include <mutex>
+#include <time.h>
+#include <errno.h>
+
+/**
+ * This is how long each register write holds the bus, in nanoseconds.
+ */
+static std::atomic<int64_t> writeTime(0);
+
+/**
+ * This is the number of register writes made.
+ */
+static std::atomic<uint64_t> writeCount(0);
+
+/**
+ * This is the time the last register write completed.
+ */
+static std::atomic<int64_t> lastWriteTime(0);
+
+/**
+ * This mutex is the bus.  A write holds it for the write time, so that writes from different threads are serialized.
+ */
+static std::mutex busMutex;
+
+void setHostI2CWriteTime(int64_t duration) {
+	writeTime.store(duration, std::memory_order_relaxed);
+}
+
+uint64_t getHostI2CWriteCount() {
+	return writeCount.load(std::memory_order_relaxed);
+}
+
+int64_t getHostI2CLastWriteTime() {
+	return lastWriteTime.load(std::memory_order_relaxed);
+}
+
+namespace se3910RPi {
+
+/**
+ * This map will provide a mapping between device ID's and the instances which communicate with them.
+ */
+std::map<uint16_t, I2CDevice*> I2CDevice::deviceMaps;
+
+/**
+ * This method will obtain an instance of an I2C device.  If the device ID already has been created, it will return
+ * the existing instance after incrementing the count.  If the device does not exist, a new instance will be instantiated.
+ * @param This is the I2C device ID that is to be accessed.
+ * @return A pointer to the instance will be returned.
+ */
+I2CDevice* I2CDevice::obtainDeviceInstance(uint16_t deviceID)
+{
+	if (deviceMaps.find(deviceID) == deviceMaps.end())
+	{
+		deviceMaps.insert(std::make_pair(deviceID, new I2CDevice(deviceID)));
+		deviceMaps[deviceID]->init();
+	}
+	deviceMaps[deviceID]->count++;
+	return deviceMaps[deviceID];
+}
+
+/**
+ * Constructor for the stand-in.  There is no bus to open.
+ * @param device The device ID on the bus.
+ */
+I2CDevice::I2CDevice(uint16_t device) {
+	this->count = 0;
+	this->file = -1;
+	this->device = device;
+}
+
+/**
+ * This method marks the stand-in as open.
+ * @return 0, since it cannot fail.
+ */
+int I2CDevice::init() {
+	this->file = 0;
+	return 0;
+}
+
+/**
+ * This method will count and timestamp a write which is not to a register.
+ * @param value the value to write to the device.  It is discarded.
+ * @return 0.
+ */
+int I2CDevice::write(uint8_t value) {
+	return writeRegister(0, value);
+}
+
+/**
+ * This method will hold the bus for the write time, then count the write and timestamp it.
+ * @param registerAddress The register address.  It is discarded.
+ * @param value The value to be written to the register.  It is discarded.
+ * @return 0.
+ */
+int I2CDevice::writeRegister(uint16_t registerAddress, uint8_t value)
+{
+	std::lock_guard<std::mutex> guard(busMutex);
+	int64_t duration = writeTime.load(std::memory_order_relaxed);
+	if (duration > 0) {
+		struct timespec deadline = nsToTimespec(getMonotonicTimeNs() + duration);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+		}
+	}
+	writeCount.fetch_add(1, std::memory_order_relaxed);
+	lastWriteTime.store(getMonotonicTimeNs(), std::memory_order_relaxed);
+	return 0;
+}
+
+/**
+ * The stand-in has no registers to read.
+ * @param registerAddress the address to read from.
+ * @return 0.
+ */
+uint8_t I2CDevice::readRegister(uint16_t registerAddress) {
+	return 0;
+}
+
+/**
+ * This method marks the stand-in as closed.
+ */
+void I2CDevice::shutdown() {
+	this->file = -1;
+}
+
+I2CDevice::~I2CDevice() {
+}
+
+} /*  */
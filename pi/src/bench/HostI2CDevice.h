@@ -0,0 +1,52 @@
+/**
+ * @file HostI2CDevice.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file declares the controls of the host stand-in for the I2C bus.  The host benchmarks link HostI2CDevice.cpp in place of
+ * I2CDevice.cpp, so the PCA9685 driver and the motor controllers run unchanged on a Linux host with no I2C bus.  Instead of reaching a
+ * device, each register write is timestamped and counted, and it can be made to hold the bus for as long as a write takes on the robot.
+ */
+#ifndef HOSTI2CDEVICE_H_
+#define HOSTI2CDEVICE_H_
+
+#include <stdint.h>
+
+/**
+ * This method will set how long each register write holds the stand-in bus, to model the time a write takes on the real I2C bus.  A
+ * register write is 3 bytes on the wire, which is about 270us at the Raspberry Pi's default 100kHz.  Writes from different threads
+ * are serialized, as they are on the real bus.
+ * @param duration This is the time each write takes, in nanoseconds.  0, the default, returns at once.
+ */
+void setHostI2CWriteTime(int64_t duration);
+
+/**
+ * This method will return the number of register writes made to every stand-in device.
+ * @return The number of writes.
+ */
+uint64_t getHostI2CWriteCount();
+
+/**
+ * This method will return the time the last register write to any stand-in device completed.
+ * @return The time, from the monotonic clock in nanoseconds, or 0 if nothing has been written.
+ */
+int64_t getHostI2CLastWriteTime();
+
+#endif /* HOSTI2CDEVICE_H_ */
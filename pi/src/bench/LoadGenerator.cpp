@@ -0,0 +1,600 @@
+/**
+ * @file LoadGenerator.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This program puts a command load on the robot's control chain on a Linux host, and measures how many commands per second the chain
+ * absorbs and how long each takes to reach the motors.  It builds the chain as main does: the network manager, the command queues, and the
+ * robot controller with its motor controllers.  It links the timestamping I2C stand-in in place of the I2C bus, so the PCA9685 driver runs
+ * unchanged.  Client threads connect over the loopback interface.  Each sends command messages at its share of the rate, in bursts, with
+ * a weighted mix of speed, steering, direction and stop commands.  Every message carries a unique ID, and its send time is kept against
+ * that ID.  A sampler polls the motors for the commands which reached the hardware, and matches each to its send time.
+ * For each rate, it reports the commands sent, received and actuated.  It also reports percentiles of the time from the send to the
+ * receive, from the receive to the dequeue, from the dequeue to the PWM write, and from the send to the PWM write.  Each motor which
+ * carries out a command gives a sample.  The results are written as CSV, or as JSON with --json.
+ * 
+ * Usage: load_generator [--json] [--fifo] [--udp] [--legacy] [--rate n[,n...]] [--duration s] [--burst n] [--clients n]
+ *                       [--mix speed,steering,direction,stop] [--i2c-write-us n] [--port n] [--output file]
+ */
+
+#include "BenchmarkReport.h"
+#include "bench_util.h"
+#include "HostI2CDevice.h"
+#include "CommandQueue.h"
+#include "NetworkManager.h"
+#include "NetworkFrame.h"
+#include "NetworkCommands.h"
+#include "NetworkCfg.h"
+#include "QueueCfg.h"
+#include "TaskRates.h"
+#include "RobotController.h"
+#include "time_util.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * This is the largest number of clients.  It is the most the network manager serves.
+ */
+#define MAX_LOAD_CLIENTS (MAX_NETWORK_CLIENTS)
+
+/**
+ * This is the number of motors the robot controller drives.
+ */
+#define LOAD_MOTORS (4)
+
+/**
+ * These macros define the kinds of command in the mix, in the order of the --mix weights.
+ */
+#define LOAD_SPEED_COMMAND (0)
+#define LOAD_STEERING_COMMAND (1)
+#define LOAD_DIRECTION_COMMAND (2)
+#define LOAD_STOP_COMMAND (3)
+#define LOAD_COMMAND_KINDS (4)
+
+/**
+ * This is how often the sampler polls the motors for commands which reached the hardware, in nanoseconds.  It is well under the motor
+ * period, so no actuation is missed.
+ */
+#define ACTUATION_POLL_NS (100000)
+
+/**
+ * This is the longest the generator waits, once sending has finished, for the robot to receive what was sent, in nanoseconds.
+ */
+#define DRAIN_TIMEOUT_NS (2000000000LL)
+
+/**
+ * This structure holds the settings for a run, taken from the command line.
+ */
+struct LoadSettings {
+	/**
+	 * These are the rates the load is offered at, in commands per second across all of the clients.  Each is a separate case.
+	 */
+	std::vector<uint32_t> rates;
+
+	/**
+	 * This is how long each case sends for, in seconds.
+	 */
+	uint32_t duration = 5;
+
+	/**
+	 * This is the number of commands each client sends back to back.  The bursts are spaced so that the rate is kept.
+	 */
+	uint32_t burst = 1;
+
+	/**
+	 * This is the number of clients.
+	 */
+	int clients = 1;
+
+	/**
+	 * These are the relative weights of each kind of command in the mix, indexed by the LOAD_COMMAND values.
+	 */
+	uint32_t mix[LOAD_COMMAND_KINDS] = { 60, 20, 15, 5 };
+
+	/**
+	 * This is how long each register write holds the stand-in I2C bus, in nanoseconds.
+	 */
+	int64_t i2cWriteTime = 0;
+
+	/**
+	 * This indicates that the commands are sent in datagrams to the UDP command port, rather than over TCP connections.
+	 */
+	bool udp = false;
+
+	/**
+	 * This indicates that the commands are sent in legacy frames, rather than CRC32C frames.
+	 */
+	bool legacy = false;
+
+	/**
+	 * This indicates that the robot's threads run under SCHED_FIFO at the priorities they have on the robot.
+	 */
+	bool fifo = false;
+
+	/**
+	 * This is the loopback port used for TCP.  The UDP command port is the one after it.
+	 */
+	unsigned short port = 19290;
+};
+
+/**
+ * This class is the robot controller with its motors exposed, so that the sampler can see which commands reached them.
+ */
+class LoadRobotController: public RobotController {
+public:
+	/**
+	 * This is the constructor.  The motors are left free to run on any CPU, since the robot's CPU layout does not apply to the host.
+	 * @param queue This is the queue of commands for the controller.
+	 * @param hornQueue This is the queue the controller sends horn commands to.
+	 * @param threadName This is the name of the thread.
+	 */
+	LoadRobotController(CommandQueue *queue, CommandQueue *hornQueue, std::string threadName) :
+			RobotController(queue, hornQueue, threadName) {
+		for (int index = 0; index < LOAD_MOTORS; index++) {
+			getMotor(index)->setAffinity(0);
+		}
+	}
+
+	/**
+	 * This method will return one of the motors.
+	 * @param index This is the index of the motor, from 0 to LOAD_MOTORS - 1.
+	 * @return The motor.
+	 */
+	MotorController* getMotor(int index) {
+		MotorController *motors[LOAD_MOTORS] = { leftFrontMotor, leftRearMotor, rightFrontMotor, rightRearMotor };
+		return motors[index];
+	}
+};
+
+/**
+ * This method will step a xorshift random number generator, so that each client's command mix is random but repeatable.
+ * @param state This is the state of the generator.  It must not be 0.
+ * @return The next random number.
+ */
+static uint32_t nextRandom(uint32_t &state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+/**
+ * This method will pick the next command of the mix.
+ * @param settings This is the run settings, which hold the mix.
+ * @param state This is the state of the client's random number generator.
+ * @return The command word.
+ */
+static int buildCommand(const LoadSettings &settings, uint32_t &state) {
+	static const int directions[] = { FORWARD, BACKWARD, LEFT, RIGHT, FORWARD + LEFT, FORWARD + RIGHT };
+	uint32_t total = 0;
+	for (int kind = 0; kind < LOAD_COMMAND_KINDS; kind++) {
+		total += settings.mix[kind];
+	}
+
+	uint32_t pick = nextRandom(state) % total;
+	int kind = 0;
+	while (pick >= settings.mix[kind]) {
+		pick -= settings.mix[kind];
+		kind++;
+	}
+
+	uint32_t value = nextRandom(state);
+	if (kind == LOAD_SPEED_COMMAND) {
+		return SPEEDDIRECTIONBITMAP | (value % 1001);
+	} else if (kind == LOAD_STEERING_COMMAND) {
+		return STEERINGOFFSETBITMAP | (value % 201);
+	} else if (kind == LOAD_DIRECTION_COMMAND) {
+		return MOTORDIRECTIONBITMAP | directions[value % (sizeof(directions) / sizeof(directions[0]))];
+	}
+	return MOTORDIRECTIONBITMAP | STOP;
+}
+
+/**
+ * This method will open a client's socket.  A TCP client is connected to the network manager.  A UDP client is a datagram socket
+ * connected to the command port, so that each send is one datagram.
+ * @param settings This is the run settings.
+ * @return The socket, or -1 if it could not be opened.
+ */
+static int openClient(const LoadSettings &settings) {
+	if (!settings.udp) {
+		return connectLoopbackClient(settings.port);
+	}
+
+	int clientSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (clientSocket < 0) {
+		perror("socket");
+		return -1;
+	}
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(settings.port + 1);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(clientSocket, (struct sockaddr*) &address, sizeof(address)) < 0) {
+		perror("connect");
+		close(clientSocket);
+		return -1;
+	}
+	return clientSocket;
+}
+
+/**
+ * This method will run the load at one rate against a freshly built control chain, and add the case to the report.
+ * @param report This is the report the results are added to.
+ * @param settings This is the run settings.
+ * @param rate This is the rate, in commands per second across all of the clients.
+ * @return true if the case ran.  False if the clients could not connect.
+ */
+static bool runLoad(BenchmarkReport &report, const LoadSettings &settings, uint32_t rate) {
+	/**
+	 * 1.0 Build the control chain as main does.  The horn queue is not drained, so it drops its oldest commands rather than blocking
+	 * the controller.
+	 */
+	CommandQueue *queues[NUMBER_OF_QUEUES];
+	queues[0] = new CommandQueue(ROBOT_CONTROLLER_QUEUE_IMPLEMENTATION, ROBOT_CONTROLLER_QUEUE_CAPACITY, RobotController::classifyCommand,
+			ROBOT_CONTROLLER_QUEUE_FLUSH_SUPERSEDED, ROBOT_CONTROLLER_QUEUE_COALESCING ? RobotController::coalescingKey : NULL,
+			ROBOT_CONTROLLER_QUEUE_OVERFLOW_POLICY);
+	queues[1] = new CommandQueue(HORN_QUEUE_IMPLEMENTATION, HORN_QUEUE_CAPACITY, NULL, false, NULL, OVERFLOW_DROP_OLDEST);
+	queues[2] = new CommandQueue(LINE_SENSOR_QUEUE_IMPLEMENTATION, LINE_SENSOR_QUEUE_CAPACITY, NULL, false, NULL,
+			LINE_SENSOR_QUEUE_OVERFLOW_POLICY);
+	NetworkManager receiver(settings.port, queues, "Load Receiver", settings.udp ? (settings.port + 1) : 0);
+	LoadRobotController controller(queues[0], queues[1], "Load Controller");
+	setHostI2CWriteTime(settings.i2cWriteTime);
+	if (settings.fifo) {
+		receiver.start(NETWORK_RECEPTION_TASK_PRIORITY);
+		controller.start(MOTOR_CTRL_TASK_PRIORITY - 1);
+	} else {
+		receiver.start();
+		controller.start();
+	}
+
+	/**
+	 * 2.0 Open the clients.  TCP clients are only counted once the network manager has accepted them.
+	 */
+	std::vector<int> sockets;
+	for (int index = 0; index < settings.clients; index++) {
+		int clientSocket = openClient(settings);
+		if (clientSocket >= 0) {
+			sockets.push_back(clientSocket);
+		}
+	}
+	int64_t deadline = getMonotonicTimeNs() + 2000000000LL;
+	while ((!settings.udp) && (receiver.getClientCount() < sockets.size()) && (getMonotonicTimeNs() < deadline)) {
+		sleepForNs(1000000);
+	}
+	bool connected = ((int) sockets.size() == settings.clients) && ((settings.udp) || ((int) receiver.getClientCount() == settings.clients));
+
+	/**
+	 * 3.0 The send time of each message is kept against its ID, which the envelope carries through to the motors.  IDs start at 1,
+	 * since 0 marks a command which did not come from the network.
+	 */
+	uint64_t capacity = ((uint64_t) rate * settings.duration) + ((uint64_t) settings.burst * settings.clients) + 1;
+	std::vector<std::atomic<int64_t> > sendTimes(capacity);
+	std::atomic<uint32_t> nextMessageID(1);
+	std::atomic<uint64_t> sentCount(0);
+	std::atomic<bool> sampling(true);
+	LatencyHistogram networkHistogram;
+	LatencyHistogram queueHistogram;
+	LatencyHistogram pwmHistogram;
+	LatencyHistogram endToEndHistogram;
+	uint64_t actuations = 0;
+	uint64_t startReceived = receiver.getReceivedMessageCount();
+	uint64_t startWrites = getHostI2CWriteCount();
+	int64_t startTime = getMonotonicTimeNs() + 10000000LL;
+	int64_t endTime = startTime + (int64_t) settings.duration * 1000000000LL;
+	int64_t drainTime = endTime;
+
+	if (connected) {
+		/**
+		 * 4.0 The sampler matches each command which reaches a motor to the time it was sent.  The same command is only counted once per
+		 * motor, even if the sampler sees it twice.
+		 */
+		std::thread sampler([&]() {
+			uint32_t lastCount[LOAD_MOTORS] = { 0 };
+			int32_t lastID[LOAD_MOTORS] = { 0 };
+			CommandEnvelope envelope;
+			while (sampling.load(std::memory_order_acquire)) {
+				for (int motor = 0; motor < LOAD_MOTORS; motor++) {
+					uint32_t count = controller.getMotor(motor)->getActuatedCommand(envelope);
+					if ((count == lastCount[motor]) || (envelope.messageID == lastID[motor])) {
+						continue;
+					}
+					lastCount[motor] = count;
+					lastID[motor] = envelope.messageID;
+					if ((envelope.messageID <= 0) || ((uint64_t) envelope.messageID >= capacity)) {
+						continue;
+					}
+					int64_t sendTime = sendTimes[envelope.messageID].load(std::memory_order_acquire);
+					if (sendTime == 0) {
+						continue;
+					}
+					networkHistogram.record(envelope.receiveTime - sendTime);
+					queueHistogram.record(envelope.dequeueTime - envelope.receiveTime);
+					pwmHistogram.record(envelope.actuationTime - envelope.dequeueTime);
+					endToEndHistogram.record(envelope.actuationTime - sendTime);
+					actuations++;
+				}
+				sleepForNs(ACTUATION_POLL_NS);
+			}
+		});
+
+		/**
+		 * 5.0 Each client sends its share of the rate in bursts, on an absolute schedule so that it does not drift.  The clients are
+		 * staggered across the burst interval.  A client which falls behind, because the robot is not taking its messages, sends as fast
+		 * as it can until it has caught up, so the rate it reached is reported as well as the rate offered.
+		 */
+		int64_t interval = (1000000000LL * settings.burst * settings.clients) / rate;
+		int frameVersion = settings.legacy ? FRAME_VERSION_LEGACY : FRAME_VERSION_CRC32C;
+		std::vector<std::thread> senders;
+		for (int index = 0; index < settings.clients; index++) {
+			int clientSocket = sockets[index];
+			senders.push_back(std::thread([&, index, clientSocket]() {
+				std::vector<networkMessageStruct> messages(settings.burst);
+				uint32_t randomState = 0x9E3779B9u + index;
+				int64_t release = startTime + ((interval * index) / settings.clients);
+
+				while (release < endTime) {
+					struct timespec releaseTime = nsToTimespec(release);
+					while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &releaseTime, NULL) == EINTR) {
+					}
+					release += interval;
+
+					uint32_t firstID = nextMessageID.fetch_add(settings.burst, std::memory_order_relaxed);
+					if ((uint64_t) firstID + settings.burst > capacity) {
+						break;
+					}
+					int64_t sendTime = getMonotonicTimeNs();
+					for (uint32_t burstIndex = 0; burstIndex < settings.burst; burstIndex++) {
+						networkMessageStruct &message = messages[burstIndex];
+						memset(&message, 0, sizeof(message));
+						message.messageID = firstID + burstIndex;
+						message.timestampHigh = (int32_t) (sendTime >> 32);
+						message.timestampLow = (int32_t) sendTime;
+						message.messageType = COMMAND_MSG_TYPE;
+						message.messageDestination = MOTOR_CONTROL_DESTINATION;
+						message.message = buildCommand(settings, randomState);
+						message.xorChecksum = message.messageID ^ message.timestampHigh ^ message.timestampLow ^ message.messageType
+								^ message.message ^ message.messageDestination;
+						encodeFrame(message, frameVersion);
+						sendTimes[firstID + burstIndex].store(sendTime, std::memory_order_release);
+					}
+
+					// A TCP burst is one send.  Each UDP message is its own datagram.
+					if (settings.udp) {
+						for (uint32_t burstIndex = 0; burstIndex < settings.burst; burstIndex++) {
+							send(clientSocket, &messages[burstIndex], sizeof(networkMessageStruct), 0);
+						}
+					} else {
+						send(clientSocket, messages.data(), settings.burst * sizeof(networkMessageStruct), 0);
+					}
+					sentCount.fetch_add(settings.burst, std::memory_order_relaxed);
+				}
+			}));
+		}
+		for (size_t index = 0; index < senders.size(); index++) {
+			senders[index].join();
+		}
+
+		/**
+		 * 6.0 Wait for the robot to receive what was sent, then for two motor periods so that the last commands reach the hardware.
+		 */
+		int64_t timeout = getMonotonicTimeNs() + DRAIN_TIMEOUT_NS;
+		while (((receiver.getReceivedMessageCount() - startReceived) < sentCount.load()) && (getMonotonicTimeNs() < timeout)) {
+			sleepForNs(100000);
+		}
+		drainTime = getMonotonicTimeNs();
+		sleepForNs(2000LL * MOTOR_CTRL_TASK_PERIOD);
+		sampling.store(false, std::memory_order_release);
+		sampler.join();
+	}
+	uint64_t sent = sentCount.load();
+	uint64_t received = receiver.getReceivedMessageCount() - startReceived;
+	uint64_t writes = getHostI2CWriteCount() - startWrites;
+
+	/**
+	 * 7.0 Shut everything down.
+	 */
+	for (size_t index = 0; index < sockets.size(); index++) {
+		close(sockets[index]);
+	}
+	controller.stop();
+	receiver.stop();
+	controller.waitForShutdown();
+	receiver.waitForShutdown();
+	for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+		delete queues[index];
+	}
+	if (!connected) {
+		std::cerr << "Could not connect " << settings.clients << " clients on port " << settings.port << ".\n";
+		return false;
+	}
+
+	/**
+	 * 8.0 Add the case to the report.
+	 */
+	std::ostringstream mix;
+	for (int kind = 0; kind < LOAD_COMMAND_KINDS; kind++) {
+		mix << ((kind > 0) ? ":" : "") << settings.mix[kind];
+	}
+	double sendSeconds = (endTime - startTime) / 1e9;
+	double receiveSeconds = (drainTime - startTime) / 1e9;
+	report.beginRecord();
+	report.addText("transport", settings.udp ? "udp" : "tcp");
+	report.addText("frames", settings.legacy ? "legacy" : "crc32c");
+	report.addText("scheduling", settings.fifo ? "fifo" : "other");
+	report.addInteger("clients", settings.clients);
+	report.addInteger("burst", settings.burst);
+	report.addText("mix", mix.str());
+	report.addInteger("i2c_write_us", settings.i2cWriteTime / 1000);
+	report.addInteger("offered_per_sec", rate);
+	report.addInteger("sent", sent);
+	report.addReal("sent_per_sec", sent / sendSeconds);
+	report.addInteger("received", received);
+	report.addReal("received_per_sec", received / receiveSeconds);
+	report.addInteger("lost", (sent > received) ? (sent - received) : 0);
+	report.addInteger("actuations", actuations);
+	report.addReal("i2c_writes_per_sec", writes / receiveSeconds);
+	report.addHistogram("network_ns", networkHistogram);
+	report.addHistogram("queue_ns", queueHistogram);
+	report.addHistogram("pwm_ns", pwmHistogram);
+	report.addHistogram("end_to_end_ns", endToEndHistogram);
+	return true;
+}
+
+/**
+ * This method will parse a comma separated list of numbers.
+ * @param text This is the list.
+ * @param values This is where the numbers are added.
+ * @return true if every entry is a number.  False otherwise.
+ */
+static bool parseList(const std::string &text, std::vector<uint32_t> &values) {
+	std::istringstream stream(text);
+	std::string entry;
+	while (std::getline(stream, entry, ',')) {
+		char *end;
+		unsigned long value = strtoul(entry.c_str(), &end, 0);
+		if ((entry.empty()) || (*end != '\0')) {
+			return false;
+		}
+		values.push_back((uint32_t) value);
+	}
+	return !values.empty();
+}
+
+/**
+ * This method will print how the load generator is used.
+ */
+static void printUsage() {
+	std::cerr << "Usage: load_generator [--json] [--fifo] [--udp] [--legacy] [--rate n[,n...]] [--duration s] [--burst n] [--clients n]\n"
+			<< "                      [--mix speed,steering,direction,stop] [--i2c-write-us n] [--port n] [--output file]\n";
+}
+
+/**
+ * This is the main program for the load generator.
+ * @param argc This is the number of arguments.
+ * @param argv These are the arguments.
+ * @return 0 if every case ran.  1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+	LoadSettings settings;
+	std::vector<uint32_t> mix;
+	bool json = false;
+	std::string outputFile;
+
+	// 1.0 Parse the command line.
+	for (int index = 1; index < argc; index++) {
+		std::string argument = argv[index];
+		bool hasValue = (index + 1 < argc);
+		if (argument == "--json") {
+			json = true;
+		} else if (argument == "--fifo") {
+			settings.fifo = true;
+		} else if (argument == "--udp") {
+			settings.udp = true;
+		} else if (argument == "--legacy") {
+			settings.legacy = true;
+		} else if ((argument == "--rate") && hasValue) {
+			if (!parseList(argv[++index], settings.rates)) {
+				printUsage();
+				return 1;
+			}
+		} else if ((argument == "--duration") && hasValue) {
+			settings.duration = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--burst") && hasValue) {
+			settings.burst = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--clients") && hasValue) {
+			settings.clients = atoi(argv[++index]);
+		} else if ((argument == "--mix") && hasValue) {
+			if ((!parseList(argv[++index], mix)) || (mix.size() != LOAD_COMMAND_KINDS)) {
+				printUsage();
+				return 1;
+			}
+		} else if ((argument == "--i2c-write-us") && hasValue) {
+			settings.i2cWriteTime = 1000LL * strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--port") && hasValue) {
+			settings.port = (unsigned short) atoi(argv[++index]);
+		} else if ((argument == "--output") && hasValue) {
+			outputFile = argv[++index];
+		} else {
+			printUsage();
+			return 1;
+		}
+	}
+	uint32_t mixTotal = 0;
+	for (size_t kind = 0; kind < mix.size(); kind++) {
+		settings.mix[kind] = mix[kind];
+		mixTotal += mix[kind];
+	}
+	if (settings.rates.empty()) {
+		settings.rates.push_back(1000);
+		settings.rates.push_back(5000);
+		settings.rates.push_back(20000);
+	}
+	bool ratesValid = true;
+	for (size_t index = 0; index < settings.rates.size(); index++) {
+		ratesValid &= (settings.rates[index] >= (uint32_t) settings.clients);
+	}
+	if ((settings.clients < 1) || (settings.clients > MAX_LOAD_CLIENTS) || (settings.burst == 0) || (settings.duration == 0)
+			|| ((!mix.empty()) && (mixTotal == 0)) || (!ratesValid)) {
+		printUsage();
+		return 1;
+	}
+
+	// 2.0 Fall back to normal scheduling if real time scheduling is not permitted, and say so in the results.
+	if ((settings.fifo) && (!realTimeSchedulingAvailable())) {
+		std::cerr << "SCHED_FIFO is not permitted, so the robot's threads run under SCHED_OTHER.\n";
+		settings.fifo = false;
+	}
+
+	// 3.0 Run the load at each rate.
+	BenchmarkReport report(json);
+	bool succeeded = true;
+	for (size_t index = 0; index < settings.rates.size(); index++) {
+		std::cerr << "load at " << settings.rates[index] << " commands per second\n";
+		succeeded &= runLoad(report, settings, settings.rates[index]);
+	}
+
+	// 4.0 Write the results.
+	if (outputFile.empty()) {
+		report.write(std::cout);
+	} else {
+		std::ofstream output(outputFile.c_str());
+		if (!output) {
+			perror(outputFile.c_str());
+			return 1;
+		}
+		report.write(output);
+	}
+	return succeeded ? 0 : 1;
+}
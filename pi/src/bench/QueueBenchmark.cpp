@@ -0,0 +1,511 @@
+/**
+ * @file QueueBenchmark.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This program benchmarks the command queue implementations and the network transmission queue on a Linux host, without any of the
+ * robot hardware.  For each implementation and for 1 to 4 producer threads, it measures:
+ *   - throughput, with every producer enqueueing as fast as it can against one consumer,
+ *   - the latency of each enqueue, and of each dequeue which did not have to wait,
+ *   - the wakeup latency, from a paced enqueue to the blocked consumer having the command.
+ * The transmission queue is driven through a real NetworkManager and NetworkTransmissionManager over the loopback interface, so its
+ * wakeup latency is measured as delivery latency, from the enqueue to the message arriving at the client socket.
+ * With --fifo, producer n runs at SCHED_FIFO priority PRODUCER_BASE_PRIORITY + n and the consumer above them all.
+ * The results are written as CSV, or as JSON with --json, so that runs can be compared to catch regressions.
+ * 
+ * Usage: queue_benchmark [--json] [--fifo] [--operations n] [--wakeups n] [--producers n] [--capacity n] [--port n] [--no-network]
+ *                        [--output file]
+ */
+
+#include "BenchmarkReport.h"
+#include "bench_util.h"
+#include "CommandQueue.h"
+#include "NetworkManager.h"
+#include "NetworkTransmissionManager.h"
+#include "NetworkFrame.h"
+#include "LatencyHistogram.h"
+#include "QueueCfg.h"
+#include "time_util.h"
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * This is the largest number of producer threads which are benchmarked.
+ */
+#define MAX_PRODUCERS (4)
+
+/**
+ * These are the SCHED_FIFO priorities used with --fifo.  Producer n runs at PRODUCER_BASE_PRIORITY + n, and the consumer runs above
+ * every producer, as the robot controller does above the threads which feed it.
+ */
+#define PRODUCER_BASE_PRIORITY (40)
+#define CONSUMER_PRIORITY (60)
+
+/**
+ * This is the time between the paced enqueues of the wakeup benchmark, in nanoseconds.  It is long enough for the consumer to block.
+ */
+#define WAKEUP_PACING_NS (200000)
+
+/**
+ * This is the longest the benchmark waits for the transmission queue to deliver a phase's messages, in nanoseconds.
+ */
+#define DELIVERY_TIMEOUT_NS (30000000000LL)
+
+/**
+ * This structure holds the settings for a benchmark run, taken from the command line.
+ */
+struct BenchmarkSettings {
+	/**
+	 * This is the number of commands each producer enqueues in the throughput benchmark.
+	 */
+	uint32_t operations = 200000;
+
+	/**
+	 * This is the total number of paced commands in the wakeup benchmark.
+	 */
+	uint32_t wakeups = 2000;
+
+	/**
+	 * This is the largest number of producers benchmarked.
+	 */
+	int maxProducers = MAX_PRODUCERS;
+
+	/**
+	 * This is the capacity of each queue level.
+	 */
+	uint32_t capacity = COMMAND_QUEUE_CAPACITY;
+
+	/**
+	 * This indicates that the benchmark threads run under SCHED_FIFO.
+	 */
+	bool fifo = false;
+
+	/**
+	 * This indicates that the transmission queue is benchmarked.
+	 */
+	bool network = true;
+
+	/**
+	 * This is the loopback port used for the transmission queue benchmark.
+	 */
+	unsigned short port = 19090;
+};
+
+/**
+ * These are the names of the command queue implementations, in the order of their QueueCfg.h values.
+ */
+static const char *implementationNames[] = { "locked", "mpsc", "spsc" };
+
+/**
+ * This method will run a set of producer threads against one consumer thread, releasing them all at once.
+ * @param settings This is the benchmark settings.
+ * @param producers This is the number of producer threads.
+ * @param producer This is the body of a producer.  It is passed the index of the producer.
+ * @param consumer This is the body of the consumer.
+ * @return The time from the threads being released to the last of them finishing, in nanoseconds.
+ */
+static int64_t runThreads(const BenchmarkSettings &settings, int producers, std::function<void(int)> producer,
+		std::function<void()> consumer) {
+	std::atomic<int> readyCount(0);
+	std::atomic<bool> released(false);
+	std::vector<std::thread> threads;
+
+	// 1.0 Start every thread, and let each one set its own priority before it waits at the start line.
+	threads.push_back(std::thread([&]() {
+		if (settings.fifo) {
+			setThreadPriority(CONSUMER_PRIORITY);
+		}
+		readyCount.fetch_add(1);
+		while (!released.load(std::memory_order_acquire)) {
+			sched_yield();
+		}
+		consumer();
+	}));
+	for (int index = 0; index < producers; index++) {
+		threads.push_back(std::thread([&, index]() {
+			if (settings.fifo) {
+				setThreadPriority(PRODUCER_BASE_PRIORITY + index);
+			}
+			readyCount.fetch_add(1);
+			while (!released.load(std::memory_order_acquire)) {
+				sched_yield();
+			}
+			producer(index);
+		}));
+	}
+
+	// 2.0 Release them together once they are all waiting, and time until the last one finishes.
+	while (readyCount.load() < producers + 1) {
+		sched_yield();
+	}
+	int64_t startTime = getMonotonicTimeNs();
+	released.store(true, std::memory_order_release);
+	for (size_t index = 0; index < threads.size(); index++) {
+		threads[index].join();
+	}
+	return getMonotonicTimeNs() - startTime;
+}
+
+/**
+ * This method will add the fields which identify a benchmark case to a new record.
+ * @param report This is the report.
+ * @param settings This is the benchmark settings.
+ * @param suite This is the name of the queue being benchmarked.
+ * @param implementation This is the name of its implementation.
+ * @param producers This is the number of producers.
+ */
+static void beginCase(BenchmarkReport &report, const BenchmarkSettings &settings, const std::string &suite,
+		const std::string &implementation, int producers) {
+	report.beginRecord();
+	report.addText("suite", suite);
+	report.addText("implementation", implementation);
+	report.addInteger("producers", producers);
+	report.addText("scheduling", settings.fifo ? "fifo" : "other");
+	report.addInteger("capacity", settings.capacity);
+}
+
+/**
+ * This method will benchmark one command queue implementation with the given number of producers.
+ * @param report This is the report the results are added to.
+ * @param settings This is the benchmark settings.
+ * @param implementation This is the queue implementation.  It is one of the command queue implementations in QueueCfg.h.
+ * @param producers This is the number of producers.
+ */
+static void benchmarkCommandQueue(BenchmarkReport &report, const BenchmarkSettings &settings, int implementation, int producers) {
+	uint64_t total = (uint64_t) producers * settings.operations;
+	LatencyHistogram enqueueHistograms[MAX_PRODUCERS];
+	LatencyHistogram enqueueHistogram;
+	LatencyHistogram dequeueHistogram;
+	LatencyHistogram wakeupHistogram;
+	std::atomic<uint32_t> errors(0);
+
+	// 1.0 Throughput.  Every producer enqueues as fast as it can.  The consumer times each dequeue which found a command waiting, and
+	// checks that each producer's commands arrive in order.
+	CommandQueue saturatedQueue(implementation, settings.capacity);
+	int64_t elapsed = runThreads(settings, producers, [&](int index) {
+		for (uint32_t operation = 0; operation < settings.operations; operation++) {
+			int64_t startTime = getMonotonicTimeNs();
+			saturatedQueue.enqueue((index << 24) | operation);
+			enqueueHistograms[index].record(getMonotonicTimeNs() - startTime);
+		}
+	}, [&]() {
+		int64_t lastSeen[MAX_PRODUCERS] = { -1, -1, -1, -1 };
+		uint64_t received = 0;
+		while (received < total) {
+			int value;
+			int64_t startTime = getMonotonicTimeNs();
+			if (saturatedQueue.tryDequeue(value)) {
+				dequeueHistogram.record(getMonotonicTimeNs() - startTime);
+			} else if (!saturatedQueue.dequeueFor(value, 100000)) {
+				continue;
+			}
+			int index = (value >> 24) & 0xFF;
+			int64_t operation = value & 0xFFFFFF;
+			if ((index >= MAX_PRODUCERS) || (operation <= lastSeen[index])) {
+				errors.fetch_add(1);
+			} else {
+				lastSeen[index] = operation;
+			}
+			received++;
+		}
+	});
+	for (int index = 0; index < producers; index++) {
+		enqueueHistogram.merge(enqueueHistograms[index]);
+	}
+
+	// 2.0 Wakeup latency.  The producers pace their commands so that the consumer is blocked when each arrives, and the queue stamps
+	// the enqueue and dequeue times into the envelope.
+	CommandQueue pacedQueue(implementation, settings.capacity);
+	uint32_t perProducer = (settings.wakeups + producers - 1) / producers;
+	runThreads(settings, producers, [&](int index) {
+		// Stagger the producers so that their commands do not all land together.
+		sleepForNs((WAKEUP_PACING_NS / MAX_PRODUCERS) * index);
+		for (uint32_t operation = 0; operation < perProducer; operation++) {
+			pacedQueue.enqueue((index << 24) | operation);
+			sleepForNs(WAKEUP_PACING_NS);
+		}
+	}, [&]() {
+		uint64_t pacedTotal = (uint64_t) perProducer * producers;
+		for (uint64_t received = 0; received < pacedTotal;) {
+			CommandEnvelope envelope;
+			if (pacedQueue.dequeueFor(envelope, 100000)) {
+				wakeupHistogram.record(envelope.dequeueTime - envelope.enqueueTime);
+				received++;
+			}
+		}
+	});
+
+	// 3.0 Add the case to the report.
+	beginCase(report, settings, "command_queue", implementationNames[implementation], producers);
+	report.addInteger("operations", total);
+	report.addInteger("elapsed_us", elapsed / 1000);
+	report.addReal("ops_per_sec", total / (elapsed / 1e9));
+	report.addInteger("errors", errors.load());
+	report.addHistogram("enqueue_ns", enqueueHistogram);
+	report.addHistogram("dequeue_ns", dequeueHistogram);
+	report.addHistogram("wakeup_ns", wakeupHistogram);
+}
+
+/**
+ * This method will benchmark the transmission queue of the network transmission manager, for each number of producers.  The messages
+ * are sent over a loopback connection to a client thread, which counts them and measures how long each paced message took to arrive.
+ * @param report This is the report the results are added to.
+ * @param settings This is the benchmark settings.
+ * @return true if the benchmark ran.  False if the loopback connection could not be set up.
+ */
+static bool benchmarkTransmissionQueue(BenchmarkReport &report, const BenchmarkSettings &settings) {
+	// 1.0 Start a network manager and a transmission manager, and connect a client to them.
+	CommandQueue *queues[NUMBER_OF_QUEUES];
+	for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+		queues[index] = new CommandQueue();
+	}
+	NetworkManager receiver(settings.port, queues, "Bench Receiver");
+	NetworkTransmissionManager transmitter(&receiver, "Bench Transmitter", settings.capacity, OVERFLOW_BLOCK);
+	receiver.start();
+	if (settings.fifo) {
+		transmitter.start(CONSUMER_PRIORITY);
+	} else {
+		transmitter.start();
+	}
+
+	int clientSocket = connectLoopbackClient(settings.port);
+	int64_t deadline = getMonotonicTimeNs() + 2000000000LL;
+	while ((clientSocket >= 0) && (receiver.getClientCount() == 0) && (getMonotonicTimeNs() < deadline)) {
+		sleepForNs(1000000);
+	}
+	bool connected = (clientSocket >= 0) && (receiver.getClientCount() > 0);
+
+	// 2.0 The client thread counts every message, and records the delivery latency of messages which carry a send time.
+	std::atomic<uint64_t> received(0);
+	std::atomic<LatencyHistogram *> deliveryHistogram(NULL);
+	std::thread client([&]() {
+		networkMessageStruct message;
+		int frameVersion;
+		while (connected && (recv(clientSocket, &message, sizeof(message), MSG_WAITALL) == sizeof(message))) {
+			if (!decodeFrame(message, frameVersion)) {
+				message.timestampHigh = 0;
+				message.timestampLow = 0;
+			}
+			int64_t sendTime = (int64_t) ((((uint64_t) (uint32_t) message.timestampHigh) << 32) | (uint32_t) message.timestampLow);
+			LatencyHistogram *histogram = deliveryHistogram.load(std::memory_order_acquire);
+			if ((sendTime != 0) && (histogram != NULL)) {
+				histogram->record(getMonotonicTimeNs() - sendTime);
+			}
+			received.fetch_add(1, std::memory_order_release);
+		}
+	});
+
+	for (int producers = 1; connected && (producers <= settings.maxProducers); producers++) {
+		uint64_t total = (uint64_t) producers * settings.operations;
+		LatencyHistogram enqueueHistograms[MAX_PRODUCERS];
+		LatencyHistogram enqueueHistogram;
+		LatencyHistogram delivery;
+		std::atomic<uint32_t> errors(0);
+
+		// 3.0 Throughput.  The consumer here only waits for the client to have every message.
+		uint64_t startCount = received.load();
+		int64_t elapsed = runThreads(settings, producers, [&](int index) {
+			networkMessageStruct message;
+			memset(&message, 0, sizeof(message));
+			message.messageDestination = 1;
+			for (uint32_t operation = 0; operation < settings.operations; operation++) {
+				message.message = (index << 24) | operation;
+				message.xorChecksum = message.message ^ message.messageDestination;
+				int64_t startTime = getMonotonicTimeNs();
+				transmitter.enqueueMessage(message);
+				enqueueHistograms[index].record(getMonotonicTimeNs() - startTime);
+			}
+		}, [&]() {
+			int64_t timeout = getMonotonicTimeNs() + DELIVERY_TIMEOUT_NS;
+			while ((received.load(std::memory_order_acquire) - startCount < total) && (getMonotonicTimeNs() < timeout)) {
+				sleepForNs(50000);
+			}
+			if (received.load() - startCount < total) {
+				errors.fetch_add(1);
+			}
+		});
+		for (int index = 0; index < producers; index++) {
+			enqueueHistogram.merge(enqueueHistograms[index]);
+		}
+
+		// 4.0 Delivery latency.  The producers pace their messages and stamp the send time into the timestamp fields.
+		uint32_t perProducer = (settings.wakeups + producers - 1) / producers;
+		uint64_t pacedTotal = (uint64_t) perProducer * producers;
+		startCount = received.load();
+		deliveryHistogram.store(&delivery, std::memory_order_release);
+		runThreads(settings, producers, [&](int index) {
+			networkMessageStruct message;
+			memset(&message, 0, sizeof(message));
+			message.messageDestination = 1;
+			sleepForNs((WAKEUP_PACING_NS / MAX_PRODUCERS) * index);
+			for (uint32_t operation = 0; operation < perProducer; operation++) {
+				int64_t sendTime = getMonotonicTimeNs();
+				message.message = (index << 24) | operation;
+				message.timestampHigh = (int32_t) (sendTime >> 32);
+				message.timestampLow = (int32_t) sendTime;
+				message.xorChecksum = message.timestampHigh ^ message.timestampLow ^ message.message ^ message.messageDestination;
+				transmitter.enqueueMessage(message);
+				sleepForNs(WAKEUP_PACING_NS);
+			}
+		}, [&]() {
+			int64_t timeout = getMonotonicTimeNs() + DELIVERY_TIMEOUT_NS;
+			while ((received.load(std::memory_order_acquire) - startCount < pacedTotal) && (getMonotonicTimeNs() < timeout)) {
+				sleepForNs(50000);
+			}
+			if (received.load() - startCount < pacedTotal) {
+				errors.fetch_add(1);
+			}
+		});
+		deliveryHistogram.store(NULL, std::memory_order_release);
+
+		// 5.0 Add the case to the report.
+		beginCase(report, settings, "transmission_queue", "locked", producers);
+		report.addInteger("operations", total);
+		report.addInteger("elapsed_us", elapsed / 1000);
+		report.addReal("ops_per_sec", total / (elapsed / 1e9));
+		report.addInteger("errors", errors.load());
+		report.addHistogram("enqueue_ns", enqueueHistogram);
+		report.addHistogram("delivery_ns", delivery);
+	}
+
+	// 6.0 Shut everything down.  The client goes first, so that its reader thread sees the connection close.
+	if (clientSocket >= 0) {
+		shutdown(clientSocket, SHUT_RDWR);
+	}
+	client.join();
+	if (clientSocket >= 0) {
+		close(clientSocket);
+	}
+	receiver.stop();
+	transmitter.stop();
+	receiver.waitForShutdown();
+	transmitter.waitForShutdown();
+	for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+		delete queues[index];
+	}
+
+	if (!connected) {
+		std::cerr << "Could not connect to the transmission manager on port " << settings.port << ".\n";
+	}
+	return connected;
+}
+
+/**
+ * This method will print how the benchmark is used.
+ */
+static void printUsage() {
+	std::cerr << "Usage: queue_benchmark [--json] [--fifo] [--operations n] [--wakeups n] [--producers n] [--capacity n] [--port n]"
+			<< " [--no-network] [--output file]\n";
+}
+
+/**
+ * This is the main program for the queue benchmark.
+ * @param argc This is the number of arguments.
+ * @param argv These are the arguments.
+ * @return 0 if every benchmark ran without errors.  1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+	BenchmarkSettings settings;
+	bool json = false;
+	std::string outputFile;
+
+	// 1.0 Parse the command line.
+	for (int index = 1; index < argc; index++) {
+		std::string argument = argv[index];
+		bool hasValue = (index + 1 < argc);
+		if (argument == "--json") {
+			json = true;
+		} else if (argument == "--fifo") {
+			settings.fifo = true;
+		} else if (argument == "--no-network") {
+			settings.network = false;
+		} else if ((argument == "--operations") && hasValue) {
+			settings.operations = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--wakeups") && hasValue) {
+			settings.wakeups = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--producers") && hasValue) {
+			settings.maxProducers = atoi(argv[++index]);
+		} else if ((argument == "--capacity") && hasValue) {
+			settings.capacity = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--port") && hasValue) {
+			settings.port = (unsigned short) atoi(argv[++index]);
+		} else if ((argument == "--output") && hasValue) {
+			outputFile = argv[++index];
+		} else {
+			printUsage();
+			return 1;
+		}
+	}
+	if ((settings.maxProducers < 1) || (settings.maxProducers > MAX_PRODUCERS) || (settings.operations == 0)
+			|| (settings.operations > 0xFFFFFF) || (settings.wakeups == 0)) {
+		printUsage();
+		return 1;
+	}
+
+	// 2.0 Fall back to normal scheduling if real time scheduling is not permitted, and say so in the results.
+	if ((settings.fifo) && (!realTimeSchedulingAvailable())) {
+		std::cerr << "SCHED_FIFO is not permitted, so the benchmark runs under SCHED_OTHER.\n";
+		settings.fifo = false;
+	}
+
+	// 3.0 Run each command queue implementation with each number of producers.  The single producer ring only allows one.
+	BenchmarkReport report(json);
+	int implementations[] = { LOCKED_COMMAND_QUEUE, MPSC_COMMAND_QUEUE, SPSC_COMMAND_QUEUE };
+	for (int implementation : implementations) {
+		int maxProducers = (implementation == SPSC_COMMAND_QUEUE) ? 1 : settings.maxProducers;
+		for (int producers = 1; producers <= maxProducers; producers++) {
+			std::cerr << "command_queue " << implementationNames[implementation] << " with " << producers << " producers\n";
+			benchmarkCommandQueue(report, settings, implementation, producers);
+		}
+	}
+
+	// 4.0 Run the transmission queue.
+	bool succeeded = true;
+	if (settings.network) {
+		std::cerr << "transmission_queue\n";
+		succeeded = benchmarkTransmissionQueue(report, settings);
+	}
+
+	// 5.0 Write the results.
+	if (outputFile.empty()) {
+		report.write(std::cout);
+	} else {
+		std::ofstream output(outputFile.c_str());
+		if (!output) {
+			perror(outputFile.c_str());
+			return 1;
+		}
+		report.write(output);
+	}
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file ReceiveBenchmark.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This program benchmarks the receive path of the network manager on a Linux host.  Client threads connect over the loopback interface
+ * and send valid command messages in bursts, and a consumer drains the command queue they are addressed to.  Each case is run twice:
+ * once with a receive buffer of a single message, which is the old one receive per message loop, and once with the full receive ring.
+ * For each, it reports messages per second, and the receive calls and event loop wakeups per message.
+ * The results are written as CSV, or as JSON with --json.
+ * 
+ * Usage: receive_benchmark [--json] [--messages n] [--burst n] [--clients n] [--port n] [--output file]
+ */
+
+#include "BenchmarkReport.h"
+#include "bench_util.h"
+#include "CommandQueue.h"
+#include "NetworkManager.h"
+#include "NetworkCommands.h"
+#include "NetworkCfg.h"
+#include "QueueCfg.h"
+#include "time_util.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * This is the largest number of clients which are benchmarked.
+ */
+#define MAX_BENCHMARK_CLIENTS (4)
+
+/**
+ * This is the longest the benchmark waits for a case's messages to be received, in nanoseconds.
+ */
+#define RECEIVE_TIMEOUT_NS (30000000000LL)
+
+/**
+ * This structure holds the settings for a benchmark run, taken from the command line.
+ */
+struct BenchmarkSettings {
+	/**
+	 * This is the total number of messages sent in each case, shared between the clients.
+	 */
+	uint32_t messages = 200000;
+
+	/**
+	 * This is the number of messages each client sends with one system call.
+	 */
+	uint32_t burst = 32;
+
+	/**
+	 * This is the largest number of clients benchmarked.
+	 */
+	int maxClients = MAX_BENCHMARK_CLIENTS;
+
+	/**
+	 * This is the loopback port used.
+	 */
+	unsigned short port = 19190;
+};
+
+/**
+ * This method will fill a buffer with valid command messages for the first queue, in network byte order.
+ * @param messages This is the buffer.
+ * @param count This is the number of messages.
+ */
+static void buildMessages(networkMessageStruct *messages, uint32_t count) {
+	for (uint32_t index = 0; index < count; index++) {
+		networkMessageStruct &message = messages[index];
+		memset(&message, 0, sizeof(message));
+		message.messageID = index;
+		message.messageType = COMMAND_MSG_TYPE;
+		message.messageDestination = 1;
+		message.message = index;
+		message.xorChecksum = message.messageID ^ message.timestampHigh ^ message.timestampLow ^ message.messageType ^ message.message
+				^ message.messageDestination;
+
+		message.messageID = htonl(message.messageID);
+		message.messageType = htonl(message.messageType);
+		message.messageDestination = htonl(message.messageDestination);
+		message.message = htonl(message.message);
+		message.xorChecksum = htonl(message.xorChecksum);
+	}
+}
+
+/**
+ * This method will benchmark the network manager with one receive buffer size and number of clients.
+ * @param report This is the report the results are added to.
+ * @param settings This is the benchmark settings.
+ * @param mode This is the name of the receive mode.
+ * @param receiveBufferSize This is the size of each client's receive buffer.
+ * @param clients This is the number of clients.
+ * @return true if the case ran.  False if the clients could not connect.
+ */
+static bool benchmarkReceive(BenchmarkReport &report, const BenchmarkSettings &settings, const std::string &mode,
+		uint32_t receiveBufferSize, int clients) {
+	// 1.0 Start a network manager whose first queue is drained by the consumer, and connect the clients.
+	CommandQueue *queues[NUMBER_OF_QUEUES];
+	for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+		queues[index] = new CommandQueue(SPSC_COMMAND_QUEUE, 1024);
+	}
+	NetworkManager receiver(settings.port, queues, "Bench Receiver", 0, receiveBufferSize);
+	receiver.start();
+
+	std::vector<int> sockets;
+	for (int index = 0; index < clients; index++) {
+		int clientSocket = connectLoopbackClient(settings.port);
+		if (clientSocket >= 0) {
+			sockets.push_back(clientSocket);
+		}
+	}
+	int64_t deadline = getMonotonicTimeNs() + 2000000000LL;
+	while ((receiver.getClientCount() < sockets.size()) && (getMonotonicTimeNs() < deadline)) {
+		sleepForNs(1000000);
+	}
+	bool connected = ((int) sockets.size() == clients) && ((int) receiver.getClientCount() == clients);
+
+	// 2.0 Each client sends its share of the messages in bursts, and the consumer counts them off the queue.
+	uint32_t perClient = settings.messages / clients;
+	uint64_t total = (uint64_t) perClient * clients;
+	uint64_t received = 0;
+	int64_t elapsed = 0;
+	uint64_t startCalls = receiver.getReceiveCallCount();
+	uint64_t startWakeups = receiver.getEventLoopWakeupCount();
+	if (connected) {
+		std::vector<networkMessageStruct> burst(settings.burst);
+		buildMessages(burst.data(), settings.burst);
+		std::atomic<bool> released(false);
+		std::vector<std::thread> senders;
+		for (int index = 0; index < clients; index++) {
+			int clientSocket = sockets[index];
+			senders.push_back(std::thread([&, clientSocket]() {
+				while (!released.load(std::memory_order_acquire)) {
+					sched_yield();
+				}
+				for (uint32_t sent = 0; sent < perClient; sent += settings.burst) {
+					uint32_t count = ((perClient - sent) < settings.burst) ? (perClient - sent) : settings.burst;
+					send(clientSocket, burst.data(), count * sizeof(networkMessageStruct), 0);
+				}
+			}));
+		}
+
+		int64_t startTime = getMonotonicTimeNs();
+		released.store(true, std::memory_order_release);
+		int64_t timeout = startTime + RECEIVE_TIMEOUT_NS;
+		int value;
+		while ((received < total) && (getMonotonicTimeNs() < timeout)) {
+			if (queues[0]->dequeueFor(value, 100000)) {
+				received++;
+			}
+		}
+		elapsed = getMonotonicTimeNs() - startTime;
+		for (size_t index = 0; index < senders.size(); index++) {
+			senders[index].join();
+		}
+	}
+	uint64_t calls = receiver.getReceiveCallCount() - startCalls;
+	uint64_t wakeups = receiver.getEventLoopWakeupCount() - startWakeups;
+
+	// 3.0 Shut everything down.
+	for (size_t index = 0; index < sockets.size(); index++) {
+		close(sockets[index]);
+	}
+	receiver.stop();
+	receiver.waitForShutdown();
+	for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+		delete queues[index];
+	}
+	if (!connected) {
+		std::cerr << "Could not connect " << clients << " clients on port " << settings.port << ".\n";
+		return false;
+	}
+
+	// 4.0 Add the case to the report.
+	report.beginRecord();
+	report.addText("mode", mode);
+	report.addInteger("receive_buffer", receiveBufferSize);
+	report.addInteger("clients", clients);
+	report.addInteger("burst", settings.burst);
+	report.addInteger("messages", total);
+	report.addInteger("elapsed_us", elapsed / 1000);
+	report.addReal("msgs_per_sec", received / (elapsed / 1e9));
+	report.addReal("recv_calls_per_1000_msgs", (1000.0 * calls) / total);
+	report.addReal("wakeups_per_1000_msgs", (1000.0 * wakeups) / total);
+	report.addInteger("errors", total - received);
+	return true;
+}
+
+/**
+ * This method will print how the benchmark is used.
+ */
+static void printUsage() {
+	std::cerr << "Usage: receive_benchmark [--json] [--messages n] [--burst n] [--clients n] [--port n] [--output file]\n";
+}
+
+/**
+ * This is the main program for the receive benchmark.
+ * @param argc This is the number of arguments.
+ * @param argv These are the arguments.
+ * @return 0 if every case ran.  1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+	BenchmarkSettings settings;
+	bool json = false;
+	std::string outputFile;
+
+	// 1.0 Parse the command line.
+	for (int index = 1; index < argc; index++) {
+		std::string argument = argv[index];
+		bool hasValue = (index + 1 < argc);
+		if (argument == "--json") {
+			json = true;
+		} else if ((argument == "--messages") && hasValue) {
+			settings.messages = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--burst") && hasValue) {
+			settings.burst = strtoul(argv[++index], NULL, 0);
+		} else if ((argument == "--clients") && hasValue) {
+			settings.maxClients = atoi(argv[++index]);
+		} else if ((argument == "--port") && hasValue) {
+			settings.port = (unsigned short) atoi(argv[++index]);
+		} else if ((argument == "--output") && hasValue) {
+			outputFile = argv[++index];
+		} else {
+			printUsage();
+			return 1;
+		}
+	}
+	if ((settings.maxClients < 1) || (settings.maxClients > MAX_BENCHMARK_CLIENTS) || (settings.burst == 0)
+			|| (settings.messages < (uint32_t) settings.maxClients)) {
+		printUsage();
+		return 1;
+	}
+
+	// 2.0 Run each receive mode with each number of clients.
+	BenchmarkReport report(json);
+	bool succeeded = true;
+	for (int clients = 1; clients <= settings.maxClients; clients++) {
+		std::cerr << "receive with " << clients << " clients\n";
+		succeeded &= benchmarkReceive(report, settings, "per_message", sizeof(networkMessageStruct), clients);
+		succeeded &= benchmarkReceive(report, settings, "ring", CLIENT_RECEIVE_BUFFER_SIZE, clients);
+	}
+
+	// 3.0 Write the results.
+	if (outputFile.empty()) {
+		report.write(std::cout);
+	} else {
+		std::ofstream output(outputFile.c_str());
+		if (!output) {
+			perror(outputFile.c_str());
+			return 1;
+		}
+		report.write(output);
+	}
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file bench_util.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file implements the utilities shared by the host benchmarks.
+ */
+
+#include "bench_util.h"
+#include "time_util.h"
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * This method will determine whether the calling process may use real time scheduling.  It briefly moves the calling thread to
+ * SCHED_FIFO and back again.
+ * @return true if SCHED_FIFO can be used.  False otherwise, typically because the process lacks CAP_SYS_NICE.
+ */
+bool realTimeSchedulingAvailable() {
+	if (!setThreadPriority(1)) {
+		return false;
+	}
+	setThreadPriority(0);
+	return true;
+}
+
+/**
+ * This method will set the scheduling policy of the calling thread.
+ * @param priority This is the SCHED_FIFO priority, between 1 and 99.  0 puts the thread back under SCHED_OTHER.
+ * @return true if the policy was set.  False otherwise.
+ */
+bool setThreadPriority(int priority) {
+	struct sched_param parameters;
+	int policy = (priority > 0) ? SCHED_FIFO : SCHED_OTHER;
+
+	parameters.sched_priority = priority;
+	return (pthread_setschedparam(pthread_self(), policy, &parameters) == 0);
+}
+
+/**
+ * This method will put the calling thread to sleep for the given time on the monotonic clock.
+ * @param duration This is the time to sleep, in nanoseconds.
+ */
+void sleepForNs(int64_t duration) {
+	struct timespec deadline = nsToTimespec(getMonotonicTimeNs() + duration);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+	}
+}
+
+/**
+ * This method will connect a TCP client to a port on the loopback interface, retrying while the server starts listening.
+ * @param port This is the port.
+ * @return The connected socket, or -1 if no connection could be made.
+ */
+int connectLoopbackClient(unsigned short port) {
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (int attempt = 0; attempt < 200; attempt++) {
+		int clientSocket = socket(AF_INET, SOCK_STREAM, 0);
+		if (clientSocket < 0) {
+			perror("socket");
+			return -1;
+		}
+		if (connect(clientSocket, (struct sockaddr *) &address, sizeof(address)) == 0) {
+			return clientSocket;
+		}
+		close(clientSocket);
+		sleepForNs(10000000);
+	}
+	return -1;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file bench_util.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines a set of utilities shared by the host benchmarks.  They put benchmark threads under real time scheduling and
+ * pace them, so that the benchmarks can be run on a Linux host without the robot hardware.
+ */
+#ifndef BENCH_UTIL_H_
+#define BENCH_UTIL_H_
+
+#include <stdint.h>
+
+/**
+ * This method will determine whether the calling process may use real time scheduling.  It briefly moves the calling thread to
+ * SCHED_FIFO and back again.
+ * @return true if SCHED_FIFO can be used.  False otherwise, typically because the process lacks CAP_SYS_NICE.
+ */
+bool realTimeSchedulingAvailable();
+
+/**
+ * This method will set the scheduling policy of the calling thread.
+ * @param priority This is the SCHED_FIFO priority, between 1 and 99.  0 puts the thread back under SCHED_OTHER.
+ * @return true if the policy was set.  False otherwise.
+ */
+bool setThreadPriority(int priority);
+
+/**
+ * This method will put the calling thread to sleep for the given time on the monotonic clock.
+ * @param duration This is the time to sleep, in nanoseconds.
+ */
+void sleepForNs(int64_t duration);
+
+/**
+ * This method will connect a TCP client to a port on the loopback interface, retrying while the server starts listening.
+ * @param port This is the port.
+ * @return The connected socket, or -1 if no connection could be made.
+ */
+int connectLoopbackClient(unsigned short port);
+
+#endif /* BENCH_UTIL_H_ */
@@ -35,7 +35,14 @@ using namespace std;
 #include "RobotStatusManager.h"
 #include "CollisionSensingRobotController.h"
 #include "GenericThreadInfo.h"
+#include "CyclicExecutive.h"
+#include "RealTimeMemory.h"
+#include "SchedulabilityAnalyzer.h"
+#include "VirtualClock.h"
+#include "QueueCfg.h"
 #include "labcfg.h"
+#include <string.h>
+#include <fstream>
 using namespace std;
 
 /**
@@ -47,13 +54,18 @@ int main(int argc, char *argv[]) {
 	// These are the image sizes for the camera (c) and the transmitted image (t), both height (h) and width (w).
 	int cw, ch, tw, th, fps, lpudp;
 
-	if ( argc != 8 ) {
+	if ( argc < 8 || argc > 10 ) {
 		printf(
-				"Usage: %s ip port cameraWidth cameraHeight TransmitWidth transmitHeight <frame per second to send>",
+				"Usage: %s ip port cameraWidth cameraHeight TransmitWidth transmitHeight <frame per second to send> [threads|cyclic] [simulated seconds]",
 				argv[0]);
 		exit(0);
 	}
 
+#if REALTIME_MEMORY_HARDENING
+	// Lock and prefault memory before any thread is started, so that every thread inherits the locked address space.
+	RealTimeMemory::enable();
+#endif
+
 	GenericThreadInfo mainThread("main", syscall(SYS_gettid));
 
 	cout << "Main thread id is : " << mainThread.getThreadID() << "\n";
@@ -66,16 +78,49 @@ int main(int argc, char *argv[]) {
 	th = atoi(argv[6]);
 	fps = atoi(argv[7]);
 
+	/**
+	 * Select how the periodic tasks are to be executed.  The default comes from TaskRates.h, but it can be overridden on the command line.
+	 */
+	bool multiplexPeriodicTasks = (TASK_EXECUTION_MODE == CYCLIC_EXECUTIVE_EXECUTION);
+	if (argc >= 9) {
+		multiplexPeriodicTasks = (strcmp(argv[8], "cyclic") == 0);
+	}
+
+	/**
+	 * If a number of simulated seconds is given, the periodic tasks run against a virtual clock, as fast as possible, instead of in real time.
+	 */
+	int simulatedSeconds = 0;
+	if (argc == 10) {
+		simulatedSeconds = atoi(argv[9]);
+	}
+	VirtualClock virtualClock;
+	if (simulatedSeconds > 0) {
+		Clock::setClock(&virtualClock);
+	}
+
+	CyclicExecutive executive("Cyclic Executive", CYCLIC_EXECUTIVE_MINOR_FRAME_QUANTUM, CYCLIC_EXECUTIVE_CPU);
+	if (multiplexPeriodicTasks) {
+		PeriodicTask::setDefaultExecutive(&executive);
+	}
+
+	int queueImplementations[NUMBER_OF_QUEUES] = {ROBOT_CONTROLLER_QUEUE_IMPLEMENTATION, HORN_QUEUE_IMPLEMENTATION, LINE_SENSOR_QUEUE_IMPLEMENTATION};
+	CommandClassifier queueClassifiers[NUMBER_OF_QUEUES] = {RobotController::classifyCommand, Horn::classifyCommand, NULL};
+	bool queueFlushes[NUMBER_OF_QUEUES] = {ROBOT_CONTROLLER_QUEUE_FLUSH_SUPERSEDED, HORN_QUEUE_FLUSH_SUPERSEDED, false};
+	CommandClassifier queueCoalescers[NUMBER_OF_QUEUES] = {ROBOT_CONTROLLER_QUEUE_COALESCING ? RobotController::coalescingKey : NULL, NULL, NULL};
+	uint32_t queueCapacities[NUMBER_OF_QUEUES] = {ROBOT_CONTROLLER_QUEUE_CAPACITY, HORN_QUEUE_CAPACITY, LINE_SENSOR_QUEUE_CAPACITY};
+	int queueOverflowPolicies[NUMBER_OF_QUEUES] = {ROBOT_CONTROLLER_QUEUE_OVERFLOW_POLICY, HORN_QUEUE_OVERFLOW_POLICY, LINE_SENSOR_QUEUE_OVERFLOW_POLICY};
+	string queueNames[NUMBER_OF_QUEUES] = {"Robot Controller", "Horn", "Line Sensor"};
 	CommandQueue *myQueue[NUMBER_OF_QUEUES];
 	for (int index = 0; index < NUMBER_OF_QUEUES; index++)
 	{
-		myQueue[index] = new CommandQueue();
+		myQueue[index] = new CommandQueue(queueImplementations[index], queueCapacities[index], queueClassifiers[index], queueFlushes[index],
+				queueCoalescers[index], queueOverflowPolicies[index]);
 	}
 
 	/**
 	 * Declare the network manager, which will receive commands from the network.
 	 */
-	NetworkManager nm(9090, myQueue, "NetworkManager");
+	NetworkManager nm(9090, myQueue, "NetworkManager", UDP_COMMAND_PORT);
 	NetworkTransmissionManager ntm(&nm, "NW Trans Manager");
 
 	/**
@@ -85,6 +130,9 @@ int main(int argc, char *argv[]) {
 	CollisionSensor cs(myQueue[0], myQueue[1], &ds, "CollisionSensor", COLLISION_SENSOR_TASK_PERIOD);
 	cs.setMinimumAcceptableDistance(250);
 
+	// The distance sensor blocks waiting for the echo, so it must keep its own thread.
+	ds.setMultiplexingAllowed(false);
+
 
 #if LAB_IMPLEMENATION_STEP >= 12
 	CollisionSensingRobotController mc(myQueue[0], myQueue[1], &cs, "CSRobotController");
@@ -104,7 +152,7 @@ int main(int argc, char *argv[]) {
 
 
 #if LAB_IMPLEMENATION_STEP >= 10
-	RobotStatusManager rsm(&ntm, &ds, "Robot Status Manager", ROBOT_STATUS_MANAGER_TASK_PERIOD);
+	RobotStatusManager rsm(&ntm, &ds, "Robot Status Manager", ROBOT_STATUS_MANAGER_TASK_PERIOD, &nm);
 #endif
 
 #if LAB_IMPLEMENATION_STEP >= 11
@@ -114,6 +162,10 @@ int main(int argc, char *argv[]) {
 	// Figure out the port to use.
 	ImageTransmitter it(argv[1], port);
 	ImageCapturer is(&myCamera, &it, tw, th, "Image Stream", (IMAGE_STREAM_TASK_PERIOD));
+
+	// The image pipeline blocks on the camera and the network, so it must keep its own threads.
+	myCamera.setMultiplexingAllowed(false);
+	is.setMultiplexingAllowed(false);
 #endif
 
 	/**
@@ -123,36 +175,89 @@ int main(int argc, char *argv[]) {
 			CENTER_LINE_SENSOR_GPIO_PIN, RIGHT_LINE_SENSOR_GPIO_PIN,
 			"Stop Line Sensor Task", LINE_TRACKER_SENSOR_TASK_PERIOD);
 
+#if LAB_IMPLEMENATION_STEP >= 10
+	rsm.setTelemetrySources(&mc, &ls, myQueue);
+#endif
+
 	// Start each of the two threads up.
-	nm.start(NETWORK_RECEPTION_TASK_PRIORITY);
-	ntm.start(NETWORK_TRANSMIT_TASK_PRIORITY);
+	if (multiplexPeriodicTasks) {
+		executive.start(CYCLIC_EXECUTIVE_PRIORITY);
+	}
+	nm.start(NETWORK_RECEPTION_TASK_PRIORITY, NETWORK_RECEPTION_TASK_CPUS);
+	ntm.start(NETWORK_TRANSMIT_TASK_PRIORITY, NETWORK_TRANSMIT_TASK_CPUS);
 #if LAB_IMPLEMENATION_STEP >= 10
-	rsm.start(ROBOT_STATUS_MANAGER_TASK_PRIORITY);
+	rsm.start(ROBOT_STATUS_MANAGER_TASK_PRIORITY, ROBOT_STATUS_MANAGER_TASK_CPUS);
 #endif
 
-	mc.start(MOTOR_CTRL_TASK_PRIORITY-1);
-	h.start(HORN_TASK_PRIORITY);
-	ds.start(DISTANCE_SENSOR_TASK_PRIORITY);
-	cs.start(COLLISION_SENSOR_TASK_PRIORITY);
-	ls.start(LINE_TRACKER_SENSOR_TASK_PRIORITY);
+	mc.start(MOTOR_CTRL_TASK_PRIORITY-1, ROBOT_CONTROLLER_CPUS);
+	h.start(HORN_TASK_PRIORITY, HORN_TASK_CPUS);
+	ds.start(DISTANCE_SENSOR_TASK_PRIORITY, DISTANCE_SENSOR_TASK_CPUS);
+	cs.start(COLLISION_SENSOR_TASK_PRIORITY, COLLISION_SENSOR_TASK_CPUS);
+	ls.start(LINE_TRACKER_SENSOR_TASK_PRIORITY, LINE_TRACKER_SENSOR_TASK_CPUS);
 
 #if LAB_IMPLEMENATION_STEP >= 11
-	myCamera.start(CAMERA_TASK_PRIORITY);
-	is.start(IMAGE_STREAM_TASK_PRIORITY);
+	myCamera.start(CAMERA_TASK_PRIORITY, CAMERA_TASK_CPUS);
+	is.start(IMAGE_STREAM_TASK_PRIORITY, IMAGE_STREAM_TASK_CPUS);
+#endif
+
+#if REALTIME_MEMORY_HARDENING
+	// Give the tasks time to finish their initialization, and then report any allocations the real time threads make from here on.
+	std::this_thread::sleep_for(std::chrono::milliseconds(REALTIME_HEAP_FREEZE_DELAY));
+	RealTimeMemory::freezeHeap();
 #endif
 	string msg;
-	cin >> msg;
+	if (simulatedSeconds > 0) {
+		// Run the whole simulation, show the results, and shut down.
+		virtualClock.runUntil(((int64_t) simulatedSeconds) * 1000000000LL);
+		RunnableClass::printThreads();
+		msg = "QUIT";
+	} else {
+		cin >> msg;
+	}
 
 	while (msg.compare("QUIT") != 0) {
 		if (msg.compare("P") == 0) {
 			RunnableClass::printThreads();
 		} else if (msg.compare("R") == 0) {
 			RunnableClass::resetAllThreadInformation();
+		} else if (msg.compare("S") == 0) {
+			// Run response time analysis on the measured execution times, and suggest rate monotonic priorities.
+			SchedulabilityAnalyzer::analyze();
+		} else if (msg.compare("C") == 0) {
+			// Dump the latency histograms so that tail latency can be compared between runs.
+			ofstream csvFile("threadLatency.csv");
+			RunnableClass::writeThreadHistogramsCSV(csvFile);
+			cout << "Latency histograms written to threadLatency.csv\n";
+		} else if (msg.compare("A") == 0) {
+			// Show any heap allocations and page faults that the real time threads have had since startup.
+			RealTimeMemory::printReport();
+		} else if (msg.compare("Q") == 0) {
+			// Show how long commands wait on each queue, per priority level, so that the stop latency can be checked.
+			CommandQueue::printStatisticsHeader(cout);
+			for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+				myQueue[index]->printStatistics(cout, queueNames[index]);
+			}
+
+			// Then show how full each queue has run and what its overflow policy has cost.
+			CommandQueue::printBackpressureHeader(cout);
+			for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+				myQueue[index]->printBackpressureStatistics(cout, queueNames[index]);
+			}
+			ntm.printBackpressureStatistics(cout);
+
+			// And how many wakeups and system calls each batch of telemetry has cost.
+			ntm.printTransmissionStatistics(cout);
+		} else if (msg.compare("L") == 0) {
+			// Show where the time goes between a command arriving and it reaching the motors.
+			mc.printLatencyInformation(cout);
+
+			// And how long the network itself is taking, as estimated from the clients' pings.
+			nm.printLinkStatistics(cout);
 		}
 		else if (msg.compare("M")==0)
 		{
 			// Mute the horn...
-			myQueue[1]->enqueue(HORN_MUTE_COMMAND);
+			myQueue[1]->enqueue(HORN_MUTE_COMMAND, COMMAND_SOURCE_CONSOLE);
 		}
 		cin >> msg;
 	}
@@ -170,6 +275,14 @@ int main(int argc, char *argv[]) {
 #endif
 	ntm.stop();
 	nm.stop();
+	if (multiplexPeriodicTasks) {
+		executive.stop();
+	}
+
+	// Let the simulated tasks see that they have been stopped.
+	if (simulatedSeconds > 0) {
+		virtualClock.runToCompletion();
+	}
 
 	// Wait for the threads to die.
 #if LAB_IMPLEMENATION_STEP >= 11
@@ -186,6 +299,9 @@ int main(int argc, char *argv[]) {
 #endif
 	ntm.waitForShutdown();
 	nm.waitForShutdown();
+	if (multiplexPeriodicTasks) {
+		executive.waitForShutdown();
+	}
 
 	for (int index = 0; index < NUMBER_OF_QUEUES; index++)
 	{
@@ -21,3 +21,38 @@ double calculateDelta(struct timeval start, struct timeval end)
 
 	return endms - startms;
 }
+
+/**
+ * This method will return the current time of the monotonic clock.  The monotonic clock is not affected by changes to the wall clock,
+ * so it is the clock that is to be used for scheduling and for measuring intervals.
+ * @return The return will be the current CLOCK_MONOTONIC time in nanoseconds.
+ */
+int64_t getMonotonicTimeNs()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespecToNs(now);
+}
+
+/**
+ * This method will convert a time given in nanoseconds into a timespec structure.
+ * @param timeNs This is the time, in nanoseconds, that is to be converted.
+ * @return The return will be the equivalent timespec.
+ */
+struct timespec nsToTimespec(int64_t timeNs)
+{
+	struct timespec ts;
+	ts.tv_sec = timeNs / 1000000000LL;
+	ts.tv_nsec = timeNs % 1000000000LL;
+	return ts;
+}
+
+/**
+ * This method will convert a timespec structure into nanoseconds.
+ * @param ts This is the timespec that is to be converted.
+ * @return The return will be the time in nanoseconds.
+ */
+int64_t timespecToNs(const struct timespec &ts)
+{
+	return ((int64_t) ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
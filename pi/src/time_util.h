@@ -2,7 +2,12 @@
  * This is a set of time utilities.  It is used for basic timestamping.
  * @return
  */
+#ifndef TIME_UTIL_H_
+#define TIME_UTIL_H_
+
 #include <sys/time.h>
+#include <time.h>
+#include <stdint.h>
 
 /**
  * This method will return a current timestamp.
@@ -17,3 +22,26 @@ int current_timestamp();
  * @return The return will be the delta time between these, in ms.
  */
 double calculateDelta(struct timeval start, struct timeval end);
+
+/**
+ * This method will return the current time of the monotonic clock.  The monotonic clock is not affected by changes to the wall clock,
+ * so it is the clock that is to be used for scheduling and for measuring intervals.
+ * @return The return will be the current CLOCK_MONOTONIC time in nanoseconds.
+ */
+int64_t getMonotonicTimeNs();
+
+/**
+ * This method will convert a time given in nanoseconds into a timespec structure.
+ * @param timeNs This is the time, in nanoseconds, that is to be converted.
+ * @return The return will be the equivalent timespec.
+ */
+struct timespec nsToTimespec(int64_t timeNs);
+
+/**
+ * This method will convert a timespec structure into nanoseconds.
+ * @param ts This is the timespec that is to be converted.
+ * @return The return will be the time in nanoseconds.
+ */
+int64_t timespecToNs(const struct timespec &ts);
+
+#endif /* TIME_UTIL_H_ */